@@ -0,0 +1,76 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cmath>
+
+struct AABB {
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+// Strict containment, the same test checkCollision has always used
+inline bool aabbContains(const AABB& box, const glm::vec3& p) {
+	return p.x > box.min.x && p.x < box.max.x &&
+		p.y > box.min.y && p.y < box.max.y &&
+		p.z > box.min.z && p.z < box.max.z;
+}
+
+inline bool aabbOverlaps(const AABB& a, const AABB& b) {
+	return a.min.x < b.max.x && a.max.x > b.min.x &&
+		a.min.y < b.max.y && a.max.y > b.min.y &&
+		a.min.z < b.max.z && a.max.z > b.min.z;
+}
+
+// 1/dir for the slab tests. A zero component becomes a huge value of the same
+// sign instead of inf, so a ray starting exactly on a box plane of that axis
+// gives 0 instead of 0 * inf = NaN, which would drop the hit.
+inline glm::vec3 aabbInvDir(const glm::vec3& dir) {
+	glm::vec3 inv;
+	for (int i = 0; i < 3; i++) inv[i] = dir[i] != 0.0f ? 1.0f / dir[i] : std::copysign(FLT_MAX, dir[i]);
+	return inv;
+}
+
+// Slab test of the ray a + t * dir (given as aabbInvDir(dir)) against the box, limited to
+// [0, tMax]. tNear is the entry parameter, 0 when a already lies inside.
+inline bool aabbRaySlab(const AABB& box, const glm::vec3& a, const glm::vec3& invDir, float tMax, float& tNear) {
+	glm::vec3 t0 = (box.min - a) * invDir;
+	glm::vec3 t1 = (box.max - a) * invDir;
+	glm::vec3 tMin = glm::min(t0, t1);
+	glm::vec3 tMaxV = glm::max(t0, t1);
+	float enter = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, 0.0f));
+	float exit = glm::min(glm::min(tMaxV.x, tMaxV.y), glm::min(tMaxV.z, tMax));
+	tNear = enter;
+	return enter <= exit;
+}
+
+// Outward normal of the face through which the ray a + t * dir enters the box
+inline glm::vec3 aabbEntryNormal(const AABB& box, const glm::vec3& a, const glm::vec3& dir) {
+	glm::vec3 invDir = aabbInvDir(dir);
+	glm::vec3 tMin = glm::min((box.min - a) * invDir, (box.max - a) * invDir);
+	int axis = 0;
+	if (tMin.y > tMin[axis]) axis = 1;
+	if (tMin.z > tMin[axis]) axis = 2;
+
+	if (tMin[axis] <= 0.0f) {
+		// Already inside: push back against the motion
+		float len = glm::length(dir);
+		return len > 0.0f ? -dir / len : glm::vec3(0, 1, 0);
+	}
+	glm::vec3 n(0.0f);
+	n[axis] = dir[axis] > 0.0f ? -1.0f : 1.0f;
+	return n;
+}
+
+inline AABB aabbUnion(const AABB& a, const AABB& b) {
+	return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+}
+
+inline float aabbHalfArea(const AABB& box) {
+	glm::vec3 e = box.max - box.min;
+	return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+#endif
@@ -0,0 +1,79 @@
+#include "aabbsoa.h"
+
+#include <limits>
+
+#if defined(__AVX__)
+#define AABBSOA_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AABBSOA_SSE 1
+#include <emmintrin.h>
+#endif
+
+void AabbSoA::clear() {
+	minX.clear(); minY.clear(); minZ.clear();
+	maxX.clear(); maxY.clear(); maxZ.clear();
+	idx.clear();
+	count = 0;
+}
+
+void AabbSoA::append(const AABB& b, int32_t index) {
+	minX.push_back(b.min.x); minY.push_back(b.min.y); minZ.push_back(b.min.z);
+	maxX.push_back(b.max.x); maxY.push_back(b.max.y); maxZ.push_back(b.max.z);
+	idx.push_back(index);
+	count = idx.size();
+}
+
+void AabbSoA::seal() {
+	// Inverted infinite box: p > +inf and p < -inf are false for any margin
+	const float inf = std::numeric_limits<float>::infinity();
+	for (int i = 0; i < BATCH - 1; i++) {
+		minX.push_back(inf); minY.push_back(inf); minZ.push_back(inf);
+		maxX.push_back(-inf); maxY.push_back(-inf); maxZ.push_back(-inf);
+		idx.push_back(-1);
+	}
+}
+
+unsigned AabbSoA::batchMaskScalar(size_t f, const glm::vec3& p, const glm::vec3& lo, const glm::vec3& hi) const {
+	unsigned mask = 0;
+	for (int j = 0; j < BATCH; j++) {
+		size_t i = f + j;
+		if (p.x > minX[i] + lo.x && p.x < maxX[i] + hi.x &&
+			p.y > minY[i] + lo.y && p.y < maxY[i] + hi.y &&
+			p.z > minZ[i] + lo.z && p.z < maxZ[i] + hi.z) mask |= 1u << j;
+	}
+	return mask;
+}
+
+unsigned AabbSoA::batchMask(size_t f, const glm::vec3& p, const glm::vec3& lo, const glm::vec3& hi) const {
+#if defined(AABBSOA_AVX)
+	__m256 in = _mm256_and_ps(
+		_mm256_cmp_ps(_mm256_set1_ps(p.x), _mm256_add_ps(_mm256_loadu_ps(&minX[f]), _mm256_set1_ps(lo.x)), _CMP_GT_OQ),
+		_mm256_cmp_ps(_mm256_set1_ps(p.x), _mm256_add_ps(_mm256_loadu_ps(&maxX[f]), _mm256_set1_ps(hi.x)), _CMP_LT_OQ));
+	in = _mm256_and_ps(in, _mm256_and_ps(
+		_mm256_cmp_ps(_mm256_set1_ps(p.y), _mm256_add_ps(_mm256_loadu_ps(&minY[f]), _mm256_set1_ps(lo.y)), _CMP_GT_OQ),
+		_mm256_cmp_ps(_mm256_set1_ps(p.y), _mm256_add_ps(_mm256_loadu_ps(&maxY[f]), _mm256_set1_ps(hi.y)), _CMP_LT_OQ)));
+	in = _mm256_and_ps(in, _mm256_and_ps(
+		_mm256_cmp_ps(_mm256_set1_ps(p.z), _mm256_add_ps(_mm256_loadu_ps(&minZ[f]), _mm256_set1_ps(lo.z)), _CMP_GT_OQ),
+		_mm256_cmp_ps(_mm256_set1_ps(p.z), _mm256_add_ps(_mm256_loadu_ps(&maxZ[f]), _mm256_set1_ps(hi.z)), _CMP_LT_OQ)));
+	return (unsigned)_mm256_movemask_ps(in);
+#elif defined(AABBSOA_SSE)
+	unsigned mask = 0;
+	for (int half = 0; half < 2; half++) {
+		size_t i = f + 4 * half;
+		__m128 in = _mm_and_ps(
+			_mm_cmpgt_ps(_mm_set1_ps(p.x), _mm_add_ps(_mm_loadu_ps(&minX[i]), _mm_set1_ps(lo.x))),
+			_mm_cmplt_ps(_mm_set1_ps(p.x), _mm_add_ps(_mm_loadu_ps(&maxX[i]), _mm_set1_ps(hi.x))));
+		in = _mm_and_ps(in, _mm_and_ps(
+			_mm_cmpgt_ps(_mm_set1_ps(p.y), _mm_add_ps(_mm_loadu_ps(&minY[i]), _mm_set1_ps(lo.y))),
+			_mm_cmplt_ps(_mm_set1_ps(p.y), _mm_add_ps(_mm_loadu_ps(&maxY[i]), _mm_set1_ps(hi.y)))));
+		in = _mm_and_ps(in, _mm_and_ps(
+			_mm_cmpgt_ps(_mm_set1_ps(p.z), _mm_add_ps(_mm_loadu_ps(&minZ[i]), _mm_set1_ps(lo.z))),
+			_mm_cmplt_ps(_mm_set1_ps(p.z), _mm_add_ps(_mm_loadu_ps(&maxZ[i]), _mm_set1_ps(hi.z)))));
+		mask |= (unsigned)_mm_movemask_ps(in) << (4 * half);
+	}
+	return mask;
+#else
+	return batchMaskScalar(f, p, lo, hi);
+#endif
+}
@@ -0,0 +1,68 @@
+#ifndef AABBSOA_H
+#define AABBSOA_H
+
+#include "aabb.h"
+
+#include <vector>
+#include <cstdint>
+
+// Static boxes as structure of arrays for the containment tests of
+// checkCollision, isOnRunway and isInLandingApproach. Eight boxes are tested
+// with one AVX compare chain (two with SSE, a loop without either); the storage
+// is padded so a batch may start at any box. The test is min + lo < p < max + hi per axis, the same float
+// expressions as the scalar loops, so both paths give identical answers.
+class AabbSoA {
+public:
+	static const int BATCH = 8;
+
+	void clear();
+	void append(const AABB& box, int32_t index);
+	void seal(); // call after the last append: adds never-matching padding
+
+	size_t size() const { return count; }
+	AABB box(size_t i) const;
+	int32_t index(size_t i) const { return idx[i]; }
+	size_t memoryBytes() const { return (minX.capacity() + minY.capacity() + minZ.capacity() + maxX.capacity() + maxY.capacity()
+		+ maxZ.capacity()) * sizeof(float) + idx.capacity() * sizeof(int32_t); }
+
+	// One bit per box of the eight starting at 'first'
+	unsigned batchMask(size_t first, const glm::vec3& p, const glm::vec3& lo, const glm::vec3& hi) const;
+	unsigned batchMaskScalar(size_t first, const glm::vec3& p, const glm::vec3& lo, const glm::vec3& hi) const;
+
+	// Calls pred(box, index) for each box of [first, last) containing p, stops at the first true
+	template <typename Pred>
+	bool anyContaining(size_t first, size_t last, const glm::vec3& p,
+		const glm::vec3& lo, const glm::vec3& hi, Pred&& pred) const;
+
+	bool anyContaining(const glm::vec3& p, const glm::vec3& lo, const glm::vec3& hi) const {
+		return anyContaining(0, size(), p, lo, hi, [](const AABB&, int32_t) { return true; });
+	}
+
+private:
+	std::vector<float> minX, minY, minZ;
+	std::vector<float> maxX, maxY, maxZ;
+	std::vector<int32_t> idx;
+	size_t count = 0;
+};
+
+inline AABB AabbSoA::box(size_t i) const {
+	return { glm::vec3(minX[i], minY[i], minZ[i]), glm::vec3(maxX[i], maxY[i], maxZ[i]) };
+}
+
+template <typename Pred>
+bool AabbSoA::anyContaining(size_t first, size_t last, const glm::vec3& p,
+	const glm::vec3& lo, const glm::vec3& hi, Pred&& pred) const {
+	for (size_t b = first; b < last; b += BATCH) {
+		unsigned mask = batchMask(b, p, lo, hi);
+		if (last - b < BATCH) mask &= (1u << (last - b)) - 1; // lanes past the range
+		while (mask) {
+			int lane = 0;
+			while (!(mask & (1u << lane))) lane++;
+			mask &= mask - 1;
+			if (pred(box(b + lane), idx[b + lane])) return true;
+		}
+	}
+	return false;
+}
+
+#endif
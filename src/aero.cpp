@@ -0,0 +1,222 @@
+#include "aero.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+const float AircraftType::AIR_DENSITY = 1.225f;
+const float AircraftType::AERO_STEP_BUDGET_NS = 200.0f;
+
+namespace {
+
+const float DEG = 0.017453292519943295f;
+
+// Built-in jet: linear lift up to the stall, a flap schedule that adds lift and
+// drag below 16 m/s, parabolic drag polar plus a low-speed rise of the zero-lift
+// drag, and a lift break with extra drag past either stall angle
+const float CL0 = 0.25f;
+const float CL_ALPHA = 5.0f;          // per rad
+const float STALL_ALPHA = 14.0f * DEG;
+const float NEG_STALL_ALPHA = -12.0f * DEG;
+const float FLAP_CL = 0.6f, FLAP_CD = 0.04f;
+const float INDUCED_K = 0.06f;
+const float LEVEL_TOP_SPEED = 20.0f;  // full throttle, level flight
+
+float flapFraction(float speed) {
+	return std::min(1.0f, std::max(0.0f, (16.0f - speed) / 6.0f));
+}
+
+float liftCoefficient(float alpha, float speed) {
+	float base = CL0 + FLAP_CL * flapFraction(speed);
+	if (alpha > STALL_ALPHA) {
+		float peak = base + CL_ALPHA * STALL_ALPHA;
+		return std::max(peak - 2.0f * (alpha - STALL_ALPHA), 0.5f * peak);
+	}
+	if (alpha < NEG_STALL_ALPHA) {
+		float peak = base + CL_ALPHA * NEG_STALL_ALPHA;
+		return std::min(peak + 2.0f * (NEG_STALL_ALPHA - alpha), 0.5f * peak);
+	}
+	return base + CL_ALPHA * alpha;
+}
+
+float dragCoefficient(float alpha, float speed) {
+	float cl = liftCoefficient(alpha, speed);
+	float cd = 0.12f + 0.03f * std::exp(-speed / 5.0f) + FLAP_CD * flapFraction(speed) + INDUCED_K * cl * cl;
+	float past = std::max(alpha - STALL_ALPHA, NEG_STALL_ALPHA - alpha);
+	if (past > 0.0f) cd += 1.2f * std::sin(past) * std::sin(past);
+	return cd;
+}
+
+}
+
+std::vector<char> AircraftType::bakeDefaultImage() {
+	const uint32_t na = 76, ns = 41; // -30..45 deg, 0..40 m/s, 1 unit steps
+
+	Header h = {};
+	std::memcpy(h.magic, "AERO", 4);
+	h.version = VERSION;
+	h.alphaMin = -30.0f * DEG;
+	h.alphaStep = 1.0f * DEG;
+	h.speedMin = 0.0f;
+	h.speedStep = 1.0f;
+	h.alphaCount = na;
+	h.speedCount = ns;
+
+	AircraftParams& p = h.params;
+	p.mass = 1000.0f;
+	p.wingArea = 160.0f;
+	p.stallAlpha = STALL_ALPHA;
+	p.minTakeoffSpeed = 10.0f;
+	p.maxSpeed = 24.0f;
+	p.cruiseSpeed = 16.0f;
+	p.rollingFriction = 0.02f;
+	p.brakeDecel = 5.0f;
+
+	std::vector<char> image(sizeof(Header) + size_t(na) * ns * 2 * sizeof(float));
+	float* out = (float*)(image.data() + sizeof(Header));
+	for (uint32_t is = 0; is < ns; is++) {
+		for (uint32_t ia = 0; ia < na; ia++) {
+			float alpha = h.alphaMin + ia * h.alphaStep;
+			float speed = h.speedMin + is * h.speedStep;
+			*out++ = liftCoefficient(alpha, speed);
+			*out++ = dragCoefficient(alpha, speed);
+		}
+	}
+	std::memcpy(image.data(), &h, sizeof(h));
+
+	// Derived speeds come from the sampled tables, as the simulation sees them
+	AircraftType t;
+	t.attach(image.data(), image.size());
+	const float weight = p.mass * 9.81f;
+	auto qS = [&](float v) { return 0.5f * AIR_DENSITY * v * v * p.wingArea; };
+	float cl, cd;
+
+	p.stallSpeed = 40.0f;
+	for (float v = 1.0f; v < 40.0f; v += 0.05f) {
+		t.coefficients(STALL_ALPHA, v, cl, cd);
+		if (qS(v) * cl >= weight) {
+			p.stallSpeed = v;
+			break;
+		}
+	}
+
+	// Thrust that holds LEVEL_TOP_SPEED: drag at the angle of attack where lift carries the weight
+	float alpha = t.levelAlpha(LEVEL_TOP_SPEED, 9.81f);
+	t.coefficients(alpha, LEVEL_TOP_SPEED, cl, cd);
+	p.maxThrust = qS(LEVEL_TOP_SPEED) * cd / std::cos(alpha);
+
+	std::memcpy(image.data(), &h, sizeof(h));
+	return image;
+}
+
+bool AircraftType::bakeDefault(const std::string& path) {
+	std::vector<char> image = bakeDefaultImage();
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cerr << "Cannot write aircraft type " << path << "\n";
+		return false;
+	}
+	out.write(image.data(), image.size());
+	return bool(out);
+}
+
+bool AircraftType::attach(const void* data, size_t size) {
+	header = nullptr;
+	pairs = nullptr;
+	const Header* h = (const Header*)data;
+	if (size < sizeof(Header) || std::memcmp(h->magic, "AERO", 4) != 0 || h->version != VERSION ||
+		h->alphaCount < 2 || h->speedCount < 2 || !(h->alphaStep > 0.0f) || !(h->speedStep > 0.0f)) {
+		return false;
+	}
+	if (size != sizeof(Header) + size_t(h->alphaCount) * h->speedCount * 2 * sizeof(float)) return false;
+
+	header = h;
+	pairs = (const float*)(h + 1);
+	invAlphaStep = 1.0f / h->alphaStep;
+	invSpeedStep = 1.0f / h->speedStep;
+	return true;
+}
+
+bool AircraftType::load(const std::string& path) {
+	memory.clear();
+	if (!file.open(path)) {
+		header = nullptr;
+		return false;
+	}
+	if (!attach(file.data(), file.size())) {
+		file.close();
+		return false;
+	}
+	return true;
+}
+
+void AircraftType::loadOrBake(const std::string& path) {
+	if (load(path)) return;
+	std::cout << "Baking " << path << "..." << std::endl;
+	if (bakeDefault(path) && load(path)) return;
+
+	file.close();
+	memory = bakeDefaultImage();
+	attach(memory.data(), memory.size());
+}
+
+void AircraftType::airborneRates(float speed, float pathPitch, float pitch, float throttle, float gravity,
+	float& dSpeed, float& dPathPitch) const {
+	const AircraftParams& p = header->params;
+	float alpha = pathPitch - pitch;
+	float cl, cd;
+	coefficients(alpha, speed, cl, cd);
+
+	float qS = 0.5f * AIR_DENSITY * speed * speed * p.wingArea;
+	float thrust = throttle * p.maxThrust;
+	float invMass = 1.0f / p.mass;
+	dSpeed = (thrust * std::cos(alpha) - qS * cd) * invMass + gravity * std::sin(pathPitch);
+	// Lift and the thrust component across the path turn it; below 1 m/s the turn rate is capped
+	dPathPitch = (gravity * std::cos(pathPitch) - (qS * cl + thrust * std::sin(alpha)) * invMass) / std::max(speed, 1.0f);
+}
+
+float AircraftType::groundAccel(float speed, float pitch, float throttle, float gravity) const {
+	const AircraftParams& p = header->params;
+	float cl, cd;
+	coefficients(-pitch, speed, cl, cd);
+
+	float qS = 0.5f * AIR_DENSITY * speed * speed * p.wingArea;
+	float accel = (throttle * p.maxThrust - qS * cd) / p.mass;
+	if (speed > 0.0f) {
+		accel -= p.rollingFriction * gravity;
+		if (throttle <= 0.0f) accel -= p.brakeDecel;
+	}
+	return accel;
+}
+
+float AircraftType::levelAlpha(float speed, float gravity) const {
+	const AircraftParams& p = header->params;
+	float weight = p.mass * gravity;
+	float qS = 0.5f * AIR_DENSITY * speed * speed * p.wingArea;
+	float lo = header->alphaMin, hi = p.stallAlpha, cl, cd;
+	for (int i = 0; i < 32; i++) {
+		float mid = 0.5f * (lo + hi);
+		coefficients(mid, speed, cl, cd);
+		(qS * cl < weight ? lo : hi) = mid;
+	}
+	return hi;
+}
+
+bool AircraftType::levelTrim(float speed, float gravity, float& alpha, float& throttle) const {
+	const AircraftParams& p = header->params;
+	alpha = levelAlpha(speed, gravity);
+	float cl, cd;
+	coefficients(alpha, speed, cl, cd);
+	float qS = 0.5f * AIR_DENSITY * speed * speed * p.wingArea;
+	throttle = qS * cd / std::cos(alpha) / p.maxThrust;
+	bool ok = qS * cl >= 0.999f * p.mass * gravity && throttle <= 1.0f;
+	throttle = std::min(throttle, 1.0f);
+	return ok;
+}
+
+AircraftType::Grid AircraftType::grid() const {
+	return { pairs, header->alphaMin, invAlphaStep, header->speedMin, invSpeedStep,
+		(int)header->alphaCount, (int)header->speedCount };
+}
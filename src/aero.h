@@ -0,0 +1,113 @@
+#ifndef AERO_H
+#define AERO_H
+
+#include "mappedfile.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Scalar parameters of one aircraft type, stored in the header of its file
+struct AircraftParams {
+	float mass;            // kg
+	float wingArea;        // m^2
+	float maxThrust;       // N at full throttle
+	float stallAlpha;      // rad, lift breaks down above this angle of attack
+	float stallSpeed;      // m/s, slowest level flight at the best angle of attack
+	float minTakeoffSpeed; // m/s, the nose can be raised on the ground from here
+	float maxSpeed;        // m/s, hard limit, dives included
+	float cruiseSpeed;     // m/s, AI traffic spawns at it
+	float rollingFriction; // ground friction coefficient
+	float brakeDecel;      // m/s^2, wheel brakes while the throttle is closed
+};
+
+// An aircraft type: parameters plus lift and drag coefficient tables over angle
+// of attack x airspeed. Baked into a small binary file and memory-mapped; a
+// lookup is a bilinear blend of four (CL, CD) pairs stored side by side.
+//
+// Budget: one airborne step (both lookups and the force balance) should stay
+// under AERO_STEP_BUDGET_NS per aircraft; --bench-flight checks it.
+class AircraftType {
+public:
+	static const float AIR_DENSITY;        // kg/m^3, sea level
+	static const float AERO_STEP_BUDGET_NS;
+
+	// Samples the built-in jet model into path; its speeds are derived from the tables
+	static bool bakeDefault(const std::string& path);
+
+	// Maps a baked file; false if missing or damaged
+	bool load(const std::string& path);
+	// load(), else bakeDefault() and load(), else the default model in memory
+	void loadOrBake(const std::string& path);
+	bool loaded() const { return header != nullptr; }
+	size_t fileBytes() const { return file.size() + memory.size(); } // mapped, or the copy in memory
+
+	const AircraftParams& params() const { return header->params; }
+
+	// Bilinear CL and CD; outside the tables the border values are extended
+	void coefficients(float alpha, float speed, float& cl, float& cd) const;
+
+	// Along-path and path-angle accelerations of an airborne aircraft. pathPitch
+	// has the sign convention of pitch (positive descends), alpha = pathPitch - pitch.
+	void airborneRates(float speed, float pathPitch, float pitch, float throttle, float gravity,
+		float& dSpeed, float& dPathPitch) const;
+
+	// Acceleration while rolling on the ground, brakes included
+	float groundAccel(float speed, float pitch, float throttle, float gravity) const;
+
+	// Angle of attack and throttle of steady level flight at speed; false below
+	// the stall speed or beyond full thrust (the values are then clamped)
+	bool levelTrim(float speed, float gravity, float& alpha, float& throttle) const;
+
+	// Raw table access for the batched integrator
+	struct Grid {
+		const float* pairs;    // (CL, CD) per sample, alpha fastest
+		float alphaMin, invAlphaStep;
+		float speedMin, invSpeedStep;
+		int alphaCount, speedCount;
+	};
+	Grid grid() const;
+
+private:
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		AircraftParams params;
+		float alphaMin, alphaStep; // rad
+		float speedMin, speedStep; // m/s
+		uint32_t alphaCount, speedCount;
+	};
+	// followed by float pairs[speedCount][alphaCount][2]: CL, CD
+
+	static const uint32_t VERSION = 1;
+
+	static std::vector<char> bakeDefaultImage();
+	bool attach(const void* data, size_t size);
+	float levelAlpha(float speed, float gravity) const; // lift carries the weight, up to stallAlpha
+
+	MappedFile file;
+	std::vector<char> memory; // used when the file cannot be written
+	const Header* header = nullptr;
+	const float* pairs = nullptr;
+	float invAlphaStep = 1.0f, invSpeedStep = 1.0f;
+};
+
+inline void AircraftType::coefficients(float alpha, float speed, float& cl, float& cd) const {
+	const int na = (int)header->alphaCount, ns = (int)header->speedCount;
+	float fa = glm::clamp((alpha - header->alphaMin) * invAlphaStep, 0.0f, float(na - 1));
+	float fs = glm::clamp((speed - header->speedMin) * invSpeedStep, 0.0f, float(ns - 1));
+	int ia = glm::min(int(fa), na - 2);
+	int is = glm::min(int(fs), ns - 2);
+	float ta = fa - ia, ts = fs - is;
+
+	const float* p0 = pairs + (size_t(is) * na + ia) * 2;
+	const float* p1 = p0 + size_t(na) * 2;
+	float cl0 = p0[0] + (p0[2] - p0[0]) * ta, cl1 = p1[0] + (p1[2] - p1[0]) * ta;
+	float cd0 = p0[1] + (p0[3] - p0[1]) * ta, cd1 = p1[1] + (p1[3] - p1[1]) * ta;
+	cl = cl0 + (cl1 - cl0) * ts;
+	cd = cd0 + (cd1 - cd0) * ts;
+}
+
+#endif
@@ -0,0 +1,111 @@
+#include "assetmemory.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <mutex>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::mutex assetsLock;
+std::map<std::string, AssetMemory> assets;
+
+std::string formatBytes(int64_t bytes) {
+	char buf[32];
+	double v = double(bytes);
+	if (v < 0.0) v = -v;
+	if (v >= 1024.0 * 1024.0) snprintf(buf, sizeof(buf), "%.1f MB", double(bytes) / (1024.0 * 1024.0));
+	else if (v >= 1024.0) snprintf(buf, sizeof(buf), "%.1f kB", double(bytes) / 1024.0);
+	else snprintf(buf, sizeof(buf), "%lld B", (long long)bytes);
+	return buf;
+}
+
+}
+
+void assetMemoryAdd(const std::string& asset, int64_t cpuBytes, int64_t gpuBufferBytes, int64_t gpuTextureBytes, int gpuObjects) {
+	std::lock_guard<std::mutex> guard(assetsLock);
+	AssetMemory& a = assets[asset];
+	a.name = asset;
+	a.cpuBytes += cpuBytes;
+	a.gpuBufferBytes += gpuBufferBytes;
+	a.gpuTextureBytes += gpuTextureBytes;
+	a.gpuObjects += gpuObjects;
+}
+
+std::vector<AssetMemory> assetMemoryReport() {
+	std::vector<AssetMemory> report;
+	{
+		std::lock_guard<std::mutex> guard(assetsLock);
+		for (const auto& it : assets) {
+			if (it.second.total() != 0) report.push_back(it.second);
+		}
+	}
+	std::stable_sort(report.begin(), report.end(),
+		[](const AssetMemory& a, const AssetMemory& b) { return a.total() > b.total(); });
+	return report;
+}
+
+AssetMemory assetMemoryTotal() {
+	AssetMemory total;
+	total.name = "total";
+	std::lock_guard<std::mutex> guard(assetsLock);
+	for (const auto& it : assets) {
+		total.cpuBytes += it.second.cpuBytes;
+		total.gpuBufferBytes += it.second.gpuBufferBytes;
+		total.gpuTextureBytes += it.second.gpuTextureBytes;
+		total.gpuObjects += it.second.gpuObjects;
+	}
+	return total;
+}
+
+size_t processResidentBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return counters.WorkingSetSize;
+#else
+	FILE* f = fopen("/proc/self/statm", "r");
+	if (!f) return 0;
+	unsigned long pages = 0, resident = 0;
+	int read = fscanf(f, "%lu %lu", &pages, &resident);
+	fclose(f);
+	return read == 2 ? size_t(resident) * size_t(sysconf(_SC_PAGESIZE)) : 0;
+#endif
+}
+
+void printAssetMemory(std::ostream& out) {
+	char line[160];
+	snprintf(line, sizeof(line), "%-44s %12s %12s %12s %7s\n", "Asset", "CPU", "GPU buffers", "GPU textures", "objects");
+	out << line;
+	std::vector<AssetMemory> report = assetMemoryReport();
+	report.push_back(assetMemoryTotal());
+	for (const AssetMemory& a : report) {
+		std::string name = a.name.size() > 44 ? "..." + a.name.substr(a.name.size() - 41) : a.name;
+		snprintf(line, sizeof(line), "%-44s %12s %12s %12s %7d\n", name.c_str(), formatBytes(a.cpuBytes).c_str(),
+			formatBytes(a.gpuBufferBytes).c_str(), formatBytes(a.gpuTextureBytes).c_str(), a.gpuObjects);
+		out << line;
+	}
+	size_t rss = processResidentBytes();
+	if (rss) out << "Process resident: " << formatBytes(int64_t(rss)) << "\n";
+}
+
+int64_t textureBytes(int w, int h, int bytesPerPixel, bool mipmapped) {
+	int64_t bytes = 0;
+	for (;;) {
+		bytes += int64_t(w) * h * bytesPerPixel;
+		if (!mipmapped || (w == 1 && h == 1)) break;
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+	}
+	return bytes;
+}
@@ -0,0 +1,46 @@
+#ifndef ASSETMEMORY_H
+#define ASSETMEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Memory held by one loaded asset (a model, a texture file, a render target)
+struct AssetMemory {
+	std::string name;
+	int64_t cpuBytes = 0;        // heap copies kept after loading
+	int64_t gpuBufferBytes = 0;  // vertex buffers
+	int64_t gpuTextureBytes = 0; // textures and render buffers, all mip levels
+	int gpuObjects = 0;          // GL buffers and textures
+
+	int64_t total() const { return cpuBytes + gpuBufferBytes + gpuTextureBytes; }
+};
+
+// Loaders report what they allocate and free; negative values release. Safe
+// to call from any thread.
+void assetMemoryAdd(const std::string& asset, int64_t cpuBytes, int64_t gpuBufferBytes, int64_t gpuTextureBytes, int gpuObjects = 0);
+
+// Every asset that still holds memory, largest total first
+std::vector<AssetMemory> assetMemoryReport();
+AssetMemory assetMemoryTotal();
+
+// Resident set of the whole process, 0 if unknown
+size_t processResidentBytes();
+
+// The table of assetMemoryReport with totals and the process RSS
+void printAssetMemory(std::ostream& out);
+
+// Bytes of a texture of w x h, with its full mip chain if mipmapped
+int64_t textureBytes(int w, int h, int bytesPerPixel, bool mipmapped);
+
+// Heap bytes held by per-material arrays such as vertsPerMat
+template <typename T>
+int64_t perMaterialBytes(const std::vector<std::vector<T>>& arrays) {
+	int64_t bytes = int64_t(arrays.capacity() * sizeof(std::vector<T>));
+	for (const auto& a : arrays) bytes += int64_t(a.capacity() * sizeof(T));
+	return bytes;
+}
+
+#endif
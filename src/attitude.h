@@ -0,0 +1,81 @@
+#ifndef ATTITUDE_H
+#define ATTITUDE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cmath>
+
+// Orientation of an aircraft as a unit quaternion, model space to world: +z is
+// the nose, +y the canopy, +x the left wing. The angles below use the old Euler
+// convention Ry(yaw) Rx(pitch) Rz(roll), positive pitch puts the nose down;
+// they are read back for the controls and never integrated themselves.
+
+inline glm::quat attitudeFromEuler(float yaw, float pitch, float roll) {
+	return glm::angleAxis(yaw, glm::vec3(0, 1, 0))
+		* glm::angleAxis(pitch, glm::vec3(1, 0, 0))
+		* glm::angleAxis(roll, glm::vec3(0, 0, 1));
+}
+
+// Body axes in world space, closed form of q * axis
+inline glm::vec3 attitudeForward(const glm::quat& q) {
+	return glm::vec3(2.0f * (q.x * q.z + q.w * q.y), 2.0f * (q.y * q.z - q.w * q.x), 1.0f - 2.0f * (q.x * q.x + q.y * q.y));
+}
+
+inline glm::vec3 attitudeSide(const glm::quat& q) {
+	return glm::vec3(1.0f - 2.0f * (q.y * q.y + q.z * q.z), 2.0f * (q.x * q.y + q.w * q.z), 2.0f * (q.x * q.z - q.w * q.y));
+}
+
+inline glm::vec3 attitudeUp(const glm::quat& q) {
+	return glm::vec3(2.0f * (q.x * q.y - q.w * q.z), 1.0f - 2.0f * (q.x * q.x + q.z * q.z), 2.0f * (q.y * q.z + q.w * q.x));
+}
+
+// Unit direction of motion: the nose's heading, tilted by the flight path
+// angle (signed like pitch, positive descends)
+inline glm::vec3 flightDirection(const glm::quat& q, float pathPitch) {
+	glm::vec3 nose = attitudeForward(q);
+	glm::vec2 heading = glm::normalize(glm::vec2(nose.x, nose.z));
+	return glm::vec3(heading.x * cosf(pathPitch), -sinf(pathPitch), heading.y * cosf(pathPitch));
+}
+
+// Heading of the nose, 0 along +z
+inline float attitudeYaw(const glm::quat& q) {
+	glm::vec3 f = attitudeForward(q);
+	return std::atan2(f.x, f.z);
+}
+
+inline float attitudePitch(const glm::quat& q) {
+	return std::asin(glm::clamp(-attitudeForward(q).y, -1.0f, 1.0f));
+}
+
+inline float attitudeRoll(const glm::quat& q) {
+	return std::atan2(attitudeSide(q).y, attitudeUp(q).y);
+}
+
+// One step of the angular rates: yawRate about the world vertical, body.x
+// (pitch) and body.z (roll) about the aircraft's own axes, all in rad/s.
+// First order, renormalized; the same arithmetic as the SIMD flight batch.
+inline glm::quat integrateAttitude(const glm::quat& q, float yawRate, const glm::vec3& body, float dt) {
+	glm::vec3 w = glm::vec3(0.0f, yawRate, 0.0f) + attitudeSide(q) * body.x + attitudeForward(q) * body.z;
+	float h = 0.5f * dt;
+	glm::quat r;
+	r.w = q.w - h * (w.x * q.x + w.y * q.y + w.z * q.z);
+	r.x = q.x + h * (w.x * q.w + w.y * q.z - w.z * q.y);
+	r.y = q.y + h * (w.y * q.w + w.z * q.x - w.x * q.z);
+	r.z = q.z + h * (w.z * q.w + w.x * q.y - w.y * q.x);
+	return r * (1.0f / std::sqrt(r.w * r.w + r.x * r.x + r.y * r.y + r.z * r.z));
+}
+
+// Exact changes of the Euler pitch or roll, for limits and assists. Pitch turns
+// about the level wing axis, so it is undefined with the nose straight up or down.
+inline glm::quat attitudePitchBy(const glm::quat& q, float angle) {
+	glm::vec3 f = attitudeForward(q);
+	glm::vec3 axis = glm::normalize(glm::vec3(f.z, 0.0f, -f.x));
+	return glm::angleAxis(angle, axis) * q;
+}
+
+inline glm::quat attitudeRollBy(const glm::quat& q, float angle) {
+	return q * glm::angleAxis(angle, glm::vec3(0, 0, 1));
+}
+
+#endif
@@ -0,0 +1,470 @@
+#include "benchmarks.h"
+#include "bvh.h"
+#include "uniformgrid.h"
+#include "meshbvh.h"
+#include "aabbsoa.h"
+#include "collisionworld.h"
+#include "flightsoa.h"
+#include "attitude.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+using BenchClock = std::chrono::steady_clock;
+
+double secondsSince(BenchClock::time_point start) {
+	return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// City-like layout: boxes of building size spread over an area that grows with
+// the count, so density (and the number of hits per query) stays comparable
+std::vector<AABB> makeRandomBoxes(int count, float& side, unsigned seed) {
+	std::mt19937 rng(seed);
+	side = std::sqrt(float(count)) * 30.0f;
+	std::uniform_real_distribution<float> pos(0.0f, side);
+	std::uniform_real_distribution<float> size(2.0f, 20.0f);
+	std::uniform_real_distribution<float> height(5.0f, 120.0f);
+
+	std::vector<AABB> boxes(count);
+	for (auto& b : boxes) {
+		glm::vec3 p(pos(rng), 0.0f, pos(rng));
+		b.min = p;
+		b.max = p + glm::vec3(size(rng), height(rng), size(rng));
+	}
+	return boxes;
+}
+
+struct Queries {
+	std::vector<glm::vec3> points;
+	std::vector<glm::vec3> segEnd;
+	std::vector<AABB> boxes;
+};
+
+Queries makeQueries(int count, float side, unsigned seed) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> pos(0.0f, side);
+	std::uniform_real_distribution<float> alt(0.0f, 130.0f);
+	std::uniform_real_distribution<float> step(-10.0f, 10.0f);
+
+	Queries q;
+	for (int i = 0; i < count; i++) {
+		glm::vec3 p(pos(rng), alt(rng), pos(rng));
+		q.points.push_back(p);
+		q.segEnd.push_back(p + glm::vec3(step(rng), step(rng), step(rng)));
+		q.boxes.push_back({ p - glm::vec3(5.0f), p + glm::vec3(5.0f) });
+	}
+	return q;
+}
+
+void addQuad(std::vector<glm::vec3>& tv, glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::vec3 d) {
+	tv.insert(tv.end(), { a, b, c, a, c, d });
+}
+
+// Gabled houses: a box body plus a ridge roof, so a good part of every
+// bounding box (under the roof slopes) is empty space
+void makeGabledCity(int count, float& side, std::vector<AABB>& boxes, std::vector<glm::vec3>& tris) {
+	std::mt19937 rng(4321u);
+	side = std::sqrt(float(count)) * 30.0f;
+	std::uniform_real_distribution<float> pos(0.0f, side);
+	std::uniform_real_distribution<float> size(6.0f, 20.0f);
+	std::uniform_real_distribution<float> height(5.0f, 60.0f);
+
+	for (int i = 0; i < count; i++) {
+		glm::vec3 lo(pos(rng), 0.0f, pos(rng));
+		glm::vec3 hi = lo + glm::vec3(size(rng), height(rng), size(rng));
+		float ridgeY = hi.y + 0.5f * (hi.z - lo.z);
+		float midZ = 0.5f * (lo.z + hi.z);
+
+		addQuad(tris, { lo.x, lo.y, lo.z }, { hi.x, lo.y, lo.z }, { hi.x, hi.y, lo.z }, { lo.x, hi.y, lo.z });
+		addQuad(tris, { lo.x, lo.y, hi.z }, { hi.x, lo.y, hi.z }, { hi.x, hi.y, hi.z }, { lo.x, hi.y, hi.z });
+		addQuad(tris, { lo.x, lo.y, lo.z }, { lo.x, lo.y, hi.z }, { lo.x, hi.y, hi.z }, { lo.x, hi.y, lo.z });
+		addQuad(tris, { hi.x, lo.y, lo.z }, { hi.x, lo.y, hi.z }, { hi.x, hi.y, hi.z }, { hi.x, hi.y, lo.z });
+		addQuad(tris, { lo.x, hi.y, lo.z }, { hi.x, hi.y, lo.z }, { hi.x, ridgeY, midZ }, { lo.x, ridgeY, midZ });
+		addQuad(tris, { lo.x, hi.y, hi.z }, { hi.x, hi.y, hi.z }, { hi.x, ridgeY, midZ }, { lo.x, ridgeY, midZ });
+		tris.insert(tris.end(), { glm::vec3(lo.x, hi.y, lo.z), glm::vec3(lo.x, hi.y, hi.z), glm::vec3(lo.x, ridgeY, midZ) });
+		tris.insert(tris.end(), { glm::vec3(hi.x, hi.y, lo.z), glm::vec3(hi.x, hi.y, hi.z), glm::vec3(hi.x, ridgeY, midZ) });
+
+		boxes.push_back({ lo, glm::vec3(hi.x, ridgeY, hi.z) });
+	}
+}
+
+struct Checksum {
+	long long hits = 0;
+	double tSum = 0.0;
+};
+
+}
+
+int runMeshBenchmark() {
+	const int sizes[] = { 1000, 10000, 100000 };
+	const int queries = 200000;
+
+	printf("%-9s %-8s %14s %14s %12s\n", "houses", "query", "aabb q/s", "mesh q/s", "rejected");
+	for (int n : sizes) {
+		float side;
+		std::vector<AABB> boxes;
+		std::vector<glm::vec3> tris;
+		makeGabledCity(n, side, boxes, tris);
+
+		UniformGrid grid;
+		grid.build(boxes, glm::vec2(0.0f), glm::vec2(side));
+		Bvh bvh;
+		bvh.build(boxes);
+		auto t0 = BenchClock::now();
+		MeshBvh mesh;
+		mesh.build(tris);
+		double buildSec = secondsSince(t0);
+
+		// Points are spread through the buildings' boxes so most of them land inside one
+		Queries q;
+		q.points.resize(queries);
+		q.segEnd.resize(queries);
+		for (int i = 0; i < queries; i++) {
+			const AABB& b = boxes[i % n];
+			glm::vec3 f(float(i % 7) / 7.0f, float(i % 11) / 11.0f, float(i % 13) / 13.0f);
+			q.points[i] = b.min + (b.max - b.min) * f;
+			q.segEnd[i] = q.points[i] + glm::vec3(float(i % 5) - 2.0f, float(i % 3) - 1.0f, float(i % 9) - 4.0f) * 3.0f;
+		}
+
+		// --- point: box only vs box + upward ray against the mesh ---
+		long long boxHits = 0, meshHits = 0;
+		t0 = BenchClock::now();
+		for (int i = 0; i < queries; i++) {
+			const glm::vec3& p = q.points[i];
+			boxHits += grid.anyInCell(p, glm::vec3(0.0f), glm::vec3(0.0f), [](const AABB&, int) { return true; });
+		}
+		double boxSec = secondsSince(t0);
+		t0 = BenchClock::now();
+		for (int i = 0; i < queries; i++) {
+			const glm::vec3& p = q.points[i];
+			meshHits += grid.anyInCell(p, glm::vec3(0.0f), glm::vec3(0.0f), [&](const AABB& b, int) {
+				return mesh.anyHit(p, glm::vec3(p.x, b.max.y + 0.01f, p.z));
+			});
+		}
+		double meshSec = secondsSince(t0);
+		printf("%-9d %-8s %14.0f %14.0f %11.1f%%\n", n, "point", queries / boxSec, queries / meshSec,
+			boxHits ? 100.0 * (boxHits - meshHits) / boxHits : 0.0);
+
+		// --- segment: first box vs first triangle ---
+		boxHits = meshHits = 0;
+		t0 = BenchClock::now();
+		for (int i = 0; i < queries; i++) {
+			BvhHit hit;
+			boxHits += bvh.firstHit(q.points[i], q.segEnd[i], hit);
+		}
+		boxSec = secondsSince(t0);
+		t0 = BenchClock::now();
+		for (int i = 0; i < queries; i++) {
+			BvhHit hit;
+			MeshHit mhit;
+			meshHits += bvh.firstHit(q.points[i], q.segEnd[i], hit) && mesh.firstHit(q.points[i], q.segEnd[i], mhit);
+		}
+		meshSec = secondsSince(t0);
+		printf("%-9d %-8s %14.0f %14.0f %11.1f%%\n", n, "segment", queries / boxSec, queries / meshSec,
+			boxHits ? 100.0 * (boxHits - meshHits) / boxHits : 0.0);
+
+		printf("%-9d %zu triangles, mesh build %.1f ms\n\n", n, mesh.triangleCount(), buildSec * 1e3);
+	}
+	return 0;
+}
+
+int runAabbKernelBenchmark() {
+	const int sizes[] = { 8, 64, 1024, 65536 };
+
+	// The margin variants used by checkCollision, isOnRunway and isInLandingApproach
+	struct Variant { const char* name; glm::vec3 lo, hi; };
+	const Variant variants[] = {
+		{ "city", glm::vec3(0.0f), glm::vec3(0.0f) },
+		{ "core", glm::vec3(1.0f), glm::vec3(-1.0f) },
+		{ "runway", glm::vec3(0.0f, -2.0f, 0.0f), glm::vec3(0.0f, 3.0f, 0.0f) },
+		{ "approach", glm::vec3(-50.0f, -10.0f, -50.0f), glm::vec3(50.0f, 20.0f, 50.0f) },
+	};
+
+	printf("%-7s %-9s %10s %10s %10s %9s\n", "boxes", "variant", "aos ns", "scalar ns", "simd ns", "mismatch");
+	for (int n : sizes) {
+		float side;
+		std::vector<AABB> boxes = makeRandomBoxes(n, side, 555u);
+		const int queries = std::min(100000, 100000000 / n);
+		AabbSoA soa;
+		for (int i = 0; i < n; i++) soa.append(boxes[i], i);
+		soa.seal();
+		Queries q = makeQueries(queries, side, 556u);
+
+		for (const Variant& v : variants) {
+			// Reference: the original array-of-structs loop with the margins written out
+			std::vector<int> ref(queries);
+			auto t0 = BenchClock::now();
+			for (int i = 0; i < queries; i++) {
+				const glm::vec3& p = q.points[i];
+				ref[i] = 0;
+				for (const auto& b : boxes) {
+					if (p.x > b.min.x + v.lo.x && p.x < b.max.x + v.hi.x &&
+						p.y > b.min.y + v.lo.y && p.y < b.max.y + v.hi.y &&
+						p.z > b.min.z + v.lo.z && p.z < b.max.z + v.hi.z) { ref[i] = 1; break; }
+				}
+			}
+			double aosNs = secondsSince(t0) * 1e9 / queries;
+
+			int mismatches = 0;
+			t0 = BenchClock::now();
+			for (int i = 0; i < queries; i++) {
+				int hit = 0;
+				for (size_t b = 0; b < soa.size() && !hit; b += AabbSoA::BATCH) {
+					unsigned mask = soa.batchMaskScalar(b, q.points[i], v.lo, v.hi);
+					if (soa.size() - b < AabbSoA::BATCH) mask &= (1u << (soa.size() - b)) - 1;
+					hit = mask != 0;
+				}
+				mismatches += hit != ref[i];
+			}
+			double scalarNs = secondsSince(t0) * 1e9 / queries;
+
+			t0 = BenchClock::now();
+			for (int i = 0; i < queries; i++) {
+				mismatches += int(soa.anyContaining(q.points[i], v.lo, v.hi)) != ref[i];
+			}
+			double simdNs = secondsSince(t0) * 1e9 / queries;
+
+			printf("%-7d %-9s %10.1f %10.1f %10.1f %9d\n", n, v.name, aosNs, scalarNs, simdNs, mismatches);
+		}
+	}
+	return 0;
+}
+
+int runBatchBenchmark() {
+	const int counts[] = { 1000, 10000, 100000 };
+	const float dt = 1.0f / 120.0f;
+
+	float side;
+	std::vector<AABB> boxes = makeRandomBoxes(100000, side, 777u);
+	Bvh bvh;
+	bvh.build(boxes);
+	UniformGrid grid;
+	grid.build(boxes, glm::vec2(0.0f), glm::vec2(side));
+
+	// City only: no airport, no meshes (box narrow phase)
+	CollisionWorld world;
+	world.cityGrid = &grid;
+	world.cityBvh = &bvh;
+	world.airportCenter = glm::vec3(-1e6f);
+
+	printf("100k boxes, %d job threads, point + swept test per aircraft\n", sharedJobs().threadCount());
+	printf("%-8s %12s %12s %12s %9s\n", "aircraft", "loop q/s", "sorted q/s", "parallel q/s", "mismatch");
+	for (int n : counts) {
+		std::mt19937 rng(778u);
+		std::uniform_real_distribution<float> pos(0.0f, side);
+		std::uniform_real_distribution<float> alt(0.0f, 130.0f);
+		std::uniform_real_distribution<float> vel(-20.0f, 20.0f);
+		std::vector<CollisionQuery> queries(n);
+		for (auto& q : queries) {
+			q.pos = glm::vec3(pos(rng), alt(rng), pos(rng));
+			q.velocity = glm::vec3(vel(rng), vel(rng) * 0.25f, vel(rng));
+			q.flags = QUERY_SWEEP;
+		}
+
+		// Enough repetitions for about a million queries per column
+		const int reps = std::max(1, 1000000 / n);
+		std::vector<CollisionResult> ref(n), sorted(n), parallel(n);
+
+		auto t0 = BenchClock::now();
+		for (int r = 0; r < reps; r++) {
+			for (int i = 0; i < n; i++) ref[i] = collide(world, queries[i], dt);
+		}
+		double loopQps = double(n) * reps / secondsSince(t0);
+
+		t0 = BenchClock::now();
+		for (int r = 0; r < reps; r++) collideBatch(world, queries.data(), sorted.data(), n, dt);
+		double sortedQps = double(n) * reps / secondsSince(t0);
+
+		t0 = BenchClock::now();
+		for (int r = 0; r < reps; r++) collideBatch(world, queries.data(), parallel.data(), n, dt, &sharedJobs());
+		double parallelQps = double(n) * reps / secondsSince(t0);
+
+		int mismatches = 0;
+		for (int i = 0; i < n; i++) {
+			mismatches += ref[i].hit != sorted[i].hit || ref[i].t != sorted[i].t;
+			mismatches += ref[i].hit != parallel[i].hit || ref[i].t != parallel[i].t;
+		}
+		printf("%-8d %12.0f %12.0f %12.0f %9d\n", n, loopQps, sortedQps, parallelQps, mismatches);
+	}
+	return 0;
+}
+
+int runFlightBenchmark() {
+	const int counts[] = { 8, 1024, 65536 };
+	const float dt = 1.0f / 120.0f;
+	const int steps = 240; // 2 s of flight
+	AircraftType type;
+	type.loadOrBake("jet.aero"); // the simulator's aircraft type
+	const FlightParams params = { &type, 1.0f, 9.81f, glm::radians(55.0f), 2.5f, glm::radians(85.0f),
+		glm::radians(180.0f), glm::radians(60.0f) };
+
+	printf("%d steps of %.4f s, slow aircraft stall, budget %.0f ns per aircraft step\n",
+		steps, dt, AircraftType::AERO_STEP_BUDGET_NS);
+	printf("%-8s %12s %12s %9s %12s %12s\n", "aircraft", "scalar ns", "simd ns", "speedup", "max dpos m", "max dangle");
+	bool overBudget = false;
+	for (int n : counts) {
+		std::mt19937 rng(4242u);
+		std::uniform_real_distribution<float> u(0.0f, 1.0f);
+		FlightSoA ref;
+		ref.resize(n);
+		for (int i = 0; i < n; i++) {
+			ref.posX[i] = u(rng) * 2000.0f;
+			ref.posY[i] = 20.0f + u(rng) * 150.0f;
+			ref.posZ[i] = u(rng) * 2000.0f;
+			float yaw = (u(rng) - 0.5f) * 12.0f;
+			float pitch = (u(rng) - 0.5f) * 1.2f;
+			float roll = (u(rng) - 0.5f) * 0.6f;
+			glm::quat q = attitudeFromEuler(yaw, pitch, roll);
+			ref.qw[i] = q.w;
+			ref.qx[i] = q.x;
+			ref.qy[i] = q.y;
+			ref.qz[i] = q.z;
+			ref.speed[i] = u(rng) * 20.0f;
+			ref.pathPitch[i] = (u(rng) - 0.5f) * 0.6f;
+			ref.throttle[i] = u(rng);
+			ref.targetThrottle[i] = u(rng);
+			ref.targetYawRate[i] = (u(rng) - 0.5f) * 2.0f;
+			ref.pitchRate[i] = (u(rng) - 0.5f) * 0.4f;
+		}
+		FlightSoA simd = ref;
+
+		// Enough repetitions for a few million aircraft steps per column
+		const int reps = std::max(1, 4000000 / (n * steps));
+		FlightSoA a = ref;
+		auto t0 = BenchClock::now();
+		for (int r = 0; r < reps; r++) {
+			a = ref;
+			for (int s = 0; s < steps; s++) integrateFlightReference(a, dt, params);
+		}
+		double scalarNs = secondsSince(t0) * 1e9 / (double(n) * steps * reps);
+
+		FlightSoA b = simd;
+		t0 = BenchClock::now();
+		for (int r = 0; r < reps; r++) {
+			b = simd;
+			for (int s = 0; s < steps; s++) integrateFlight(b, dt, params);
+		}
+		double simdNs = secondsSince(t0) * 1e9 / (double(n) * steps * reps);
+
+		float dPos = 0.0f, dAngle = 0.0f;
+		for (int i = 0; i < n; i++) {
+			dPos = std::max(dPos, glm::length(glm::vec3(a.posX[i] - b.posX[i], a.posY[i] - b.posY[i], a.posZ[i] - b.posZ[i])));
+			// Angle of the rotation between the two attitudes
+			glm::quat qa(a.qw[i], a.qx[i], a.qy[i], a.qz[i]), qb(b.qw[i], b.qx[i], b.qy[i], b.qz[i]);
+			glm::quat d = glm::inverse(qa) * qb;
+			dAngle = std::max(dAngle, 2.0f * std::asin(glm::min(1.0f, glm::length(glm::vec3(d.x, d.y, d.z)))));
+			dAngle = std::max(dAngle, std::fabs(a.pathPitch[i] - b.pathPitch[i]));
+		}
+		printf("%-8d %12.1f %12.1f %8.1fx %12.2e %12.2e\n", n, scalarNs, simdNs, scalarNs / simdNs, dPos, dAngle);
+		overBudget |= scalarNs > AircraftType::AERO_STEP_BUDGET_NS;
+	}
+	printf("Scalar step %s the budget\n", overBudget ? "EXCEEDS" : "is within");
+	return overBudget ? 1 : 0;
+}
+
+int runBvhBenchmark() {
+	const int sizes[] = { 1000, 100000, 1000000 };
+	const int bvhQueries = 200000;
+
+	printf("%-9s %-8s %12s %12s %9s\n", "boxes", "query", "linear ns", "bvh ns", "speedup");
+	for (int n : sizes) {
+		float side;
+		std::vector<AABB> boxes = makeRandomBoxes(n, side, 1234u);
+
+		auto t0 = BenchClock::now();
+		Bvh bvh;
+		bvh.build(boxes);
+		double buildSec = secondsSince(t0);
+
+		// The linear scan gets fewer queries at large sizes so the run stays short
+		int linearQueries = (int)std::min<long long>(bvhQueries, 200000000LL / n);
+		Queries q = makeQueries(bvhQueries, side, 99u);
+
+		// --- point ---
+		Checksum lin, acc;
+		t0 = BenchClock::now();
+		for (int i = 0; i < linearQueries; i++) {
+			for (const auto& b : boxes) {
+				if (aabbContains(b, q.points[i])) { lin.hits++; break; }
+			}
+		}
+		double linNs = secondsSince(t0) * 1e9 / linearQueries;
+		t0 = BenchClock::now();
+		for (int i = 0; i < bvhQueries; i++) {
+			const glm::vec3& p = q.points[i];
+			if (bvh.anyContaining(p, [&](const AABB& b, int) { return aabbContains(b, p); }))
+				acc.hits += i < linearQueries;
+		}
+		double bvhNs = secondsSince(t0) * 1e9 / bvhQueries;
+		printf("%-9d %-8s %12.1f %12.1f %8.1fx%s\n", n, "point", linNs, bvhNs, linNs / bvhNs,
+			lin.hits == acc.hits ? "" : "  MISMATCH");
+
+		// Same point queries through the XZ grid broadphase (reported in the bvh column)
+		UniformGrid grid;
+		grid.build(boxes, glm::vec2(0.0f), glm::vec2(side));
+		acc = Checksum();
+		t0 = BenchClock::now();
+		for (int i = 0; i < bvhQueries; i++) {
+			const glm::vec3& p = q.points[i];
+			if (grid.anyInCell(p, glm::vec3(0.0f), glm::vec3(0.0f), [](const AABB&, int) { return true; }))
+				acc.hits += i < linearQueries;
+		}
+		double gridNs = secondsSince(t0) * 1e9 / bvhQueries;
+		printf("%-9d %-8s %12.1f %12.1f %8.1fx%s\n", n, "grid", linNs, gridNs, linNs / gridNs,
+			lin.hits == acc.hits ? "" : "  MISMATCH");
+
+		// --- segment (earliest hit) ---
+		lin = Checksum(); acc = Checksum();
+		t0 = BenchClock::now();
+		for (int i = 0; i < linearQueries; i++) {
+			glm::vec3 a = q.points[i];
+			glm::vec3 invDir = aabbInvDir(q.segEnd[i] - a);
+			float best = 2.0f;
+			for (const auto& b : boxes) {
+				float t;
+				if (aabbRaySlab(b, a, invDir, 1.0f, t) && t < best) best = t;
+			}
+			if (best <= 1.0f) { lin.hits++; lin.tSum += best; }
+		}
+		linNs = secondsSince(t0) * 1e9 / linearQueries;
+		t0 = BenchClock::now();
+		for (int i = 0; i < bvhQueries; i++) {
+			BvhHit hit;
+			if (bvh.firstHit(q.points[i], q.segEnd[i], hit) && i < linearQueries) {
+				acc.hits++;
+				acc.tSum += hit.t;
+			}
+		}
+		bvhNs = secondsSince(t0) * 1e9 / bvhQueries;
+		printf("%-9d %-8s %12.1f %12.1f %8.1fx%s\n", n, "segment", linNs, bvhNs, linNs / bvhNs,
+			(lin.hits == acc.hits && std::fabs(lin.tSum - acc.tSum) < 1e-3) ? "" : "  MISMATCH");
+
+		// --- box overlap ---
+		lin = Checksum(); acc = Checksum();
+		t0 = BenchClock::now();
+		for (int i = 0; i < linearQueries; i++) {
+			for (const auto& b : boxes) {
+				if (aabbOverlaps(b, q.boxes[i])) { lin.hits++; break; }
+			}
+		}
+		linNs = secondsSince(t0) * 1e9 / linearQueries;
+		t0 = BenchClock::now();
+		for (int i = 0; i < bvhQueries; i++) {
+			const AABB& qb = q.boxes[i];
+			if (bvh.anyOverlapping(qb, [&](const AABB& b, int) { return aabbOverlaps(b, qb); }))
+				acc.hits += i < linearQueries;
+		}
+		bvhNs = secondsSince(t0) * 1e9 / bvhQueries;
+		printf("%-9d %-8s %12.1f %12.1f %8.1fx%s\n", n, "box", linNs, bvhNs, linNs / bvhNs,
+			lin.hits == acc.hits ? "" : "  MISMATCH");
+
+		printf("%-9d build %.1f ms\n\n", n, buildSec * 1e3);
+	}
+	return 0;
+}
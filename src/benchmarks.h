@@ -0,0 +1,13 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+// Standalone benchmarks, started from the command line instead of the simulator
+
+int runBvhBenchmark();  // --bench-bvh
+int runMeshBenchmark(); // --bench-mesh
+int runAabbKernelBenchmark(); // --bench-aabb
+int runBatchBenchmark(); // --bench-batch
+int runCityBenchmark();  // --bench-city (citybench.cpp)
+int runFlightBenchmark(); // --bench-flight
+
+#endif
@@ -0,0 +1,158 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+
+const int BIN_COUNT = 12;
+const int LEAF_SIZE = 4;       // stop splitting at this many boxes
+const float TRAVERSAL_COST = 1.0f; // relative to one box test
+
+struct Bin {
+	AABB bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+	int count = 0;
+};
+
+struct BuildTask {
+	int node;
+	int first;
+	int count;
+	int depth;
+};
+
+}
+
+void Bvh::build(const std::vector<AABB>& input) {
+	nodes.clear();
+	boxes.clear();
+	origIdx.clear();
+	if (input.empty()) return;
+
+	const int n = (int)input.size();
+	std::vector<int32_t> idx(n);
+	std::vector<glm::vec3> centroid(n);
+	for (int i = 0; i < n; i++) {
+		idx[i] = i;
+		centroid[i] = (input[i].min + input[i].max) * 0.5f;
+	}
+
+	nodes.reserve(2 * n / LEAF_SIZE + 1);
+	nodes.push_back({});
+
+	std::vector<BuildTask> tasks;
+	tasks.push_back({ 0, 0, n, 0 });
+	while (!tasks.empty()) {
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+
+		AABB bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+		AABB cbounds = bounds;
+		for (int i = task.first; i < task.first + task.count; i++) {
+			bounds = aabbUnion(bounds, input[idx[i]]);
+			cbounds.min = glm::min(cbounds.min, centroid[idx[i]]);
+			cbounds.max = glm::max(cbounds.max, centroid[idx[i]]);
+		}
+
+		Node& node = nodes[task.node];
+		node.min = bounds.min;
+		node.max = bounds.max;
+		node.leftFirst = task.first;
+		node.count = task.count;
+
+		if (task.count <= LEAF_SIZE || task.depth >= MAX_DEPTH - 2) continue;
+
+		// Binned SAH: try BIN_COUNT - 1 planes on each axis, keep the cheapest
+		int bestAxis = -1, bestSplit = 0;
+		float bestCost = FLT_MAX;
+		glm::vec3 extent = cbounds.max - cbounds.min;
+		for (int axis = 0; axis < 3; axis++) {
+			if (extent[axis] <= 0.0f) continue;
+
+			Bin bins[BIN_COUNT];
+			float k = BIN_COUNT / extent[axis];
+			for (int i = task.first; i < task.first + task.count; i++) {
+				int b = std::min(BIN_COUNT - 1, int((centroid[idx[i]][axis] - cbounds.min[axis]) * k));
+				bins[b].count++;
+				bins[b].bounds = aabbUnion(bins[b].bounds, input[idx[i]]);
+			}
+
+			float leftArea[BIN_COUNT - 1];
+			int leftCount[BIN_COUNT - 1];
+			AABB acc = bins[0].bounds;
+			int cnt = 0;
+			for (int b = 0; b < BIN_COUNT - 1; b++) {
+				acc = aabbUnion(acc, bins[b].bounds);
+				cnt += bins[b].count;
+				leftArea[b] = cnt ? aabbHalfArea(acc) : 0.0f;
+				leftCount[b] = cnt;
+			}
+			acc = bins[BIN_COUNT - 1].bounds;
+			cnt = 0;
+			for (int b = BIN_COUNT - 1; b > 0; b--) {
+				acc = aabbUnion(acc, bins[b].bounds);
+				cnt += bins[b].count;
+				if (cnt == 0 || leftCount[b - 1] == 0) continue;
+				float cost = leftArea[b - 1] * leftCount[b - 1] + aabbHalfArea(acc) * cnt;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+				}
+			}
+		}
+
+		float leafCost = aabbHalfArea(bounds) * task.count;
+		float splitCost = TRAVERSAL_COST * aabbHalfArea(bounds) + bestCost;
+		if (bestAxis < 0 || splitCost >= leafCost) continue;
+
+		float k = BIN_COUNT / extent[bestAxis];
+		float cmin = cbounds.min[bestAxis];
+		auto mid = std::partition(idx.begin() + task.first, idx.begin() + task.first + task.count,
+			[&](int32_t i) {
+				return std::min(BIN_COUNT - 1, int((centroid[i][bestAxis] - cmin) * k)) < bestSplit;
+			});
+		int leftCount = int(mid - (idx.begin() + task.first));
+		if (leftCount == 0 || leftCount == task.count) continue;
+
+		int left = (int)nodes.size();
+		nodes.push_back({});
+		nodes.push_back({});
+		nodes[task.node].leftFirst = left;
+		nodes[task.node].count = 0;
+
+		tasks.push_back({ left, task.first, leftCount, task.depth + 1 });
+		tasks.push_back({ left + 1, task.first + leftCount, task.count - leftCount, task.depth + 1 });
+	}
+
+	boxes.resize(n);
+	origIdx.resize(n);
+	for (int i = 0; i < n; i++) {
+		boxes[i] = input[idx[i]];
+		origIdx[i] = idx[i];
+	}
+}
+
+bool Bvh::firstHit(const glm::vec3& a, const glm::vec3& b, BvhHit& hit) const {
+	glm::vec3 dir = b - a;
+	glm::vec3 invDir = aabbInvDir(dir);
+	float best = 1.0f;
+	int bestIdx = -1; // leaf order
+
+	traverseSegment(a, b, best, [&](int32_t first, int32_t count, float& tMax) {
+		for (int32_t i = first; i < first + count; i++) {
+			float t;
+			if (aabbRaySlab(boxes[i], a, invDir, tMax, t) && (bestIdx < 0 || t < tMax)) {
+				tMax = t;
+				bestIdx = i;
+			}
+		}
+		return false;
+	});
+
+	if (bestIdx < 0) return false;
+	hit.t = best;
+	hit.boxIndex = origIdx[bestIdx];
+	hit.normal = aabbEntryNormal(boxes[bestIdx], a, dir);
+	return true;
+}
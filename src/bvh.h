@@ -0,0 +1,168 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "aabb.h"
+
+#include <vector>
+#include <cstdint>
+
+struct BvhHit {
+	float t;       // fraction along the segment, 0..1
+	int boxIndex;  // index into the array passed to build()
+	glm::vec3 normal; // face of the box entered first, -direction if the segment starts inside
+};
+
+// Bounding volume hierarchy over static boxes, built with a binned surface
+// area heuristic. Leaves keep their boxes in a contiguous array so a query
+// touches as little memory as possible.
+class Bvh {
+public:
+	void build(const std::vector<AABB>& input);
+	bool empty() const { return nodes.empty(); }
+	size_t size() const { return boxes.size(); }
+	size_t memoryBytes() const { return nodes.capacity() * sizeof(Node) + boxes.capacity() * sizeof(AABB) + origIdx.capacity() * sizeof(int32_t); }
+
+	// Calls pred(box, index) for every box whose node contains p, stops at the first true
+	template <typename Pred>
+	bool anyContaining(const glm::vec3& p, Pred&& pred) const;
+
+	// Calls pred(box, index) for every box that may overlap the query, stops at the first true
+	template <typename Pred>
+	bool anyOverlapping(const AABB& query, Pred&& pred) const;
+
+	// Calls leaf(first, count) for every leaf whose node overlaps the query,
+	// ranges in leaf order; returning true stops the walk
+	template <typename LeafFn>
+	bool anyLeafOverlapping(const AABB& query, LeafFn&& leaf) const;
+
+	// Earliest box hit by the segment a->b; false if nothing is hit
+	bool firstHit(const glm::vec3& a, const glm::vec3& b, BvhHit& hit) const;
+
+	// Walks the leaves the segment a->b passes through, nearer ones first.
+	// leaf(first, count, tMax) gets a range in leaf order and may lower tMax
+	// (a fraction of the segment) to cull what is behind; returning true stops the walk.
+	template <typename LeafFn>
+	void traverseSegment(const glm::vec3& a, const glm::vec3& b, float& tMax, LeafFn&& leaf) const;
+
+	// Calls fn(first, count) for every leaf; ranges are in leaf order
+	template <typename Fn>
+	void forEachLeaf(Fn&& fn) const;
+
+	int32_t originalIndex(int32_t leafSlot) const { return origIdx[leafSlot]; }
+
+private:
+	struct Node {
+		glm::vec3 min;
+		int32_t leftFirst; // first child for inner nodes, first box for leaves
+		glm::vec3 max;
+		int32_t count;     // > 0 for leaves
+	};
+
+	static const int MAX_DEPTH = 64;
+
+	std::vector<Node> nodes;
+	std::vector<AABB> boxes;      // leaf order
+	std::vector<int32_t> origIdx; // leaf order -> build() order
+};
+
+template <typename Pred>
+bool Bvh::anyContaining(const glm::vec3& p, Pred&& pred) const {
+	if (nodes.empty()) return false;
+
+	int32_t stack[MAX_DEPTH];
+	int sp = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const Node& n = nodes[stack[--sp]];
+		if (p.x < n.min.x || p.x > n.max.x ||
+			p.y < n.min.y || p.y > n.max.y ||
+			p.z < n.min.z || p.z > n.max.z) continue;
+
+		if (n.count > 0) {
+			for (int32_t i = n.leftFirst; i < n.leftFirst + n.count; i++) {
+				if (pred(boxes[i], origIdx[i])) return true;
+			}
+		}
+		else {
+			stack[sp++] = n.leftFirst;
+			stack[sp++] = n.leftFirst + 1;
+		}
+	}
+	return false;
+}
+
+template <typename Pred>
+bool Bvh::anyOverlapping(const AABB& q, Pred&& pred) const {
+	return anyLeafOverlapping(q, [&](int32_t first, int32_t count) {
+		for (int32_t i = first; i < first + count; i++) {
+			if (pred(boxes[i], origIdx[i])) return true;
+		}
+		return false;
+	});
+}
+
+template <typename LeafFn>
+bool Bvh::anyLeafOverlapping(const AABB& q, LeafFn&& leaf) const {
+	if (nodes.empty()) return false;
+
+	int32_t stack[MAX_DEPTH];
+	int sp = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const Node& n = nodes[stack[--sp]];
+		if (q.max.x < n.min.x || q.min.x > n.max.x ||
+			q.max.y < n.min.y || q.min.y > n.max.y ||
+			q.max.z < n.min.z || q.min.z > n.max.z) continue;
+
+		if (n.count > 0) {
+			if (leaf(n.leftFirst, n.count)) return true;
+		}
+		else {
+			stack[sp++] = n.leftFirst;
+			stack[sp++] = n.leftFirst + 1;
+		}
+	}
+	return false;
+}
+
+template <typename LeafFn>
+void Bvh::traverseSegment(const glm::vec3& a, const glm::vec3& b, float& tMax, LeafFn&& leaf) const {
+	if (nodes.empty()) return;
+
+	glm::vec3 invDir = aabbInvDir(b - a);
+	int32_t stack[MAX_DEPTH];
+	int sp = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const Node& n = nodes[stack[--sp]];
+		float tNode;
+		if (!aabbRaySlab({ n.min, n.max }, a, invDir, tMax, tNode)) continue;
+
+		if (n.count > 0) {
+			if (leaf(n.leftFirst, n.count, tMax)) return;
+			continue;
+		}
+
+		// Visit the nearer child first so later nodes get culled by tMax
+		const Node& l = nodes[n.leftFirst];
+		const Node& r = nodes[n.leftFirst + 1];
+		float tl, tr;
+		bool hl = aabbRaySlab({ l.min, l.max }, a, invDir, tMax, tl);
+		bool hr = aabbRaySlab({ r.min, r.max }, a, invDir, tMax, tr);
+		if (hl && hr) {
+			if (tl <= tr) { stack[sp++] = n.leftFirst + 1; stack[sp++] = n.leftFirst; }
+			else { stack[sp++] = n.leftFirst; stack[sp++] = n.leftFirst + 1; }
+		}
+		else if (hl) stack[sp++] = n.leftFirst;
+		else if (hr) stack[sp++] = n.leftFirst + 1;
+	}
+}
+
+template <typename Fn>
+void Bvh::forEachLeaf(Fn&& fn) const {
+	for (const Node& n : nodes) {
+		if (n.count > 0) fn(n.leftFirst, n.count);
+	}
+}
+
+#endif
@@ -0,0 +1,238 @@
+#include "benchmarks.h"
+#include "citygen.h"
+#include "collisionworld.h"
+#include "gpumodel.h"
+#include "shaderprogram.h"
+#include "simulation.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// City scaling suite: generate, load, build collision structures, query and
+// render procedural cities of growing size. Needs a GL context for the render
+// column only; without one that column is skipped.
+
+namespace {
+
+using BenchClock = std::chrono::steady_clock;
+
+double secondsSince(BenchClock::time_point start) {
+	return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+struct LoadedCity {
+	std::vector<std::vector<float>> verts, norms, uvs; // per material, from loadModel
+	std::vector<int> counts;
+	std::vector<tinyobj::material_t> materials;
+	std::vector<AABB> shapes;                          // one box per OBJ object
+	glm::vec2 minXZ, maxXZ;
+};
+
+// Hidden window + offscreen target, so frames can be timed without showing anything
+struct HeadlessRenderer {
+	GLFWwindow* window = nullptr;
+	GLuint fbo = 0, color = 0, depth = 0;
+	int width = 1280, height = 720;
+
+	bool init() {
+		if (!glfwInit()) return false;
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(width, height, "city bench", nullptr, nullptr);
+		if (!window) return false;
+		glfwMakeContextCurrent(window);
+		if (glewInit() != GLEW_OK) return false;
+
+		sp = new ShaderProgram("v_simplest.glsl", nullptr, "f_simplest.glsl");
+
+		glGenRenderbuffers(1, &color);
+		glBindRenderbuffer(GL_RENDERBUFFER, color);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glGenRenderbuffers(1, &depth);
+		glBindRenderbuffer(GL_RENDERBUFFER, depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+		return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	}
+
+	void shutdown() {
+		if (fbo) glDeleteFramebuffers(1, &fbo);
+		if (color) glDeleteRenderbuffers(1, &color);
+		if (depth) glDeleteRenderbuffers(1, &depth);
+		delete sp;
+		sp = nullptr;
+		if (window) glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+
+	// Median frame time of an orbit around the city, uploaded and drawn the way the simulator does it
+	double frameMs(LoadedCity& city, int frames) {
+		std::vector<GLuint> tex(city.materials.size());
+		for (size_t m = 0; m < tex.size(); m++) {
+			const auto& mat = city.materials[m];
+			tex[m] = makeColorTexture(mat.diffuse[0], mat.diffuse[1], mat.diffuse[2], mat.dissolve);
+		}
+		GpuModel gpu;
+		uploadModel("bench city", city.verts, city.norms, city.uvs, gpu);
+
+		glm::vec2 centre = (city.minXZ + city.maxXZ) * 0.5f;
+		float extent = glm::length(city.maxXZ - city.minXZ) * 0.5f;
+		glm::mat4 P = glm::perspective(glm::radians(50.0f), float(width) / height, 1.0f, extent * 4.0f);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glViewport(0, 0, width, height);
+		glEnable(GL_DEPTH_TEST);
+		sp->use();
+		glUniformMatrix4fv(sp->u("P"), 1, GL_FALSE, glm::value_ptr(P));
+		glUniformMatrix4fv(sp->u("M"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+		glUniform4f(sp->u("sun"), 0.3f, 1.0f, 0.2f, 0.0f);
+		glUniform4f(sp->u("lp"), centre.x, 200.0f, centre.y, 1.0f);
+
+		std::vector<double> times;
+		for (int frame = 0; frame < frames; frame++) {
+			float a = frame * 0.1f;
+			glm::vec3 eye(centre.x + std::cos(a) * extent, extent * 0.5f, centre.y + std::sin(a) * extent);
+			glm::mat4 V = glm::lookAt(eye, glm::vec3(centre.x, 0.0f, centre.y), glm::vec3(0, 1, 0));
+
+			auto t0 = BenchClock::now();
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glUniformMatrix4fv(sp->u("V"), 1, GL_FALSE, glm::value_ptr(V));
+			drawModel(gpu, city.counts, tex);
+			glFinish();
+			if (frame >= 3) times.push_back(secondsSince(t0) * 1000.0); // skip the warm-up frames
+		}
+
+		glDeleteBuffers((GLsizei)gpu.verts.size(), gpu.verts.data());
+		glDeleteBuffers((GLsizei)gpu.norms.size(), gpu.norms.data());
+		glDeleteBuffers((GLsizei)gpu.uvs.size(), gpu.uvs.data());
+		glDeleteTextures((GLsizei)tex.size(), tex.data());
+
+		std::sort(times.begin(), times.end());
+		return times.empty() ? 0.0 : times[times.size() / 2];
+	}
+};
+
+}
+
+int runCityBenchmark() {
+	const int sizes[] = { 500, 2000, 8000, 32000 };
+	const int QUERIES = 200000;
+	const int FRAMES = 33;
+
+	HeadlessRenderer renderer;
+	bool canRender = renderer.init();
+	if (!canRender) printf("No GL context, render column skipped\n");
+
+	FILE* csv = fopen("city_bench.csv", "w");
+	if (csv) fprintf(csv, "buildings,triangles,obj_mb,gen_s,load_s,build_ms,point_qps,runway_qps,frame_ms\n");
+
+	printf("%-9s %10s %8s %7s %7s %9s %12s %12s %9s\n",
+		"buildings", "triangles", "obj MB", "gen s", "load s", "build ms", "point q/s", "runway q/s", "frame ms");
+	for (int n : sizes) {
+		CityGenConfig cfg;
+		cfg.buildings = n;
+		cfg.trianglesPerBuilding = 26;
+		cfg.seed = 2024;
+		std::string obj = "bench_city_" + std::to_string(n) + ".obj";
+		std::string mtl = "bench_city_" + std::to_string(n) + ".mtl";
+
+		CityGenStats stats;
+		auto t0 = BenchClock::now();
+		if (!generateCity(obj, cfg, &stats)) {
+			printf("Cannot write %s\n", obj.c_str());
+			break;
+		}
+		double genS = secondsSince(t0);
+
+		double objMb = 0.0;
+		if (FILE* f = fopen(obj.c_str(), "rb")) {
+			fseek(f, 0, SEEK_END);
+			objMb = ftell(f) / (1024.0 * 1024.0);
+			fclose(f);
+		}
+
+		// loadModel appends a box per shape to the airport lists; the city takes
+		// them from there and the lists are left as they were
+		LoadedCity city;
+		std::vector<AABB> savedObstacles, savedRunways;
+		savedObstacles.swap(airportObstacles);
+		savedRunways.swap(airportRunwayAABBs);
+		AABB bounds;
+		t0 = BenchClock::now();
+		bool loaded = loadModel(obj, city.verts, city.norms, city.uvs, city.counts, city.materials, &bounds);
+		double loadS = secondsSince(t0);
+		city.shapes.swap(airportObstacles);
+		city.shapes.insert(city.shapes.end(), airportRunwayAABBs.begin(), airportRunwayAABBs.end());
+		airportObstacles.swap(savedObstacles);
+		airportRunwayAABBs.swap(savedRunways);
+		city.minXZ = glm::vec2(bounds.min.x, bounds.min.z);
+		city.maxXZ = glm::vec2(bounds.max.x, bounds.max.z);
+		std::remove(obj.c_str());
+		std::remove(mtl.c_str());
+		if (!loaded) {
+			printf("Cannot load %s\n", obj.c_str());
+			break;
+		}
+
+		// Same structures initWorld builds for City.obj, plus one runway along the south edge
+		t0 = BenchClock::now();
+		Bvh bvh;
+		bvh.build(city.shapes);
+		UniformGrid grid;
+		grid.build(city.shapes, city.minXZ, city.maxXZ);
+		MeshBvh mesh;
+		mesh.build(city.verts);
+		std::vector<AABB> runways = { { glm::vec3(city.minXZ.x, -0.01f, city.minXZ.y), glm::vec3(city.maxXZ.x, 0.0f, city.minXZ.y + 40.0f) } };
+		UniformGrid runwayGrid;
+		runwayGrid.build(runways, glm::vec2(runways[0].min.x, runways[0].min.z), glm::vec2(runways[0].max.x, runways[0].max.z));
+		double buildMs = secondsSince(t0) * 1000.0;
+
+		CollisionWorld world;
+		world.cityGrid = &grid;
+		world.cityBvh = &bvh;
+		world.cityMesh = &mesh;
+		world.runwayGrid = &runwayGrid;
+		world.airportCenter = glm::vec3(0.0f); // runway boxes are already in world coords
+		world.airportSafeRadius = 0.0f;
+
+		std::mt19937 rng(99u);
+		std::uniform_real_distribution<float> px(city.minXZ.x, city.maxXZ.x), pz(city.minXZ.y, city.maxXZ.y), py(0.0f, 130.0f);
+		std::vector<glm::vec3> points(QUERIES);
+		for (auto& p : points) p = glm::vec3(px(rng), py(rng), pz(rng));
+
+		int hits = 0;
+		t0 = BenchClock::now();
+		for (const auto& p : points) hits += world.pointHit(p, false);
+		double pointQps = QUERIES / secondsSince(t0);
+
+		t0 = BenchClock::now();
+		for (const auto& p : points) hits += world.pointHit(glm::vec3(p.x, 2.0f, p.z), true);
+		double runwayQps = QUERIES / secondsSince(t0);
+
+		double frameMs = canRender ? renderer.frameMs(city, FRAMES) : 0.0;
+
+		printf("%-9d %10lld %8.1f %7.2f %7.2f %9.1f %12.0f %12.0f %9.2f\n",
+			n, stats.triangles, objMb, genS, loadS, buildMs, pointQps, runwayQps, frameMs);
+		if (csv) fprintf(csv, "%d,%lld,%.2f,%.3f,%.3f,%.1f,%.0f,%.0f,%.3f\n",
+			n, stats.triangles, objMb, genS, loadS, buildMs, pointQps, runwayQps, frameMs);
+		if (hits < 0) printf("\n"); // keeps the queries from being optimised away
+	}
+
+	if (csv) {
+		fclose(csv);
+		printf("Curves written to city_bench.csv\n");
+	}
+	renderer.shutdown();
+	return 0;
+}
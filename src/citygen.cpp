@@ -0,0 +1,130 @@
+#include "citygen.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// splitmix64: tiny, fast and identical on every platform
+struct CityRng {
+	uint64_t state;
+	explicit CityRng(uint64_t seed) : state(seed) {}
+
+	uint64_t next() {
+		uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+	float uniform(float lo, float hi) { return lo + (hi - lo) * float(next() >> 40) * (1.0f / 16777216.0f); }
+	int below(int n) { return int(next() % uint64_t(n)); }
+};
+
+// Face normals, written once: +X -X +Y -Y +Z -Z
+const float NORMALS[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+struct ObjWriter {
+	FILE* f;
+	long long vertexCount = 0;
+	long long triangles = 0;
+
+	// Quad a-b-c-d (counter-clockwise seen from outside) as two triangles
+	void quad(const float* a, const float* b, const float* c, const float* d, int normal, float uScale, float vScale) {
+		const float* p[4] = { a, b, c, d };
+		const float uv[4][2] = { { 0, 0 }, { uScale, 0 }, { uScale, vScale }, { 0, vScale } };
+		for (int i = 0; i < 4; i++) {
+			fprintf(f, "v %.3f %.3f %.3f\nvt %.3f %.3f\n", p[i][0], p[i][1], p[i][2], uv[i][0], uv[i][1]);
+		}
+		long long base = vertexCount + 1;
+		int n = normal + 1;
+		fprintf(f, "f %lld/%lld/%d %lld/%lld/%d %lld/%lld/%d\n", base, base, n, base + 1, base + 1, n, base + 2, base + 2, n);
+		fprintf(f, "f %lld/%lld/%d %lld/%lld/%d %lld/%lld/%d\n", base, base, n, base + 2, base + 2, n, base + 3, base + 3, n);
+		vertexCount += 4;
+		triangles += 2;
+	}
+};
+
+std::string mtlPathFor(const std::string& objPath) {
+	size_t dot = objPath.find_last_of('.');
+	size_t slash = objPath.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return objPath + ".mtl";
+	return objPath.substr(0, dot) + ".mtl";
+}
+
+}
+
+bool generateCity(const std::string& objPath, const CityGenConfig& cfg, CityGenStats* stats) {
+	const int buildings = std::max(0, cfg.buildings);
+	const int materials = std::max(1, cfg.materials);
+	const int floors = std::max(1, (cfg.trianglesPerBuilding - 2) / 8); // 4 walls x 2 triangles per floor + roof
+
+	std::string mtlPath = mtlPathFor(objPath);
+	std::string mtlName = mtlPath.substr(mtlPath.find_last_of("/\\") + 1);
+
+	CityRng rng(cfg.seed);
+
+	FILE* mtl = fopen(mtlPath.c_str(), "w");
+	if (!mtl) return false;
+	fprintf(mtl, "# Procedural city, seed %u\n\nnewmtl Ground\nKd 0.2 0.5 0.2\nKs 0.0 0.0 0.0\nd 1.0\nillum 1\n", cfg.seed);
+	for (int m = 0; m < materials; m++) {
+		float grey = rng.uniform(0.35f, 0.85f);
+		fprintf(mtl, "\nnewmtl Facade_%d\nKd %.3f %.3f %.3f\nKs 0.5 0.5 0.5\nd 1.0\nillum 2\n",
+			m, grey * rng.uniform(0.85f, 1.0f), grey * rng.uniform(0.85f, 1.0f), grey * rng.uniform(0.85f, 1.1f));
+	}
+	fclose(mtl);
+
+	FILE* f = fopen(objPath.c_str(), "w");
+	if (!f) return false;
+	ObjWriter w = { f };
+
+	fprintf(f, "# Procedural city: %d buildings, %d materials, seed %u\nmtllib %s\n", buildings, materials, cfg.seed, mtlName.c_str());
+	for (const auto& n : NORMALS) fprintf(f, "vn %.0f %.0f %.0f\n", n[0], n[1], n[2]);
+
+	// Lots on a square grid centred on the origin, taller buildings towards the middle
+	const int lotsPerRow = std::max(1, int(std::ceil(std::sqrt(double(buildings)))));
+	const float half = 0.5f * lotsPerRow * cfg.spacing;
+
+	fprintf(f, "o Ground\nusemtl Ground\n");
+	{
+		float g = half + cfg.spacing;
+		float a[3] = { -g, 0, g }, b[3] = { g, 0, g }, c[3] = { g, 0, -g }, d[3] = { -g, 0, -g };
+		w.quad(a, b, c, d, 2, 2.0f * g / 10.0f, 2.0f * g / 10.0f);
+	}
+
+	for (int i = 0; i < buildings; i++) {
+		float lx = (i % lotsPerRow + 0.5f) * cfg.spacing - half;
+		float lz = (i / lotsPerRow + 0.5f) * cfg.spacing - half;
+		float centre = 1.0f - std::min(1.0f, std::sqrt(lx * lx + lz * lz) / half);
+		float sx = rng.uniform(0.3f, 0.75f) * cfg.spacing;
+		float sz = rng.uniform(0.3f, 0.75f) * cfg.spacing;
+		float height = rng.uniform(8.0f, 30.0f) + centre * centre * rng.uniform(0.0f, 90.0f);
+		float x0 = lx - 0.5f * sx + rng.uniform(-0.1f, 0.1f) * cfg.spacing;
+		float z0 = lz - 0.5f * sz + rng.uniform(-0.1f, 0.1f) * cfg.spacing;
+		float x1 = x0 + sx, z1 = z0 + sz;
+
+		fprintf(f, "o Building_%d\nusemtl Facade_%d\n", i, rng.below(materials));
+		for (int fl = 0; fl < floors; fl++) {
+			float y0 = height * fl / floors, y1 = height * (fl + 1) / floors;
+			float v = (y1 - y0) / 10.0f;
+			float p000[3] = { x0, y0, z0 }, p100[3] = { x1, y0, z0 }, p110[3] = { x1, y1, z0 }, p010[3] = { x0, y1, z0 };
+			float p001[3] = { x0, y0, z1 }, p101[3] = { x1, y0, z1 }, p111[3] = { x1, y1, z1 }, p011[3] = { x0, y1, z1 };
+			w.quad(p001, p101, p111, p011, 4, sx / 10.0f, v); // +Z
+			w.quad(p100, p000, p010, p110, 5, sx / 10.0f, v); // -Z
+			w.quad(p101, p100, p110, p111, 0, sz / 10.0f, v); // +X
+			w.quad(p000, p001, p011, p010, 1, sz / 10.0f, v); // -X
+		}
+		float r0[3] = { x0, height, z1 }, r1[3] = { x1, height, z1 }, r2[3] = { x1, height, z0 }, r3[3] = { x0, height, z0 };
+		w.quad(r0, r1, r2, r3, 2, sx / 10.0f, sz / 10.0f);
+	}
+
+	bool ok = !ferror(f);
+	fclose(f);
+
+	if (stats) {
+		stats->buildings = buildings;
+		stats->materials = materials + 1;
+		stats->triangles = w.triangles;
+	}
+	return ok;
+}
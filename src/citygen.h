@@ -0,0 +1,27 @@
+#ifndef CITYGEN_H
+#define CITYGEN_H
+
+#include <string>
+#include <cstdint>
+
+struct CityGenConfig {
+	int buildings = 1000;
+	int materials = 8;             // facade materials; the ground gets one more
+	int trianglesPerBuilding = 10; // walls are split into floors to reach it (10 = plain box)
+	uint32_t seed = 1;
+	float spacing = 30.0f;         // lot size, metres
+};
+
+struct CityGenStats {
+	int buildings = 0;
+	int materials = 0;
+	long long triangles = 0;
+};
+
+// Writes a procedural city as OBJ + MTL (same base name, .mtl), one object per
+// building plus a ground plane, in the same layout conventions as City.obj.
+// The output depends only on the config: the generator uses its own integer
+// RNG, not the standard distributions, so every compiler writes the same file.
+bool generateCity(const std::string& objPath, const CityGenConfig& cfg, CityGenStats* stats = nullptr);
+
+#endif
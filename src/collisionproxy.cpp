@@ -0,0 +1,148 @@
+#include "collisionproxy.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+
+// Value at fraction q (0..1) of the sorted values, 0 if there are none
+float quantile(std::vector<float>& v, float q) {
+	if (v.empty()) return 0.0f;
+	size_t k = std::min(v.size() - 1, size_t(q * (v.size() - 1)));
+	std::nth_element(v.begin(), v.begin() + k, v.end());
+	return v[k];
+}
+
+}
+
+void AircraftProxy::build(const std::vector<std::vector<float>>& vertsPerMat) {
+	capsules.clear();
+
+	std::vector<glm::vec3> pts;
+	for (const auto& verts : vertsPerMat) {
+		for (size_t i = 0; i + 2 < verts.size(); i += 4) {
+			pts.push_back(glm::vec3(verts[i], verts[i + 1], verts[i + 2]));
+		}
+	}
+	if (pts.empty()) return;
+
+	glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+	for (const auto& p : pts) {
+		lo = glm::min(lo, p);
+		hi = glm::max(hi, p);
+	}
+	glm::vec3 center = (lo + hi) * 0.5f;
+	float halfSpan = 0.5f * (hi.x - lo.x);
+	float length = hi.z - lo.z;
+
+	// Fuselage: vertices close to the centre plane, radius from their spread around the axis
+	std::vector<float> radial;
+	float fy = 0.0f, fz0 = FLT_MAX, fz1 = -FLT_MAX;
+	int fn = 0;
+	for (const auto& p : pts) {
+		if (std::abs(p.x - center.x) > 0.15f * halfSpan) continue;
+		fy += p.y;
+		fn++;
+		fz0 = std::min(fz0, p.z);
+		fz1 = std::max(fz1, p.z);
+	}
+	if (fn > 0) {
+		fy /= fn;
+		for (const auto& p : pts) {
+			if (std::abs(p.x - center.x) > 0.15f * halfSpan) continue;
+			radial.push_back(glm::length(glm::vec2(p.x - center.x, p.y - fy)));
+		}
+		float r = quantile(radial, 0.9f);
+		float inset = std::min(r, 0.5f * (fz1 - fz0));
+		capsules.push_back({ glm::vec3(center.x, fy, fz0 + inset), glm::vec3(center.x, fy, fz1 - inset), r });
+	}
+
+	// Wings and tailplane: outboard vertices split into the front and the rear quarter
+	for (int part = 0; part < 2; part++) {
+		bool tail = part == 1;
+		float wy = 0.0f, wz = 0.0f, x0 = FLT_MAX, x1 = -FLT_MAX;
+		int wn = 0;
+		for (const auto& p : pts) {
+			if (std::abs(p.x - center.x) < 0.3f * halfSpan) continue;
+			if ((p.z < lo.z + 0.25f * length) != tail) continue;
+			wy += p.y;
+			wz += p.z;
+			x0 = std::min(x0, p.x);
+			x1 = std::max(x1, p.x);
+			wn++;
+		}
+		if (wn == 0) continue;
+		wy /= wn;
+		wz /= wn;
+
+		std::vector<float> chord;
+		for (const auto& p : pts) {
+			if (std::abs(p.x - center.x) < 0.3f * halfSpan) continue;
+			if ((p.z < lo.z + 0.25f * length) != tail) continue;
+			chord.push_back(glm::length(glm::vec2(p.y - wy, p.z - wz)));
+		}
+		// A thin wing would need a huge radius to cover its chord; keep it to the thick part
+		float r = quantile(chord, 0.6f);
+		float inset = std::min(r, 0.5f * (x1 - x0));
+		capsules.push_back({ glm::vec3(x0 + inset, wy, wz), glm::vec3(x1 - inset, wy, wz), r });
+	}
+}
+
+void AircraftProxy::transform(const glm::mat4& model, std::vector<Capsule>& out) const {
+	out.resize(capsules.size());
+	for (size_t i = 0; i < capsules.size(); i++) {
+		out[i].a = glm::vec3(model * glm::vec4(capsules[i].a, 1.0f));
+		out[i].b = glm::vec3(model * glm::vec4(capsules[i].b, 1.0f));
+		out[i].radius = capsules[i].radius;
+	}
+}
+
+float segmentAabbDistSq(const glm::vec3& a, const glm::vec3& b, const AABB& box, float* tOut) {
+	glm::vec3 d = b - a;
+
+	// Breakpoints: where the segment crosses one of the six slab planes
+	float ts[8];
+	int n = 0;
+	ts[n++] = 0.0f;
+	for (int i = 0; i < 3; i++) {
+		if (d[i] == 0.0f) continue;
+		float t0 = (box.min[i] - a[i]) / d[i];
+		float t1 = (box.max[i] - a[i]) / d[i];
+		if (t0 > 0.0f && t0 < 1.0f) ts[n++] = t0;
+		if (t1 > 0.0f && t1 < 1.0f) ts[n++] = t1;
+	}
+	ts[n++] = 1.0f;
+	std::sort(ts, ts + n);
+
+	float best = FLT_MAX, bestT = 0.0f;
+	for (int k = 0; k + 1 < n; k++) {
+		float t0 = ts[k], t1 = ts[k + 1];
+		float tm = 0.5f * (t0 + t1);
+
+		// On this piece each axis is either inside its slab or a fixed side of it:
+		// excess_i(t) = c0 + c1 * t, so the squared distance is A t^2 + B t + C
+		float A = 0.0f, B = 0.0f, C = 0.0f;
+		for (int i = 0; i < 3; i++) {
+			float p = a[i] + tm * d[i];
+			float c0, c1;
+			if (p < box.min[i]) { c0 = box.min[i] - a[i]; c1 = -d[i]; }
+			else if (p > box.max[i]) { c0 = a[i] - box.max[i]; c1 = d[i]; }
+			else continue;
+			A += c1 * c1;
+			B += 2.0f * c0 * c1;
+			C += c0 * c0;
+		}
+
+		float t = t0;
+		if (A > 0.0f) t = glm::clamp(-B / (2.0f * A), t0, t1);
+		else if (B < 0.0f) t = t1;
+		float f = glm::max(0.0f, (A * t + B) * t + C);
+		if (f < best) {
+			best = f;
+			bestT = t;
+		}
+	}
+
+	if (tOut) *tOut = bestT;
+	return best;
+}
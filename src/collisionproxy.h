@@ -0,0 +1,42 @@
+#ifndef COLLISIONPROXY_H
+#define COLLISIONPROXY_H
+
+#include "aabb.h"
+
+#include <vector>
+
+struct Capsule {
+	glm::vec3 a, b; // axis end points
+	float radius;
+};
+
+// Collision volume of the aircraft: a few capsules fitted to the jet mesh in
+// model space (fuselage along Z, wings along X, horizontal tail), moved with
+// the same model matrix that draws the jet.
+class AircraftProxy {
+public:
+	// Flat [x,y,z,w, ...] vertex arrays as kept by loadModel
+	void build(const std::vector<std::vector<float>>& vertsPerMat);
+
+	const std::vector<Capsule>& modelCapsules() const { return capsules; }
+	void transform(const glm::mat4& model, std::vector<Capsule>& out) const;
+
+private:
+	std::vector<Capsule> capsules;
+};
+
+// Squared distance between the segment a->b and the box, exact. The squared
+// distance along the segment is a convex piecewise quadratic with at most six
+// breakpoints (slab crossings), so each piece is minimised in closed form.
+float segmentAabbDistSq(const glm::vec3& a, const glm::vec3& b, const AABB& box, float* tOut = nullptr);
+
+inline bool capsuleOverlapsAabb(const Capsule& c, const AABB& box) {
+	return segmentAabbDistSq(c.a, c.b, box) < c.radius * c.radius;
+}
+
+inline AABB capsuleBounds(const Capsule& c) {
+	glm::vec3 r(c.radius);
+	return { glm::min(c.a, c.b) - r, glm::max(c.a, c.b) + r };
+}
+
+#endif
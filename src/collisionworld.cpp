@@ -0,0 +1,137 @@
+#include "collisionworld.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const size_t QUERIES_PER_TASK = 256; // below this a task costs more than it saves
+
+// Narrow phase for a point already inside a shape's box: it is solid only if the
+// mesh has geometry straight above it within the box (roof, ceiling). Empty
+// corners of non-box shapes and the space under sloped roofs stay free.
+bool insideMesh(const MeshBvh* mesh, const glm::vec3& p, const AABB& box) {
+	if (!mesh || mesh->empty()) return true; // no triangles, trust the box
+	return mesh->anyHit(p, glm::vec3(p.x, box.max.y + 0.01f, p.z));
+}
+
+// Interleaves the low 16 bits of x and z (Morton order keeps 2D neighbours close in 1D)
+uint32_t mortonXZ(uint32_t x, uint32_t z) {
+	auto spread = [](uint32_t v) {
+		v &= 0xffff;
+		v = (v | (v << 8)) & 0x00ff00ff;
+		v = (v | (v << 4)) & 0x0f0f0f0f;
+		v = (v | (v << 2)) & 0x33333333;
+		v = (v | (v << 1)) & 0x55555555;
+		return v;
+	};
+	return spread(x) | (spread(z) << 1);
+}
+
+}
+
+bool CollisionWorld::overAirport(const glm::vec3& posWorld) const {
+	glm::vec2 p2d(posWorld.x, posWorld.z);
+	glm::vec2 a2d(airportCenter.x + airportOffset.x, airportCenter.z + airportOffset.z);
+	return glm::distance(p2d, a2d) < airportSafeRadius;
+}
+
+bool CollisionWorld::onRunway(const glm::vec3& posWorld) const {
+	if (!runwayGrid) return false;
+	glm::vec3 posLocal = posWorld - (airportCenter + airportOffset);
+
+	// x/z strictly inside, y from 2 below to 3 above the surface
+	return runwayGrid->anyInCell(posLocal, glm::vec3(0.0f, -2.0f, 0.0f), glm::vec3(0.0f, 3.0f, 0.0f),
+		[](const AABB&, int) { return true; });
+}
+
+bool CollisionWorld::pointHit(const glm::vec3& posWorld, bool onGround) const {
+	// On the ground only the runway is safe
+	if (onGround) return !onRunway(posWorld);
+
+	if (overAirport(posWorld)) {
+		if (!airportGrid) return false;
+		glm::vec3 posLocal = posWorld - airportOffset;
+		// box.min/.max are in local coords. Only the 1 m core counts; it lies inside
+		// the speed-dependent extended box (buffer 2-8 m), so that test is implied.
+		return airportGrid->anyInCell(posLocal, glm::vec3(1.0f), glm::vec3(-1.0f), [&](const AABB& box, int) {
+			return insideMesh(airportMesh, posLocal, box);
+		});
+	}
+
+	// City buildings are already in world coords
+	if (!cityGrid) return false;
+	return cityGrid->anyInCell(posWorld, glm::vec3(0.0f), glm::vec3(0.0f), [&](const AABB& box, int) {
+		return insideMesh(cityMesh, posWorld, box);
+	});
+}
+
+bool CollisionWorld::sweepHit(const glm::vec3& fromWorld, const glm::vec3& toWorld, CollisionResult& out) const {
+	bool airport = overAirport(toWorld);
+	glm::vec3 offset = airport ? airportOffset : glm::vec3(0.0f);
+	glm::vec3 from = fromWorld - offset;
+	glm::vec3 to = toWorld - offset;
+
+	// Broadphase: does the path enter any box at all?
+	const Bvh* boxes = airport ? airportCoresBvh : cityBvh;
+	BvhHit hit;
+	if (!boxes || !boxes->firstHit(from, to, hit)) return false;
+
+	// Narrow phase: first triangle crossed, as long as it belongs to a collision shape
+	const MeshBvh* mesh = airport ? airportMesh : cityMesh;
+	if (mesh && !mesh->empty()) {
+		MeshHit mhit;
+		if (!mesh->firstHit(from, to, mhit)) return false;
+
+		glm::vec3 p = glm::mix(from, to, mhit.t);
+		const Bvh* shapes = airport ? airportBvh : cityBvh;
+		bool onShape = shapes && shapes->anyContaining(p, [&](const AABB& box, int) {
+			return aabbContains({ box.min - glm::vec3(0.01f), box.max + glm::vec3(0.01f) }, p);
+		});
+		if (!onShape) return false;
+
+		hit.t = mhit.t;
+		hit.normal = mhit.normal;
+	}
+
+	out.hit = true;
+	out.t = hit.t;
+	out.point = glm::mix(fromWorld, toWorld, hit.t);
+	out.normal = hit.normal;
+	return true;
+}
+
+CollisionResult collide(const CollisionWorld& world, const CollisionQuery& q, float dt) {
+	CollisionResult r = { false, 1.0f, q.pos, glm::vec3(0, 1, 0) };
+	bool onGround = (q.flags & QUERY_ON_GROUND) != 0;
+
+	if ((q.flags & QUERY_SWEEP) && !onGround && world.sweepHit(q.pos - q.velocity * dt, q.pos, r)) return r;
+	r.hit = world.pointHit(q.pos, onGround);
+	return r;
+}
+
+void collideBatch(const CollisionWorld& world, const CollisionQuery* queries, CollisionResult* results,
+	size_t count, float dt, JobSystem* jobs) {
+	if (count == 0) return;
+
+	// Sort key: Morton code of the XZ cell, offset so negative cells stay ordered
+	std::vector<std::pair<uint32_t, uint32_t>> order(count);
+	float inv = 1.0f / world.sortCellSize;
+	for (size_t i = 0; i < count; i++) {
+		uint32_t cx = uint32_t(int32_t(std::floor(queries[i].pos.x * inv)) + 32768);
+		uint32_t cz = uint32_t(int32_t(std::floor(queries[i].pos.z * inv)) + 32768);
+		order[i] = { mortonXZ(cx, cz), (uint32_t)i };
+	}
+	std::sort(order.begin(), order.end());
+
+	auto run = [&](size_t first, size_t last) {
+		for (size_t k = first; k < last; k++) {
+			uint32_t i = order[k].second;
+			results[i] = collide(world, queries[i], dt);
+		}
+	};
+
+	// Contiguous runs of the sorted order, so each task stays in its own part of the map
+	if (jobs) jobs->parallelFor(count, QUERIES_PER_TASK, run);
+	else run(0, count);
+}
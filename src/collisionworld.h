@@ -0,0 +1,67 @@
+#ifndef COLLISIONWORLD_H
+#define COLLISIONWORLD_H
+
+#include "bvh.h"
+#include "uniformgrid.h"
+#include "meshbvh.h"
+#include "jobs.h"
+
+#include <vector>
+#include <cstdint>
+
+enum CollisionQueryFlags : uint32_t {
+	QUERY_ON_GROUND = 1u << 0, // rolling: anything but a runway is a crash
+	QUERY_SWEEP = 1u << 1,     // also test the path pos - velocity * dt -> pos
+};
+
+struct CollisionQuery {
+	glm::vec3 pos;      // world position at the end of the step
+	glm::vec3 velocity; // world velocity during the step, per second
+	uint32_t flags;
+};
+
+struct CollisionResult {
+	bool hit;
+	float t;          // fraction of the step at impact, 1 for the end-of-step point test
+	glm::vec3 point;  // world position at impact
+	glm::vec3 normal; // surface normal, (0,1,0) when unknown
+};
+
+// Static collision scene: the broadphase and narrow-phase structures of the
+// city and the airport. Queries only read it, so any number of threads may
+// run them at once. All members must outlive the world.
+struct CollisionWorld {
+	const UniformGrid* cityGrid = nullptr;
+	const Bvh* cityBvh = nullptr;
+	const MeshBvh* cityMesh = nullptr;
+
+	const UniformGrid* airportGrid = nullptr;  // obstacles, airport mesh coords
+	const Bvh* airportBvh = nullptr;
+	const Bvh* airportCoresBvh = nullptr;      // obstacles shrunk by the core margin
+	const MeshBvh* airportMesh = nullptr;
+	const UniformGrid* runwayGrid = nullptr;   // relative to airportCenter
+	glm::vec3 airportOffset = glm::vec3(0.0f); // airport mesh -> world
+	glm::vec3 airportCenter = glm::vec3(0.0f); // airport mesh coords
+	float airportSafeRadius = 0.0f;
+
+	float sortCellSize = 64.0f; // batch queries are grouped by cells of this size
+
+	bool overAirport(const glm::vec3& posWorld) const;
+	bool onRunway(const glm::vec3& posWorld) const;
+
+	// End-of-step point test (the old checkCollision)
+	bool pointHit(const glm::vec3& posWorld, bool onGround) const;
+	// Earliest hit on the segment from -> to (airborne only)
+	bool sweepHit(const glm::vec3& fromWorld, const glm::vec3& toWorld, CollisionResult& out) const;
+};
+
+// One query, no global state
+CollisionResult collide(const CollisionWorld& world, const CollisionQuery& q, float dt);
+
+// All queries of a tick in one call. They are sorted by XZ cell so neighbours
+// share cache lines, then split into runs of that order on the job system
+// (nullptr = all on the calling thread). results[i] answers queries[i].
+void collideBatch(const CollisionWorld& world, const CollisionQuery* queries, CollisionResult* results,
+	size_t count, float dt, JobSystem* jobs = nullptr);
+
+#endif
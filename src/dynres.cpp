@@ -0,0 +1,128 @@
+#include "dynres.h"
+#include "assetmemory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+DynamicResolution::DynamicResolution(const DynResConfig& config, int windowWidth, int windowHeight)
+	: cfg(config) {
+	cfg.maxScale = std::max(0.1f, std::min(cfg.maxScale, 2.0f));
+	cfg.minScale = std::max(0.1f, std::min(cfg.minScale, cfg.maxScale));
+	currentScale = cfg.maxScale;
+	smoothedMs = cfg.targetFrameMs;
+
+	glGenQueries(QUERY_COUNT, queries);
+	resize(windowWidth, windowHeight);
+}
+
+DynamicResolution::~DynamicResolution() {
+	destroyTargets();
+	glDeleteQueries(QUERY_COUNT, queries);
+}
+
+void DynamicResolution::resize(int windowWidth, int windowHeight) {
+	if (windowWidth <= 0 || windowHeight <= 0) return;
+	windowW = windowWidth;
+	windowH = windowHeight;
+	destroyTargets();
+	createTargets();
+}
+
+void DynamicResolution::createTargets() {
+	targetW = std::max(1, int(std::ceil(windowW * cfg.maxScale)));
+	targetH = std::max(1, int(std::ceil(windowH * cfg.maxScale)));
+
+	glGenTextures(1, &colorTex);
+	glBindTexture(GL_TEXTURE_2D, colorTex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, targetW, targetH, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &depthRb);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthRb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, targetW, targetH);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRb);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Dynamic resolution framebuffer incomplete\n";
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	assetMemoryAdd("scene render target", 0, 0, targetBytes(), 2);
+}
+
+int64_t DynamicResolution::targetBytes() const {
+	return textureBytes(targetW, targetH, 4, false) * 2; // RGBA8 colour, 24-bit depth padded to 32
+}
+
+void DynamicResolution::destroyTargets() {
+	if (colorTex) assetMemoryAdd("scene render target", 0, 0, -targetBytes(), -2);
+	if (fbo) glDeleteFramebuffers(1, &fbo);
+	if (colorTex) glDeleteTextures(1, &colorTex);
+	if (depthRb) glDeleteRenderbuffers(1, &depthRb);
+	fbo = colorTex = depthRb = 0;
+}
+
+void DynamicResolution::beginScene() {
+	collectTimings();
+
+	sceneW = std::max(1, std::min(targetW, int(windowW * currentScale + 0.5f)));
+	sceneH = std::max(1, std::min(targetH, int(windowH * currentScale + 0.5f)));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, sceneW, sceneH);
+
+	if (!queryPending[queryIndex]) {
+		glBeginQuery(GL_TIME_ELAPSED, queries[queryIndex]);
+	}
+}
+
+void DynamicResolution::endScene() {
+	if (!queryPending[queryIndex]) {
+		glEndQuery(GL_TIME_ELAPSED);
+		queryPending[queryIndex] = true;
+		queryIndex = (queryIndex + 1) % QUERY_COUNT;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, sceneW, sceneH, 0, 0, windowW, windowH, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, windowW, windowH);
+}
+
+// Reads every finished timer query and steers the scale towards the budget
+void DynamicResolution::collectTimings() {
+	bool sampled = false;
+	for (int i = 0; i < QUERY_COUNT; i++) {
+		if (!queryPending[i]) continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) continue;
+
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns);
+		queryPending[i] = false;
+
+		float ms = float(ns) * 1e-6f;
+		smoothedMs = smoothedMs * 0.8f + ms * 0.2f;
+		sampled = true;
+	}
+	if (!sampled) return;
+
+	// Fill cost grows with pixel count, i.e. with scale squared
+	float ratio = cfg.targetFrameMs / std::max(smoothedMs, 0.01f);
+	float wanted = currentScale * std::sqrt(ratio);
+	wanted = std::max(cfg.minScale, std::min(wanted, cfg.maxScale));
+
+	// Small dead zone so the scale does not oscillate around the target
+	if (std::fabs(wanted - currentScale) > 0.02f) {
+		currentScale += (wanted - currentScale) * 0.25f;
+	}
+}
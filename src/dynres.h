@@ -0,0 +1,52 @@
+#ifndef DYNRES_H
+#define DYNRES_H
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+struct DynResConfig {
+	float targetFrameMs = 14.0f; // GPU time budget for the 3D scene
+	float minScale = 0.5f;       // resolution scale bounds (per axis, 1.0 = native)
+	float maxScale = 1.0f;
+};
+
+// Renders the 3D scene into an offscreen target whose size follows the measured
+// GPU frame time, then upscales it into the window. Everything drawn after
+// endScene() (the HUD) stays at native resolution.
+class DynamicResolution {
+public:
+	DynamicResolution(const DynResConfig& config, int windowWidth, int windowHeight);
+	~DynamicResolution();
+
+	void resize(int windowWidth, int windowHeight);
+	void beginScene(); // binds the offscreen target and starts the GPU timer
+	void endScene();   // stops the timer, upscales into the window, adapts the scale
+
+	float scale() const { return currentScale; }
+	float gpuFrameMs() const { return smoothedMs; }
+
+private:
+	static const int QUERY_COUNT = 4; // results are read a few frames late to avoid stalls
+
+	DynResConfig cfg;
+	GLuint fbo = 0;
+	GLuint colorTex = 0;
+	GLuint depthRb = 0;
+	GLuint queries[QUERY_COUNT] = {};
+	bool queryPending[QUERY_COUNT] = {};
+	int queryIndex = 0;
+
+	int windowW = 0, windowH = 0;
+	int targetW = 0, targetH = 0; // allocated size (maxScale * window)
+	int sceneW = 0, sceneH = 0;   // size rendered this frame
+	float currentScale = 1.0f;
+	float smoothedMs = 0.0f;
+
+	void createTargets();
+	void destroyTargets();
+	int64_t targetBytes() const; // GPU memory of the colour and depth targets
+	void collectTimings();
+};
+
+#endif
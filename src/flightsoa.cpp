@@ -0,0 +1,318 @@
+#include "flightsoa.h"
+#include "attitude.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#define FLIGHTSOA_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLIGHTSOA_SSE 1
+#include <emmintrin.h>
+#endif
+
+void FlightSoA::resize(size_t n) {
+	count = n;
+	size_t padded = (n + BATCH - 1) / BATCH * BATCH;
+	for (auto* v : { &posX, &posY, &posZ, &qw, &qx, &qy, &qz, &speed, &pathPitch, &throttle, &targetThrottle,
+		&currentYawRate, &targetYawRate, &pitchRate, &verticalSpeed, &stalling }) {
+		v->resize(padded, 0.0f);
+	}
+	// Padding lanes need a valid attitude too
+	for (size_t i = n; i < padded; i++) qw[i] = 1.0f;
+}
+
+void integrateFlightReference(FlightSoA& f, float dt, const FlightParams& p) {
+	const AircraftParams& type = p.type->params();
+	const float stallK = 1.0f - expf(-p.stallBlend * dt);
+	for (size_t i = 0; i < f.size(); i++) {
+		float thrDiff = f.targetThrottle[i] - f.throttle[i];
+		float maxThrStep = 1.5f * dt;
+		if (fabs(thrDiff) < maxThrStep) f.throttle[i] = f.targetThrottle[i];
+		else f.throttle[i] += glm::sign(thrDiff) * maxThrStep;
+		f.throttle[i] = glm::clamp(f.throttle[i], 0.0f, 1.0f);
+
+		float diff = glm::clamp(f.targetYawRate[i] - f.currentYawRate[i], -p.yawAccel * dt, p.yawAccel * dt);
+		f.currentYawRate[i] += diff;
+
+		glm::quat q(f.qw[i], f.qx[i], f.qy[i], f.qz[i]);
+		float desiredRoll = glm::clamp(-f.currentYawRate[i] * 0.5f, glm::radians(-30.0f), glm::radians(30.0f));
+		float rollRate = glm::clamp(desiredRoll - attitudeRoll(q), -p.rollAccel * dt, p.rollAccel * dt) / dt;
+
+		q = integrateAttitude(q, f.currentYawRate[i], glm::vec3(f.pitchRate[i], 0.0f, rollRate), dt);
+		float pitch = attitudePitch(q);
+		float limited = glm::clamp(pitch, glm::radians(-45.0f), glm::radians(45.0f));
+		if (limited != pitch) {
+			q = attitudePitchBy(q, limited - pitch);
+			pitch = limited;
+		}
+
+		float alpha = f.pathPitch[i] - pitch;
+		float dSpeed, dPath;
+		p.type->airborneRates(f.speed[i], f.pathPitch[i], pitch, f.throttle[i], p.gravity, dSpeed, dPath);
+		f.speed[i] = glm::clamp(f.speed[i] + dSpeed * dt, 0.0f, type.maxSpeed);
+		f.pathPitch[i] = glm::clamp(f.pathPitch[i] + dPath * dt, -p.maxPathPitch, p.maxPathPitch);
+
+		bool stall = (alpha > type.stallAlpha || f.speed[i] < type.stallSpeed) && f.posY[i] > p.minY + 0.5f;
+		f.stalling[i] = stall ? 1.0f : 0.0f;
+		if (stall) q = attitudePitchBy(q, (p.stallNoseDown - pitch) * stallK);
+		f.verticalSpeed[i] = -f.speed[i] * sinf(f.pathPitch[i]);
+		f.qw[i] = q.w;
+		f.qx[i] = q.x;
+		f.qy[i] = q.y;
+		f.qz[i] = q.z;
+
+		glm::vec3 forward = flightDirection(q, f.pathPitch[i]);
+		f.posX[i] += forward.x * (f.speed[i] * dt);
+		f.posY[i] += forward.y * (f.speed[i] * dt);
+		f.posZ[i] += forward.z * (f.speed[i] * dt);
+	}
+}
+
+#if defined(FLIGHTSOA_AVX) || defined(FLIGHTSOA_SSE)
+
+namespace {
+
+// Eight floats, one AVX register or two SSE ones; masks are all-ones lanes
+#if defined(FLIGHTSOA_AVX)
+struct F8 { __m256 v; };
+inline F8 load(const float* p) { return { _mm256_loadu_ps(p) }; }
+inline void store(float* p, F8 a) { _mm256_storeu_ps(p, a.v); }
+inline F8 set1(float x) { return { _mm256_set1_ps(x) }; }
+inline F8 operator+(F8 a, F8 b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline F8 operator-(F8 a, F8 b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline F8 operator*(F8 a, F8 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+inline F8 operator/(F8 a, F8 b) { return { _mm256_div_ps(a.v, b.v) }; }
+inline F8 vmin(F8 a, F8 b) { return { _mm256_min_ps(a.v, b.v) }; }
+inline F8 vmax(F8 a, F8 b) { return { _mm256_max_ps(a.v, b.v) }; }
+inline F8 lt(F8 a, F8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline F8 gt(F8 a, F8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+inline F8 eq(F8 a, F8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ) }; }
+inline F8 operator&(F8 a, F8 b) { return { _mm256_and_ps(a.v, b.v) }; }
+inline F8 operator|(F8 a, F8 b) { return { _mm256_or_ps(a.v, b.v) }; }
+inline F8 select(F8 m, F8 a, F8 b) { return { _mm256_blendv_ps(b.v, a.v, m.v) }; }
+inline F8 vabs(F8 a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+inline F8 vsqrt(F8 a) { return { _mm256_sqrt_ps(a.v) }; }
+inline F8 vround(F8 a) { return { _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) }; }
+#else
+struct F8 { __m128 lo, hi; };
+inline F8 load(const float* p) { return { _mm_loadu_ps(p), _mm_loadu_ps(p + 4) }; }
+inline void store(float* p, F8 a) { _mm_storeu_ps(p, a.lo); _mm_storeu_ps(p + 4, a.hi); }
+inline F8 set1(float x) { __m128 v = _mm_set1_ps(x); return { v, v }; }
+inline F8 operator+(F8 a, F8 b) { return { _mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi) }; }
+inline F8 operator-(F8 a, F8 b) { return { _mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi) }; }
+inline F8 operator*(F8 a, F8 b) { return { _mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi) }; }
+inline F8 operator/(F8 a, F8 b) { return { _mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi) }; }
+inline F8 vmin(F8 a, F8 b) { return { _mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi) }; }
+inline F8 vmax(F8 a, F8 b) { return { _mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi) }; }
+inline F8 lt(F8 a, F8 b) { return { _mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi) }; }
+inline F8 gt(F8 a, F8 b) { return { _mm_cmpgt_ps(a.lo, b.lo), _mm_cmpgt_ps(a.hi, b.hi) }; }
+inline F8 eq(F8 a, F8 b) { return { _mm_cmpeq_ps(a.lo, b.lo), _mm_cmpeq_ps(a.hi, b.hi) }; }
+inline F8 operator&(F8 a, F8 b) { return { _mm_and_ps(a.lo, b.lo), _mm_and_ps(a.hi, b.hi) }; }
+inline F8 operator|(F8 a, F8 b) { return { _mm_or_ps(a.lo, b.lo), _mm_or_ps(a.hi, b.hi) }; }
+inline __m128 select4(__m128 m, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+inline F8 select(F8 m, F8 a, F8 b) { return { select4(m.lo, a.lo, b.lo), select4(m.hi, a.hi, b.hi) }; }
+inline F8 vabs(F8 a) {
+	__m128 s = _mm_set1_ps(-0.0f);
+	return { _mm_andnot_ps(s, a.lo), _mm_andnot_ps(s, a.hi) };
+}
+inline F8 vsqrt(F8 a) { return { _mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi) }; }
+// Round to nearest (default MXCSR mode); fine for |x| < 2^31
+inline F8 vround(F8 a) {
+	return { _mm_cvtepi32_ps(_mm_cvtps_epi32(a.lo)), _mm_cvtepi32_ps(_mm_cvtps_epi32(a.hi)) };
+}
+#endif
+
+inline F8 clampv(F8 x, F8 lo, F8 hi) { return vmin(vmax(x, lo), hi); }
+
+// sin and cos together: Cody-Waite reduction to [-pi/4, pi/4] by quadrant, then
+// the minimax polynomials used by Cephes sinf/cosf
+void sincos8(F8 x, F8& s, F8& c) {
+	F8 q = vround(x * set1(0.63661977236758134f)); // x * 2/pi
+	F8 r = x - q * set1(1.5703125f);
+	r = r - q * set1(4.837512969970703125e-4f);
+	r = r - q * set1(7.54978995489188216e-8f);
+
+	F8 r2 = r * r;
+	F8 ps = r + r * r2 * (set1(-1.6666654611e-1f) + r2 * (set1(8.3321608736e-3f) + r2 * set1(-1.9515295891e-4f)));
+	F8 pc = set1(1.0f) - set1(0.5f) * r2 +
+		r2 * r2 * (set1(4.166664568298827e-2f) + r2 * (set1(-1.388731625493765e-3f) + r2 * set1(2.443315711809948e-5f)));
+
+	// Quadrant q mod 4 without integer vectors
+	F8 q4 = q - set1(4.0f) * vround(q * set1(0.25f) - set1(0.375f)); // 0..3
+	F8 odd = eq(q4, set1(1.0f)) | eq(q4, set1(3.0f));
+	F8 sinNeg = gt(q4, set1(1.5f));
+	F8 cosNeg = eq(q4, set1(1.0f)) | eq(q4, set1(2.0f));
+	F8 sv = select(odd, pc, ps);
+	F8 cv = select(odd, ps, pc);
+	s = select(sinNeg, set1(0.0f) - sv, sv);
+	c = select(cosNeg, set1(0.0f) - cv, cv);
+}
+
+// Cephes asinf: polynomial on [0, 0.5], asin(x) = pi/2 - 2 asin(sqrt((1 - x) / 2)) above
+F8 asin8(F8 x) {
+	F8 a = vabs(x);
+	F8 big = gt(a, set1(0.5f));
+	F8 z = select(big, set1(0.5f) * (set1(1.0f) - a), a * a);
+	F8 s = select(big, vsqrt(z), a);
+	F8 p = ((((set1(4.2163199048e-2f) * z + set1(2.4181311049e-2f)) * z + set1(4.5470025998e-2f)) * z +
+		set1(7.4953002686e-2f)) * z + set1(1.6666752422e-1f)) * z * s + s;
+	F8 r = select(big, set1(1.5707963267948966f) - p - p, p);
+	return select(lt(x, set1(0.0f)), set1(0.0f) - r, r);
+}
+
+// Eight attitudes, the lanes of FlightSoA::qw..qz
+struct Q8 { F8 w, x, y, z; };
+
+inline F8 forwardX(const Q8& q) { return set1(2.0f) * (q.x * q.z + q.w * q.y); }
+inline F8 forwardY(const Q8& q) { return set1(2.0f) * (q.y * q.z - q.w * q.x); }
+inline F8 forwardZ(const Q8& q) { return set1(1.0f) - set1(2.0f) * (q.x * q.x + q.y * q.y); }
+
+// attitudePitch, valid without the clamp: q is unit length
+inline F8 pitch8(const Q8& q) { return asin8(set1(0.0f) - forwardY(q)); }
+
+// attitudePitchBy: turn about the level wing axis (f.z, 0, -f.x) / |...|
+Q8 pitchBy8(const Q8& q, F8 angle) {
+	F8 fx = forwardX(q), fz = forwardZ(q);
+	F8 inv = set1(1.0f) / vsqrt(fx * fx + fz * fz);
+	F8 s, c;
+	sincos8(angle * set1(0.5f), s, c);
+	F8 ax = s * fz * inv, az = set1(0.0f) - s * fx * inv;
+	return { c * q.w - (ax * q.x + az * q.z),
+		c * q.x + (ax * q.w - az * q.y),
+		c * q.y + (az * q.x - ax * q.z),
+		c * q.z + (az * q.w + ax * q.y) };
+}
+
+// CL and CD of eight lanes: vector grid coordinates, scalar corner reads, vector
+// blend in the order AircraftType::coefficients uses
+void coefficients8(const AircraftType::Grid& g, F8 alpha, F8 speed, F8& cl, F8& cd) {
+	float fa[8], fs[8];
+	store(fa, clampv((alpha - set1(g.alphaMin)) * set1(g.invAlphaStep), set1(0.0f), set1(float(g.alphaCount - 1))));
+	store(fs, clampv((speed - set1(g.speedMin)) * set1(g.invSpeedStep), set1(0.0f), set1(float(g.speedCount - 1))));
+
+	float ta[8], ts[8], l00[8], l10[8], l01[8], l11[8], d00[8], d10[8], d01[8], d11[8];
+	for (int k = 0; k < 8; k++) {
+		int ia = glm::min(int(fa[k]), g.alphaCount - 2);
+		int is = glm::min(int(fs[k]), g.speedCount - 2);
+		ta[k] = fa[k] - ia;
+		ts[k] = fs[k] - is;
+		const float* p0 = g.pairs + (size_t(is) * g.alphaCount + ia) * 2;
+		const float* p1 = p0 + size_t(g.alphaCount) * 2;
+		l00[k] = p0[0]; d00[k] = p0[1]; l10[k] = p0[2]; d10[k] = p0[3];
+		l01[k] = p1[0]; d01[k] = p1[1]; l11[k] = p1[2]; d11[k] = p1[3];
+	}
+
+	F8 tA = load(ta), tS = load(ts);
+	F8 c0 = load(l00) + (load(l10) - load(l00)) * tA, c1 = load(l01) + (load(l11) - load(l01)) * tA;
+	cl = c0 + (c1 - c0) * tS;
+	c0 = load(d00) + (load(d10) - load(d00)) * tA;
+	c1 = load(d01) + (load(d11) - load(d01)) * tA;
+	cd = c0 + (c1 - c0) * tS;
+}
+
+}
+
+void integrateFlight(FlightSoA& f, float dt, const FlightParams& p) {
+	const AircraftParams& type = p.type->params();
+	const AircraftType::Grid grid = p.type->grid();
+	const F8 zero = set1(0.0f), one = set1(1.0f);
+	const F8 vdt = set1(dt);
+	const F8 maxThrStep = set1(1.5f * dt);
+	const F8 pitchLo = set1(glm::radians(-45.0f)), pitchHi = set1(glm::radians(45.0f));
+	const F8 pathLo = set1(-p.maxPathPitch), pathHi = set1(p.maxPathPitch);
+	const F8 maxSpeed = set1(type.maxSpeed), maxThrust = set1(type.maxThrust);
+	const F8 halfRhoS = set1(0.5f * AircraftType::AIR_DENSITY * type.wingArea), invMass = set1(1.0f / type.mass);
+	const F8 gravity = set1(p.gravity);
+	const F8 stallAlpha = set1(type.stallAlpha), stallSpeed = set1(type.stallSpeed), stallMinY = set1(p.minY + 0.5f);
+	const F8 noseDown = set1(p.stallNoseDown);
+	const float k = 1.0f - expf(-p.stallBlend * dt);
+	const F8 stallK = set1(k);
+	const F8 two = set1(2.0f), halfDt = set1(0.5f * dt);
+	const F8 yawStep = set1(p.yawAccel * dt), rollStep = set1(p.rollAccel * dt);
+	const F8 rollLo = set1(glm::radians(-30.0f)), rollHi = set1(glm::radians(30.0f));
+
+	const size_t n = f.posX.size(); // padded
+	for (size_t i = 0; i < n; i += FlightSoA::BATCH) {
+		// Throttle: snap when within one step, else move one step
+		F8 thr = load(&f.throttle[i]), tthr = load(&f.targetThrottle[i]);
+		F8 d = tthr - thr;
+		F8 stepped = thr + select(gt(d, zero), maxThrStep, zero - maxThrStep);
+		thr = clampv(select(lt(vabs(d), maxThrStep), tthr, stepped), zero, one);
+		store(&f.throttle[i], thr);
+
+		// Yaw rate follows its target with limited acceleration, roll follows the yaw rate
+		F8 rate = load(&f.currentYawRate[i]);
+		rate = rate + clampv(load(&f.targetYawRate[i]) - rate, zero - yawStep, yawStep);
+		store(&f.currentYawRate[i], rate);
+
+		Q8 q = { load(&f.qw[i]), load(&f.qx[i]), load(&f.qy[i]), load(&f.qz[i]) };
+		F8 sx = one - two * (q.y * q.y + q.z * q.z), sy = two * (q.x * q.y + q.w * q.z), sz = two * (q.x * q.z - q.w * q.y);
+		F8 fx = forwardX(q), fy = forwardY(q), fz = forwardZ(q);
+		F8 uy = one - two * (q.x * q.x + q.z * q.z);
+		F8 roll = asin8(sy / vsqrt(sy * sy + uy * uy));
+		F8 desired = clampv(zero - rate * set1(0.5f), rollLo, rollHi);
+		F8 rollRate = clampv(desired - roll, zero - rollStep, rollStep) / vdt;
+
+		// integrateAttitude: world rate = yaw about the vertical + body pitch and roll
+		F8 pr = load(&f.pitchRate[i]);
+		F8 wx = zero + sx * pr + fx * rollRate, wy = rate + sy * pr + fy * rollRate, wz = zero + sz * pr + fz * rollRate;
+		Q8 r = { q.w - halfDt * (wx * q.x + wy * q.y + wz * q.z),
+			q.x + halfDt * (wx * q.w + wy * q.z - wz * q.y),
+			q.y + halfDt * (wy * q.w + wz * q.x - wx * q.z),
+			q.z + halfDt * (wz * q.w + wx * q.y - wy * q.x) };
+		F8 inv = one / vsqrt(r.w * r.w + r.x * r.x + r.y * r.y + r.z * r.z);
+		q = { r.w * inv, r.x * inv, r.y * inv, r.z * inv };
+
+		F8 pitch = pitch8(q);
+		F8 limited = clampv(pitch, pitchLo, pitchHi);
+		q = pitchBy8(q, limited - pitch);
+		pitch = limited;
+
+		// Forces: thrust along the nose, lift across and drag against the path, gravity
+		F8 spd = load(&f.speed[i]), path = load(&f.pathPitch[i]);
+		F8 alpha = path - pitch;
+		F8 cl, cd, sa, ca, sg, cg;
+		coefficients8(grid, alpha, spd, cl, cd);
+		sincos8(alpha, sa, ca);
+		sincos8(path, sg, cg);
+		F8 qS = halfRhoS * spd * spd;
+		F8 thrust = thr * maxThrust;
+		F8 dSpeed = (thrust * ca - qS * cd) * invMass + gravity * sg;
+		F8 dPath = (gravity * cg - (qS * cl + thrust * sa) * invMass) / vmax(spd, one);
+		spd = clampv(spd + dSpeed * vdt, zero, maxSpeed);
+		path = clampv(path + dPath * vdt, pathLo, pathHi);
+		store(&f.speed[i], spd);
+		store(&f.pathPitch[i], path);
+
+		// Stall: past the stall angle or below the stall speed the nose drops
+		F8 px = load(&f.posX[i]), py = load(&f.posY[i]), pz = load(&f.posZ[i]);
+		F8 stall = (gt(alpha, stallAlpha) | lt(spd, stallSpeed)) & gt(py, stallMinY);
+		q = pitchBy8(q, select(stall, (noseDown - pitch) * stallK, zero));
+		store(&f.stalling[i], select(stall, one, zero));
+		store(&f.qw[i], q.w);
+		store(&f.qx[i], q.x);
+		store(&f.qy[i], q.y);
+		store(&f.qz[i], q.z);
+
+		sincos8(path, sg, cg);
+		store(&f.verticalSpeed[i], zero - spd * sg);
+
+		// path direction = heading of the nose tilted by the path angle
+		fx = forwardX(q);
+		fz = forwardZ(q);
+		F8 invH = one / vsqrt(fx * fx + fz * fz);
+		F8 dist = spd * vdt;
+		store(&f.posX[i], px + fx * invH * cg * dist);
+		store(&f.posY[i], py - sg * dist);
+		store(&f.posZ[i], pz + fz * invH * cg * dist);
+	}
+}
+
+#else
+
+void integrateFlight(FlightSoA& f, float dt, const FlightParams& p) {
+	integrateFlightReference(f, dt, p);
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef FLIGHTSOA_H
+#define FLIGHTSOA_H
+
+#include "aero.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstddef>
+
+// Constants of the airborne flight model, as used by integrateAircraft
+struct FlightParams {
+	const AircraftType* type; // every lane is of this type
+	float minY;          // stall only above minY + 0.5
+	float gravity;
+	float stallNoseDown; // pitch a stalled aircraft falls towards
+	float stallBlend;    // rate of that blend, 1/s
+	float maxPathPitch;  // rad, either way
+	float yawAccel;      // rad/s^2
+	float rollAccel;     // rad/s
+};
+
+// Airborne aircraft as structure of arrays. The arrays are padded to a whole
+// number of 8-wide batches; padding lanes are integrated too and ignored.
+struct FlightSoA {
+	static const int BATCH = 8;
+
+	std::vector<float> posX, posY, posZ;
+	std::vector<float> qw, qx, qy, qz; // attitude quaternion, see attitude.h
+	std::vector<float> speed, pathPitch;
+	std::vector<float> throttle, targetThrottle;
+	std::vector<float> currentYawRate, targetYawRate, pitchRate;
+	std::vector<float> verticalSpeed; // output only
+	std::vector<float> stalling; // 0 or 1
+
+	size_t size() const { return count; }
+	void resize(size_t n); // keeps the first n lanes, zeroes new ones
+
+private:
+	size_t count = 0;
+};
+
+// One airborne step of throttle smoothing, attitude rates, aerodynamic forces,
+// stall and motion along the flight path. The reference path uses the same
+// AircraftType and attitude.h calls as the per-aircraft code. The batched path
+// reads the coefficient tables lane by lane, does the rest with closed-form
+// quaternion algebra and trig eight aircraft per AVX instruction (two SSE halves
+// without AVX), and differs from the reference only by the rounding of its
+// sin/cos/asin approximations; it reads roll with asin, so it assumes the
+// aircraft is not upside down, which cruising traffic never is.
+void integrateFlightReference(FlightSoA& f, float dt, const FlightParams& p);
+void integrateFlight(FlightSoA& f, float dt, const FlightParams& p);
+
+#endif
@@ -0,0 +1,255 @@
+#include "flythrough.h"
+#include "simulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+const float ROLL_LENGTH = 250.0f;      // m of runway before rotation
+const float CLIMB_LENGTH = 250.0f;     // m from rotation to the end of the climb out
+const float CLIMB_HEIGHT = 40.0f;      // above the runway at the end of the climb out
+const float LOW_PASS_HEIGHT = 20.0f;   // above the runway
+const float LOW_PASS_CLEARANCE = 6.0f; // m, narrower than the AI routes to fit between towers
+const float FIX_HEIGHT = 20.0f;        // above the runway, start of the final
+const float FINAL_LENGTH = 150.0f;     // fix to threshold, shortened by the map edge
+const float TOUCHDOWN_PAST = 60.0f;    // aim point past the threshold
+const float ROLLOUT_LENGTH = 220.0f;
+const float MIN_LEG = 10.0f;           // m across, shorter planner legs are merged
+const float MAX_GRADIENT = 0.25f;      // climb or sink per m flown, about 14 degrees
+const float MAX_BANK = 0.87f;          // rad, about 50 degrees
+const float G = 9.81f;
+
+struct PathPoint {
+	glm::vec3 pos;
+	float speed;
+	float throttle;
+	FlyThroughPhase phase; // of the leg that ends here
+	bool pinned;           // height kept when the gradients are limited
+};
+
+// Raises p until it has the clearance the planner needs at its ends
+glm::vec3 clearPoint(glm::vec3 p, float clearance) {
+	if (!navGrid.loaded()) return p;
+	for (int i = 0; i < 40 && navGrid.clearance(p) < clearance; i++) p.y += 5.0f;
+	return p;
+}
+
+float horizontal(glm::vec3 a, glm::vec3 b) {
+	return glm::length(glm::vec2(b.x - a.x, b.z - a.z));
+}
+
+// The planner climbs and sinks up to 45 degrees between its blocks, steep for
+// the slow jet. Raises the free points until no leg is steeper than
+// MAX_GRADIENT; a leg between raised ends stays above the planned one.
+void limitGradients(std::vector<PathPoint>& path) {
+	for (size_t i = 1; i < path.size(); i++) {
+		if (!path[i].pinned) path[i].pos.y = std::max(path[i].pos.y, path[i - 1].pos.y - MAX_GRADIENT * horizontal(path[i - 1].pos, path[i].pos));
+	}
+	for (size_t i = path.size() - 1; i-- > 0;) {
+		if (!path[i].pinned) path[i].pos.y = std::max(path[i].pos.y, path[i + 1].pos.y - MAX_GRADIENT * horizontal(path[i].pos, path[i + 1].pos));
+	}
+}
+
+// Appends the way from the last point to `to`: a nav grid route, or a straight
+// line without one
+void route(std::vector<PathPoint>& path, glm::vec3 to, float clearance, float speed, float throttle, FlyThroughPhase phase) {
+	NavPlanner planner;
+	NavPlanner::Config cfg;
+	cfg.clearance = clearance;
+	std::vector<glm::vec3> points;
+	if (!navGrid.loaded() || !planner.findPath(navGrid, path.back().pos, to, cfg, points)) points = { path.back().pos, to };
+	for (size_t i = 1; i < points.size(); i++) {
+		// The rounded corners can curl within a few metres of the ends
+		if (i + 1 < points.size() && horizontal(points[i], path.back().pos) < MIN_LEG) continue;
+		path.push_back({ points[i], speed, throttle, phase, false });
+	}
+}
+
+struct Stats {
+	double avg = 0.0, median = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+};
+
+// Nearest-rank percentiles
+template <typename Field>
+Stats stats(const std::vector<RenderFrameSample>& samples, Field field) {
+	Stats st;
+	std::vector<double> v;
+	for (const RenderFrameSample& s : samples) v.push_back(field(s));
+	if (v.empty()) return st;
+	std::sort(v.begin(), v.end());
+	for (double x : v) st.avg += x;
+	st.avg /= double(v.size());
+	auto rank = [&](double q) {
+		size_t k = std::min(v.size(), size_t(std::ceil(q * v.size())));
+		return v[k ? k - 1 : 0];
+	};
+	st.median = rank(0.5);
+	st.p95 = rank(0.95);
+	st.p99 = rank(0.99);
+	st.max = v.back();
+	return st;
+}
+
+}
+
+const char* flyThroughPhaseName(FlyThroughPhase phase) {
+	switch (phase) {
+	case FLY_TAKEOFF: return "takeoff";
+	case FLY_TRANSIT: return "transit";
+	case FLY_LOW_PASS: return "low pass";
+	case FLY_LANDING: return "landing";
+	default: return "?";
+	}
+}
+
+bool buildFlyThrough(float frameSeconds, std::vector<FlyThroughFrame>& frames) {
+	frames.clear();
+	if (airportRunwayAABBs.empty() || aircraft.empty() || frameSeconds <= 0.0f) return false;
+
+	const AircraftParams& jet = jetType.params();
+	const RunwayInfo rw = mainRunway();
+	const glm::vec3 start = aircraft[0].airplane.pos; // on the +z end, facing -z
+	const float groundY = start.y;
+	const float cruiseSpeed = std::max(jet.stallSpeed * 1.6f, jet.maxSpeed * 0.75f);
+	const float cruiseClearance = NavPlanner::Config().clearance;
+
+	std::vector<PathPoint> path;
+	path.push_back({ start, 0.0f, 1.0f, FLY_TAKEOFF, true });
+	float rotateZ = std::max(rw.minZ + 60.0f, start.z - ROLL_LENGTH);
+	path.push_back({ glm::vec3(start.x, groundY, rotateZ), jet.minTakeoffSpeed * 1.1f, 1.0f, FLY_TAKEOFF, true });
+	glm::vec3 climbOut(start.x, rw.groundY + CLIMB_HEIGHT, std::max(MIN_Z + 40.0f, rotateZ - CLIMB_LENGTH));
+	path.push_back({ clearPoint(climbOut, cruiseClearance), cruiseSpeed, 0.9f, FLY_TAKEOFF, false });
+
+	// Across the middle of the map, starting from the nearer side
+	float midZ = 0.5f * (MIN_Z + MAX_Z);
+	glm::vec3 lowA = clearPoint(glm::vec3(MIN_X + 60.0f, rw.groundY + LOW_PASS_HEIGHT, midZ), LOW_PASS_CLEARANCE);
+	glm::vec3 lowB = clearPoint(glm::vec3(MAX_X - 60.0f, rw.groundY + LOW_PASS_HEIGHT, midZ), LOW_PASS_CLEARANCE);
+	if (glm::distance(path.back().pos, lowB) < glm::distance(path.back().pos, lowA)) std::swap(lowA, lowB);
+	route(path, lowA, LOW_PASS_CLEARANCE, cruiseSpeed, 0.6f, FLY_TRANSIT);
+	route(path, lowB, LOW_PASS_CLEARANCE, cruiseSpeed, 0.7f, FLY_LOW_PASS);
+
+	// Back to the +z end and straight in towards -z
+	float fixZ = std::min(rw.maxZ + FINAL_LENGTH, MAX_Z - 10.0f);
+	route(path, clearPoint(glm::vec3(start.x, rw.groundY + FIX_HEIGHT, fixZ), cruiseClearance), cruiseClearance, cruiseSpeed, 0.5f, FLY_TRANSIT);
+	path.back().speed = jet.stallSpeed * 1.3f;
+	path.back().throttle = 0.3f;
+	path.back().pinned = true;
+	float touchdownZ = rw.maxZ - TOUCHDOWN_PAST;
+	path.push_back({ glm::vec3(start.x, groundY, touchdownZ), jet.stallSpeed * 1.1f, 0.1f, FLY_LANDING, true });
+	path.push_back({ glm::vec3(start.x, groundY, std::max(rw.minZ + 40.0f, touchdownZ - ROLLOUT_LENGTH)), 0.0f, 0.0f, FLY_LANDING, true });
+	limitGradients(path);
+
+	std::vector<float> arc(path.size(), 0.0f);
+	for (size_t i = 1; i < path.size(); i++) arc[i] = arc[i - 1] + glm::distance(path[i - 1].pos, path[i].pos);
+	const float total = arc.back();
+	auto at = [&](float d) {
+		d = glm::clamp(d, 0.0f, total);
+		size_t i = std::upper_bound(arc.begin(), arc.end(), d) - arc.begin();
+		if (i == 0) return path.front().pos;
+		if (i >= path.size()) return path.back().pos;
+		float len = arc[i] - arc[i - 1];
+		return glm::mix(path[i - 1].pos, path[i].pos, len > 0.0f ? (d - arc[i - 1]) / len : 1.0f);
+	};
+
+	size_t seg = 0;
+	for (float d = 0.0f; d < total;) {
+		while (seg + 2 < path.size() && arc[seg + 1] <= d) seg++;
+		const PathPoint& a = path[seg];
+		const PathPoint& b = path[seg + 1];
+		float len = arc[seg + 1] - arc[seg];
+		float u = len > 0.0f ? (d - arc[seg]) / len : 1.0f;
+
+		FlyThroughFrame f;
+		f.pos = glm::mix(a.pos, b.pos, u);
+		f.speed = std::sqrt(glm::mix(a.speed * a.speed, b.speed * b.speed, u)); // constant acceleration over the leg
+		f.throttle = glm::mix(a.throttle, b.throttle, u);
+		f.onGround = f.pos.y <= groundY + 0.01f;
+		f.phase = b.phase;
+
+		// Nose along the path, lift tilted towards the centre of the turn
+		glm::vec3 forward = at(d + 4.0f) - at(d - 4.0f);
+		forward = glm::length(forward) > 1e-4f ? glm::normalize(forward) : glm::vec3(0.0f, 0.0f, -1.0f);
+		glm::vec3 up(0.0f, 1.0f, 0.0f);
+		if (!f.onGround) {
+			glm::vec3 before = at(d) - at(d - 8.0f), after = at(d + 8.0f) - at(d);
+			glm::vec3 turn(0.0f);
+			if (glm::length(before) > 1e-3f && glm::length(after) > 1e-3f) {
+				turn = (glm::normalize(after) - glm::normalize(before)) * (f.speed * f.speed / 8.0f);
+				turn.y = 0.0f;
+			}
+			float lateral = glm::length(turn);
+			if (lateral > G * std::tan(MAX_BANK)) turn *= G * std::tan(MAX_BANK) / lateral;
+			up = glm::normalize(glm::vec3(0.0f, G, 0.0f) + turn);
+		}
+		glm::vec3 side = glm::cross(up, forward);
+		side = glm::length(side) > 1e-4f ? glm::normalize(side) : glm::vec3(1.0f, 0.0f, 0.0f);
+		f.attitude = glm::quat_cast(glm::mat3(side, glm::cross(forward, side), forward));
+		frames.push_back(f);
+
+		d += std::max(f.speed, 2.0f) * frameSeconds;
+	}
+	return !frames.empty();
+}
+
+void reportRenderBenchmark(const std::vector<RenderFrameSample>& samples, const std::string& csvPath) {
+	if (samples.empty()) return;
+	printf("%zu frames\n", samples.size());
+	printf("%-10s %8s %8s %8s %8s %8s\n", "ms", "avg", "median", "p95", "p99", "max");
+	auto row = [](const char* name, const Stats& st) {
+		printf("%-10s %8.3f %8.3f %8.3f %8.3f %8.3f\n", name, st.avg, st.median, st.p95, st.p99, st.max);
+	};
+	row("CPU", stats(samples, [](const RenderFrameSample& s) { return s.cpuMs; }));
+	row("GPU", stats(samples, [](const RenderFrameSample& s) { return s.gpuMs; }));
+	row("frame", stats(samples, [](const RenderFrameSample& s) { return s.frameMs; }));
+	Stats calls = stats(samples, [](const RenderFrameSample& s) { return double(s.drawCalls); });
+	Stats tris = stats(samples, [](const RenderFrameSample& s) { return double(s.triangles); });
+	printf("draw calls per frame: avg %.0f, max %.0f; triangles per frame: avg %.0f, max %.0f\n", calls.avg, calls.max, tris.avg, tris.max);
+
+	printf("\n%-10s %7s %10s %10s %10s %8s %10s\n", "phase", "frames", "CPU ms", "GPU ms", "frame ms", "calls", "triangles");
+	for (int p = 0; p < FLY_PHASES; p++) {
+		std::vector<RenderFrameSample> phase;
+		for (const RenderFrameSample& s : samples) {
+			if (s.phase == p) phase.push_back(s);
+		}
+		if (phase.empty()) continue;
+		printf("%-10s %7zu %10.3f %10.3f %10.3f %8.0f %10.0f\n", flyThroughPhaseName((FlyThroughPhase)p), phase.size(),
+			stats(phase, [](const RenderFrameSample& s) { return s.cpuMs; }).median,
+			stats(phase, [](const RenderFrameSample& s) { return s.gpuMs; }).median,
+			stats(phase, [](const RenderFrameSample& s) { return s.frameMs; }).median,
+			stats(phase, [](const RenderFrameSample& s) { return double(s.drawCalls); }).median,
+			stats(phase, [](const RenderFrameSample& s) { return double(s.triangles); }).median);
+	}
+
+	// 1 ms buckets, the last one takes everything from 33 ms (under 30 fps) up
+	const int BUCKETS = 34, BAR = 50;
+	int counts[BUCKETS] = {};
+	for (const RenderFrameSample& s : samples) counts[std::min(BUCKETS - 1, std::max(0, int(s.frameMs)))]++;
+	int first = 0, last = BUCKETS - 1, most = 1;
+	while (first < last && counts[first] == 0) first++;
+	while (last > first && counts[last] == 0) last--;
+	for (int b = first; b <= last; b++) most = std::max(most, counts[b]);
+	printf("\nframe time histogram\n");
+	for (int b = first; b <= last; b++) {
+		char label[16];
+		if (b == BUCKETS - 1) snprintf(label, sizeof(label), ">= %d ms", b);
+		else snprintf(label, sizeof(label), "%2d-%2d ms", b, b + 1);
+		int width = counts[b] ? std::max(1, counts[b] * BAR / most) : 0;
+		printf("%-9s %7d %s\n", label, counts[b], std::string(width, '#').c_str());
+	}
+
+	FILE* csv = fopen(csvPath.c_str(), "w");
+	if (!csv) {
+		fprintf(stderr, "Cannot write %s\n", csvPath.c_str());
+		return;
+	}
+	fprintf(csv, "frame,phase,cpu_ms,gpu_ms,frame_ms,draw_calls,triangles\n");
+	for (size_t i = 0; i < samples.size(); i++) {
+		const RenderFrameSample& s = samples[i];
+		fprintf(csv, "%zu,%s,%.4f,%.4f,%.4f,%lld,%lld\n", i, flyThroughPhaseName(s.phase), s.cpuMs, s.gpuMs, s.frameMs,
+			s.drawCalls, s.triangles);
+	}
+	fclose(csv);
+	printf("Frames written to %s\n", csvPath.c_str());
+}
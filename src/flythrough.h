@@ -0,0 +1,53 @@
+#ifndef FLYTHROUGH_H
+#define FLYTHROUGH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <string>
+#include <vector>
+
+enum FlyThroughPhase {
+	FLY_TAKEOFF,  // ground roll, rotation and climb out
+	FLY_TRANSIT,  // routes between the scripted legs
+	FLY_LOW_PASS, // across the middle of the map at rooftop height
+	FLY_LANDING,  // final approach, touchdown and rollout
+	FLY_PHASES
+};
+
+const char* flyThroughPhaseName(FlyThroughPhase phase);
+
+// Player state of one rendered frame
+struct FlyThroughFrame {
+	glm::vec3 pos;
+	glm::quat attitude;
+	float speed;
+	float throttle;
+	bool onGround;
+	FlyThroughPhase phase;
+};
+
+// Scripted flight over the loaded world, the same for every run on the same
+// map: takeoff from the player's start, a low pass between the buildings in the
+// middle of the map, then an approach and landing on the same runway. The legs
+// in the air are routed through the nav grid; attitude follows the path with
+// the bank of a coordinated turn. One frame every frameSeconds of flight.
+// Needs initWorld() first, before anything has moved the player.
+bool buildFlyThrough(float frameSeconds, std::vector<FlyThroughFrame>& frames);
+
+// Measurements of one rendered frame
+struct RenderFrameSample {
+	double cpuMs;   // drawScene on the CPU, submission only
+	double gpuMs;   // GPU timestamps around drawScene
+	double frameMs; // swap to swap
+	long long drawCalls;
+	long long triangles;
+	FlyThroughPhase phase;
+};
+
+// Average, median, 95th and 99th percentile and worst of the CPU, GPU and frame
+// times, medians per phase, draw calls and triangles, and a histogram of the
+// frame times in 1 ms buckets. Every frame goes to csvPath.
+void reportRenderBenchmark(const std::vector<RenderFrameSample>& samples, const std::string& csvPath);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef GPUMODEL_H
+#define GPUMODEL_H
+
+#include <GL/glew.h>
+
+#include "shaderprogram.h"
+
+#include <string>
+#include <vector>
+
+// The simulator's model drawing path (main_file.cpp), shared with the city benchmark
+
+extern ShaderProgram* sp; // drawModel draws with it
+
+// Vertex buffers of a model, one per material and attribute; 0 for a material without triangles
+struct GpuModel {
+	std::vector<GLuint> verts, norms, uvs;
+};
+
+// 1x1 texture of one material colour
+GLuint makeColorTexture(float r, float g, float b, float a = 1.0f);
+
+// Moves the per-material arrays of a loaded model into vertex buffers; with
+// --drop-cpu-copies the arrays are freed afterwards
+void uploadModel(const std::string& asset, std::vector<std::vector<float>>& verts,
+	std::vector<std::vector<float>>& norms, std::vector<std::vector<float>>& uvs, GpuModel& gpu);
+
+// One draw call per material with triangles, with the current P, V and M uniforms of sp
+void drawModel(const GpuModel& model, const std::vector<int>& countsPerMat, const std::vector<GLuint>& matTexIDs);
+
+#endif
@@ -0,0 +1,145 @@
+#include "gpws.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+
+namespace {
+
+const int PATH_SEGMENTS = 4;        // predicted path, bent by the current turn rate
+const int FAN_YAW = 5;              // straight rays around the initial direction
+const int FAN_PITCH = 3;
+const float FAN_YAW_STEP = glm::radians(12.0f);
+const float FAN_PITCH_STEP = glm::radians(8.0f);
+
+const float PULL_UP_SECONDS = 4.0f; // time to impact on the path that raises PULL UP
+const float LOOKAHEAD_SECONDS = 6.0f;
+const float MIN_LOOKAHEAD = 20.0f;  // metres, so a slow aircraft still looks ahead
+const float TOO_LOW_HEIGHT = 4.0f;  // above the surface below
+
+static_assert(Gpws::RAYS_PER_SWEEP == PATH_SEGMENTS + FAN_YAW * FAN_PITCH + 1, "sweep size");
+
+enum RayKind { RAY_PATH, RAY_FAN, RAY_DOWN };
+
+struct Ray {
+	glm::vec3 a, b;
+	RayKind kind;
+	float seconds; // flight time to b along the path
+};
+
+glm::vec3 rotateY(const glm::vec3& v, float angle) {
+	float c = std::cos(angle), s = std::sin(angle);
+	return glm::vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+}
+
+// Builds the rays of one sweep for state s, in casting order
+int buildRays(const GpwsState& s, Ray* rays) {
+	int n = 0;
+	float speed = glm::max(s.speed, MIN_LOOKAHEAD / LOOKAHEAD_SECONDS);
+
+	// Path first: it decides PULL UP, so it is cast at the start of every sweep
+	glm::vec3 p = s.pos, dir = s.forward;
+	float dt = LOOKAHEAD_SECONDS / PATH_SEGMENTS;
+	for (int i = 0; i < PATH_SEGMENTS; i++) {
+		glm::vec3 next = p + dir * (speed * dt);
+		rays[n++] = { p, next, RAY_PATH, (i + 1) * dt };
+		p = next;
+		dir = rotateY(dir, s.turnRate * dt);
+	}
+
+	glm::vec3 side = glm::cross(s.forward, glm::vec3(0, 1, 0));
+	side = glm::length(side) > 1e-4f ? glm::normalize(side) : glm::vec3(1, 0, 0);
+	for (int iy = 0; iy < FAN_YAW; iy++) {
+		for (int ip = 0; ip < FAN_PITCH; ip++) {
+			float yaw = (iy - FAN_YAW / 2) * FAN_YAW_STEP;
+			float pitch = (ip - FAN_PITCH / 2) * FAN_PITCH_STEP;
+			glm::vec3 d = rotateY(s.forward, yaw);
+			d = glm::vec3(glm::rotate(glm::mat4(1.0f), pitch, side) * glm::vec4(d, 0.0f));
+			rays[n++] = { s.pos, s.pos + d * (speed * LOOKAHEAD_SECONDS), RAY_FAN, LOOKAHEAD_SECONDS };
+		}
+	}
+
+	rays[n++] = { s.pos, s.pos - glm::vec3(0, TOO_LOW_HEIGHT, 0), RAY_DOWN, 0.0f };
+	return n;
+}
+
+}
+
+
+void Gpws::start(RayFn cast, float tickSeconds, int raysPerTick) {
+	stop();
+	castRay = std::move(cast);
+	tick = tickSeconds;
+	budget = glm::max(1, raysPerTick);
+	running = true;
+	worker = std::thread(&Gpws::run, this);
+}
+
+void Gpws::stop() {
+	if (!running.exchange(false)) return;
+	worker.join();
+}
+
+void Gpws::post(const GpwsState& state) {
+	states.writeBuffer() = state;
+	states.publish();
+}
+
+void Gpws::run() {
+	using clock = std::chrono::steady_clock;
+	const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(tick));
+
+	Ray rays[RAYS_PER_SWEEP];
+	int rayCount = 0, next = 0;
+	uint32_t pending = 0;
+	float pathImpact = 1e9f; // seconds to the first hit on the path
+
+	auto wake = clock::now();
+	while (running.load(std::memory_order_acquire)) {
+		// A sweep is cast from one state so its rays agree with each other
+		if (next == rayCount) {
+			states.update();
+			const GpwsState& s = states.read();
+			if (!s.active) {
+				published.store(0, std::memory_order_relaxed);
+				rayCount = next = 0;
+			}
+			else {
+				rayCount = buildRays(s, rays);
+				next = 0;
+				pending = 0;
+				pathImpact = 1e9f;
+			}
+		}
+
+		const GpwsState& s = states.read();
+		for (int cast = 0; cast < budget && next < rayCount; cast++, next++) {
+			const Ray& r = rays[next];
+			GpwsHit hit;
+			if (!castRay(r.a, r.b, hit)) continue;
+
+			switch (r.kind) {
+			case RAY_PATH: {
+				float seconds = r.seconds - (1.0f - hit.t) * (LOOKAHEAD_SECONDS / PATH_SEGMENTS);
+				pathImpact = glm::min(pathImpact, seconds);
+				if (pathImpact < PULL_UP_SECONDS) pending |= GPWS_PULL_UP;
+				break;
+			}
+			case RAY_FAN:
+				if (hit.building) pending |= GPWS_BUILDING_AHEAD;
+				break;
+			case RAY_DOWN:
+				if (!s.landing) pending |= GPWS_TOO_LOW;
+				break;
+			}
+		}
+		if (rayCount > 0 && next == rayCount) {
+			published.store(pending, std::memory_order_relaxed);
+		}
+
+		wake += period;
+		auto now = clock::now();
+		if (now - wake > period * 8) wake = now;
+		std::this_thread::sleep_until(wake);
+	}
+}
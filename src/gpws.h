@@ -0,0 +1,67 @@
+#ifndef GPWS_H
+#define GPWS_H
+
+#include "simsync.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+enum GpwsAlert : uint32_t {
+	GPWS_PULL_UP = 1u << 0,       // the predicted path hits something soon
+	GPWS_TOO_LOW = 1u << 1,       // close to the ground outside a landing approach
+	GPWS_BUILDING_AHEAD = 1u << 2, // a building within the look-ahead fan
+};
+
+// Aircraft state the warning system predicts from, posted by the simulation
+struct GpwsState {
+	glm::vec3 pos;
+	glm::vec3 forward; // unit flight direction
+	float speed;
+	float turnRate;    // yaw rate, rad/s
+	bool active;       // airborne and not exploding
+	bool landing;      // on approach, low altitude is expected
+};
+
+struct GpwsHit {
+	float t;       // fraction of the ray, 0..1
+	bool building; // wall or roof rather than open ground
+};
+
+// Ground-proximity warnings. A worker thread casts a fan of look-ahead rays
+// along the predicted path of the newest posted state, a fixed number of rays
+// per tick, and publishes the alerts when a sweep is complete. Posting and
+// reading never block.
+class Gpws {
+public:
+	// cast(a, b, hit) finds the first static geometry on the segment a->b; it is
+	// called from the worker thread and must only read immutable data
+	using RayFn = std::function<bool(const glm::vec3& a, const glm::vec3& b, GpwsHit& hit)>;
+
+	~Gpws() { stop(); }
+
+	void start(RayFn cast, float tickSeconds, int raysPerTick);
+	void stop();
+
+	void post(const GpwsState& state); // simulation thread
+	uint32_t alerts() const { return published.load(std::memory_order_relaxed); }
+
+	static const int RAYS_PER_SWEEP = 4 + 5 * 3 + 1; // path segments + fan + one down
+
+private:
+	RayFn castRay;
+	float tick = 1.0f / 120.0f;
+	int budget = 6;
+
+	TripleBuffer<GpwsState> states;
+	std::atomic<uint32_t> published{ 0 };
+	std::atomic<bool> running{ false };
+	std::thread worker;
+
+	void run();
+};
+
+#endif
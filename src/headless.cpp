@@ -0,0 +1,352 @@
+// Headless simulator: the flight model, collision and AI traffic without a
+// window or GL, stepped as fast as the CPU allows.
+//
+//   headless <scenario.txt> [--script <file>] [--seconds <s>] [--record <log.inpl>]
+//   headless --replay <log.inpl>
+//   headless --telemetry-info <file.tlm> [--at <s>]
+//   headless [scenario.txt] --landing-sweep <samples> [--threads <n>] [--seed <n>] [--csv <file>]
+//   headless [scenario.txt] --bench-ai [--threads <n>]
+//   headless [scenario.txt] --bench-nav [--seed <n>]
+//   headless [scenario.txt] --bench-micro [--json <file>] [--baseline <file>]
+//
+// --threads sizes the job system of the simulation tick as well as the sweep.
+// --telemetry <file.tlm> records every tick of a scenario run or a replay.
+
+#include "simulation.h"
+#include "scenario.h"
+#include "landingsweep.h"
+#include "microbench.h"
+#include "jobs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int replayLog(const std::string& path) {
+	InputLogHeader header;
+	if (!inputReplay.load(path, header)) {
+		std::cerr << "Cannot read input log " << path << "\n";
+		return 1;
+	}
+	if (header.tickSeconds != SIM_DT) {
+		std::cerr << path << " was recorded with a different tick (" << header.tickSeconds << " s)\n";
+		return 1;
+	}
+	aiAircraftCount = header.aiAircraft;
+	cityObjPath = header.cityObj;
+	if (!initWorld()) return 1;
+	applyLogStart(header);
+
+	replayActive = true;
+	int result = runReplay();
+	telemetryRecorder.close();
+	return result;
+}
+
+int runScenario(const Scenario& scenario, const std::vector<ScriptedInput>& script, const std::string& recordPath) {
+	aiAircraftCount = scenario.aiAircraft;
+	cityObjPath = scenario.cityObj;
+	if (!initWorld()) return 1;
+	applyScenarioStart(scenario);
+
+	if (!recordPath.empty()) {
+		if (!inputRecorder.open(recordPath, sessionLogHeader())) {
+			std::cerr << "Cannot write input log " << recordPath << "\n";
+			return 1;
+		}
+	}
+
+	const uint64_t ticks = (uint64_t)(scenario.seconds / SIM_DT + 0.5f);
+	std::vector<InputEvent> events;
+	size_t next = 0;
+	int explosions = 0;
+	std::vector<bool> exploding(aircraft.size(), false);
+
+	auto start = std::chrono::steady_clock::now();
+	while (simTick < ticks) {
+		events.clear();
+		while (next < script.size() && script[next].tick <= simTick) events.push_back(script[next++].event);
+		simulateTick(events.data(), events.size());
+
+		for (size_t i = 0; i < aircraft.size(); i++) {
+			if (aircraft[i].explosionActive && !exploding[i]) explosions++;
+			exploding[i] = aircraft[i].explosionActive;
+		}
+	}
+	double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	sec = std::max(sec, 1e-9);
+	inputRecorder.close(simTick, hashSimState());
+	telemetryRecorder.close();
+
+	const Aircraft& p = aircraft[0];
+	double simSec = double(simTick) * SIM_DT;
+	printf("%.1f s simulated (%" PRIu64 " ticks, %zu aircraft) in %.3f s: %.1fx real time, %.0f ticks/s\n",
+		simSec, simTick, aircraft.size(), sec, simSec / sec, double(simTick) / sec);
+	printf("Player: pos (%.2f, %.2f, %.2f), speed %.2f, %s\n", p.airplane.pos.x, p.airplane.pos.y, p.airplane.pos.z,
+		p.airplane.speed, p.explosionActive ? "exploding" : (p.onGround ? "on ground" : "in air"));
+	printf("Explosions: %d, state hash %016" PRIx64 "\n", explosions, hashSimState());
+	return 0;
+}
+
+int landingSweep(const Scenario& scenario, const LandingSweepConfig& cfg) {
+	aiAircraftCount = 0; // the sweep flies its own aircraft
+	cityObjPath = scenario.cityObj;
+	if (!initWorld()) return 1;
+	return runLandingSweep(cfg);
+}
+
+
+// Ticks per second of the whole simulation at growing AI traffic, on one
+// thread and on every thread of the job system
+int benchAiTraffic(const Scenario& scenario) {
+	aiAircraftCount = 0;
+	cityObjPath = scenario.cityObj;
+	if (!initWorld()) return 1;
+	simTickReport = false;
+
+	const int counts[] = { 100, 1000, 10000 };
+	const int allThreads = sharedJobs().threadCount();
+	const int WARMUP_TICKS = 30;
+	const double MIN_SECONDS = 2.0;
+	printf("AI traffic tick, %d job threads\n", allThreads);
+	printf("%10s %8s %12s %12s\n", "aircraft", "threads", "ticks/s", "ms/tick");
+	for (int count : counts) {
+		for (int threads : { 1, allThreads }) {
+			sharedJobs().resize(threads);
+			spawnAiTraffic(count);
+			for (int i = 0; i < WARMUP_TICKS; i++) simulateTick(nullptr, 0);
+
+			int ticks = 0;
+			auto start = std::chrono::steady_clock::now();
+			double sec = 0.0;
+			do {
+				simulateTick(nullptr, 0);
+				ticks++;
+				sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			} while (sec < MIN_SECONDS);
+			printf("%10d %8d %12.1f %12.3f\n", count, threads, ticks / sec, 1000.0 * sec / ticks);
+			if (allThreads == 1) break;
+		}
+	}
+	printf("Tick budget at real time: %.3f ms\n", 1000.0 * SIM_DT);
+	return 0;
+}
+
+
+// Path queries between random points of free airspace against the 1 ms budget
+int benchNavigation(const Scenario& scenario, uint32_t seed) {
+	aiAircraftCount = 0;
+	cityObjPath = scenario.cityObj;
+	if (!initWorld()) return 1;
+	if (!navGrid.loaded()) return 1;
+
+	const int QUERIES = 2000;
+	const double BUDGET_MS = 1.0;
+	NavPlanner planner;
+	NavPlanner::Config cfg;
+	std::vector<glm::vec3> path;
+	std::vector<double> ms;
+	size_t found = 0, points = 0, expanded = 0;
+	uint32_t rng = seed;
+	auto random = [&](float lo, float hi) {
+		rng = rng * 1664525u + 1013904223u;
+		return lo + (hi - lo) * float(rng >> 8) * (1.0f / 16777216.0f);
+	};
+	auto freePoint = [&]() {
+		for (;;) {
+			glm::vec3 p(random(MIN_X, MAX_X), random(MIN_Y + 10.0f, 120.0f), random(MIN_Z, MAX_Z));
+			if (navGrid.clearance(p) >= cfg.clearance) return p;
+		}
+	};
+
+	// The first query labels the connected blocks once per planner; not timed
+	planner.findPath(navGrid, freePoint(), freePoint(), cfg, path);
+
+	size_t clear = 0; // paths whose every segment keeps at least half the clearance
+	for (int i = 0; i < QUERIES; i++) {
+		glm::vec3 from = freePoint(), to = freePoint();
+		auto start = std::chrono::steady_clock::now();
+		bool ok = planner.findPath(navGrid, from, to, cfg, path);
+		ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		if (!ok) continue;
+		found++;
+		bool segmentsClear = true;
+		for (size_t k = 1; k < path.size() && segmentsClear; k++) segmentsClear = navGrid.segmentClear(path[k - 1], path[k], 0.5f * cfg.clearance);
+		if (segmentsClear) clear++;
+		points += path.size();
+		expanded += planner.lastExpanded();
+	}
+
+	std::sort(ms.begin(), ms.end());
+	double total = 0.0;
+	for (double t : ms) total += t;
+	printf("%d path queries, clearance %.0f m: %zu found, %zu of them clear, %.1f points and %.0f blocks expanded per path\n",
+		QUERIES, cfg.clearance, found, clear, double(points) / std::max<size_t>(found, 1), double(expanded) / std::max<size_t>(found, 1));
+	printf("ms per query: avg %.3f, median %.3f, 99%% %.3f, max %.3f (budget %.1f)\n", total / QUERIES,
+		ms[QUERIES / 2], ms[QUERIES * 99 / 100], ms.back(), BUDGET_MS);
+	return ms[QUERIES * 99 / 100] <= BUDGET_MS ? 0 : 1;
+}
+
+
+int microBenchmarks(const Scenario& scenario, const MicroBenchConfig& cfg) {
+	aiAircraftCount = scenario.aiAircraft;
+	cityObjPath = scenario.cityObj;
+	if (!initWorld()) return 1;
+	applyScenarioStart(scenario);
+	return runMicroBenchmarks(cfg);
+}
+
+int telemetryInfo(const std::string& path, double atSeconds) {
+	TelemetryReader reader;
+	if (!reader.open(path)) {
+		std::cerr << "Cannot read telemetry " << path << "\n";
+		return 1;
+	}
+	const double dt = reader.tickSeconds();
+	printf("%s: %.1f s (%" PRIu64 " ticks from %" PRIu64 "), %zu chunks, %s\n", path.c_str(), reader.tickCount() * dt,
+		reader.tickCount(), reader.firstTick(), reader.chunkCount(), reader.indexed() ? "indexed" : "no index");
+
+	// Whole file once: size per aircraft and tick, decoding speed
+	TelemetryFrame frame;
+	uint64_t aircraftTicks = 0, frames = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (reader.next(frame)) {
+		aircraftTicks += frame.aircraft.size();
+		frames++;
+	}
+	double sec = std::max(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 1e-9);
+	printf("%zu bytes, %.2f per aircraft and tick (%.0f raw); decoded %" PRIu64 " frames at %.0f frames/s\n",
+		reader.fileBytes(), double(reader.fileBytes()) / std::max<uint64_t>(aircraftTicks, 1),
+		double(sizeof(TelemetryAircraft)), frames, frames / sec);
+	if (frames != reader.tickCount()) {
+		std::cerr << "Only " << frames << " frames decode\n";
+		return 1;
+	}
+
+	// Random seeks, each followed by reading the frame
+	const int SEEKS = 1000;
+	uint32_t rng = 1;
+	double worst = 0.0, total = 0.0;
+	for (int i = 0; i < SEEKS; i++) {
+		rng = rng * 1664525u + 1013904223u;
+		uint64_t tick = reader.firstTick() + uint64_t(rng) % reader.tickCount();
+		start = std::chrono::steady_clock::now();
+		bool ok = reader.seek(tick) && reader.next(frame);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (!ok || frame.tick != tick) {
+			std::cerr << "Seek to tick " << tick << " failed\n";
+			return 1;
+		}
+		total += ms;
+		worst = std::max(worst, ms);
+	}
+	printf("%d random seeks: avg %.3f ms, max %.3f ms\n", SEEKS, total / SEEKS, worst);
+
+	if (atSeconds >= 0.0) {
+		if (!reader.seekSeconds(atSeconds) || !reader.next(frame)) {
+			std::cerr << atSeconds << " s is outside the recording\n";
+			return 1;
+		}
+		const size_t SHOWN = 10;
+		printf("Tick %" PRIu64 " (%.2f s), %zu aircraft:\n", frame.tick, (frame.tick - reader.firstTick()) * dt, frame.aircraft.size());
+		for (size_t i = 0; i < std::min(frame.aircraft.size(), SHOWN); i++) {
+			const TelemetryAircraft& a = frame.aircraft[i];
+			printf("  %2zu %s pos (%.1f, %.1f, %.1f) speed %.1f vs %.1f throttle %3d%%%s%s%s\n", i,
+				(a.flags & TELEMETRY_AI) ? "ai    " : "player", a.pos.x, a.pos.y, a.pos.z, a.speed, a.verticalSpeed,
+				int(a.throttle * 100.0f + 0.5f), (a.flags & TELEMETRY_ON_GROUND) ? " ground" : "",
+				(a.flags & TELEMETRY_STALLING) ? " stall" : "", (a.flags & TELEMETRY_EXPLODING) ? " exploding" : "");
+		}
+	}
+	return 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+	std::string scenarioPath, scriptPath, replayPath, recordPath, telemetryPath, telemetryInfoPath;
+	float seconds = -1.0f;
+	double telemetryAt = -1.0;
+	LandingSweepConfig sweep;
+	bool sweepRequested = false;
+	bool benchAi = false;
+	bool benchNav = false;
+	bool benchMicro = false;
+	MicroBenchConfig micro;
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--script") && hasValue)
+			scriptPath = argv[++i];
+		else if (!strcmp(argv[i], "--seconds") && hasValue)
+			seconds = float(atof(argv[++i]));
+		else if (!strcmp(argv[i], "--record") && hasValue)
+			recordPath = argv[++i];
+		else if (!strcmp(argv[i], "--replay") && hasValue)
+			replayPath = argv[++i];
+		else if (!strcmp(argv[i], "--telemetry") && hasValue)
+			telemetryPath = argv[++i];
+		else if (!strcmp(argv[i], "--telemetry-info") && hasValue)
+			telemetryInfoPath = argv[++i];
+		else if (!strcmp(argv[i], "--at") && hasValue)
+			telemetryAt = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--landing-sweep") && hasValue) {
+			sweep.samples = atoi(argv[++i]);
+			sweepRequested = true;
+		}
+		else if (!strcmp(argv[i], "--threads") && hasValue) {
+			sweep.threads = atoi(argv[++i]);
+			sharedJobs().resize(sweep.threads);
+		}
+		else if (!strcmp(argv[i], "--bench-ai"))
+			benchAi = true;
+		else if (!strcmp(argv[i], "--bench-nav"))
+			benchNav = true;
+		else if (!strcmp(argv[i], "--bench-micro"))
+			benchMicro = true;
+		else if (!strcmp(argv[i], "--json") && hasValue)
+			micro.jsonPath = argv[++i];
+		else if (!strcmp(argv[i], "--baseline") && hasValue)
+			micro.baselinePath = argv[++i];
+		else if (!strcmp(argv[i], "--seed") && hasValue)
+			sweep.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "--csv") && hasValue)
+			sweep.csvPath = argv[++i];
+		else if (argv[i][0] != '-' && scenarioPath.empty())
+			scenarioPath = argv[i];
+		else
+			std::cerr << "Unknown argument: " << argv[i] << "\n";
+	}
+
+	if (!telemetryInfoPath.empty()) return telemetryInfo(telemetryInfoPath, telemetryAt);
+	if (!telemetryPath.empty() && !telemetryRecorder.open(telemetryPath, SIM_DT)) {
+		std::cerr << "Cannot write telemetry " << telemetryPath << "\n";
+		return 1;
+	}
+	if (!replayPath.empty()) return replayLog(replayPath);
+
+	Scenario scenario;
+	if (!scenarioPath.empty() && !loadScenario(scenarioPath, scenario)) {
+		std::cerr << "Cannot read scenario " << scenarioPath << "\n";
+		return 1;
+	}
+	if (sweepRequested) return landingSweep(scenario, sweep);
+	if (benchAi) return benchAiTraffic(scenario);
+	if (benchNav) return benchNavigation(scenario, sweep.seed);
+	if (benchMicro) return microBenchmarks(scenario, micro);
+	if (seconds > 0.0f) scenario.seconds = seconds;
+	if (!scriptPath.empty()) scenario.script = scriptPath;
+
+	std::vector<ScriptedInput> script;
+	if (!scenario.script.empty() && !loadInputScript(scenario.script, script)) {
+		std::cerr << "Cannot read input script " << scenario.script << "\n";
+		return 1;
+	}
+	return runScenario(scenario, script, recordPath);
+}
@@ -0,0 +1,168 @@
+#include "heightfield.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const size_t MAX_SAMPLES = 1 << 22;  // ~20 MB file at most
+const float MIN_UP = 0.3f;           // |normal.y| below this is a wall, not a surface
+const float ROOF_MIN_HEIGHT = 1.0f;  // surfaces this far above the ground are roofs
+
+uint64_t fnv1a(uint64_t h, const void* data, size_t bytes) {
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i = 0; i < bytes; i++) {
+		h ^= p[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+}
+
+uint64_t HeightField::hashLayers(const std::vector<HeightFieldLayer>& layers) {
+	uint64_t h = 14695981039346656037ull;
+	for (const auto& layer : layers) {
+		for (const auto& verts : *layer.vertsPerMat) {
+			if (!verts.empty()) h = fnv1a(h, verts.data(), verts.size() * sizeof(float));
+		}
+		h = fnv1a(h, &layer.offset, sizeof(layer.offset));
+		if (layer.runways && !layer.runways->empty()) {
+			h = fnv1a(h, layer.runways->data(), layer.runways->size() * sizeof(AABB));
+		}
+	}
+	return h;
+}
+
+bool HeightField::bake(const std::string& path, const std::vector<HeightFieldLayer>& layers,
+	glm::vec2 boundsMin, glm::vec2 boundsMax, float groundLevel, uint64_t sourceHash, float cellSize) {
+	glm::vec2 extent = glm::max(boundsMax - boundsMin, glm::vec2(cellSize));
+	cellSize = std::max(cellSize, std::sqrt(extent.x * extent.y / MAX_SAMPLES));
+	const int w = std::max(2, int(std::ceil(extent.x / cellSize)) + 1);
+	const int d = std::max(2, int(std::ceil(extent.y / cellSize)) + 1);
+	const float inv = 1.0f / cellSize;
+
+	std::vector<float> height(size_t(w) * d, -FLT_MAX);
+	std::vector<int8_t> owner(size_t(w) * d, -1); // layer that wrote the sample
+
+	for (size_t l = 0; l < layers.size(); l++) {
+		const HeightFieldLayer& layer = layers[l];
+		for (const auto& verts : *layer.vertsPerMat) {
+			for (size_t i = 0; i + 11 < verts.size(); i += 12) {
+				glm::vec3 a = glm::vec3(verts[i], verts[i + 1], verts[i + 2]) + layer.offset;
+				glm::vec3 b = glm::vec3(verts[i + 4], verts[i + 5], verts[i + 6]) + layer.offset;
+				glm::vec3 c = glm::vec3(verts[i + 8], verts[i + 9], verts[i + 10]) + layer.offset;
+
+				glm::vec3 n = glm::cross(b - a, c - a);
+				float len = glm::length(n);
+				if (len == 0.0f || std::abs(n.y) < MIN_UP * len) continue;
+
+				// Samples whose XZ position falls inside the triangle's footprint
+				float area = (b.x - a.x) * (c.z - a.z) - (c.x - a.x) * (b.z - a.z);
+				float invArea = 1.0f / area;
+				int x0 = std::max(0, int(std::ceil((std::min({ a.x, b.x, c.x }) - boundsMin.x) * inv)));
+				int x1 = std::min(w - 1, int(std::floor((std::max({ a.x, b.x, c.x }) - boundsMin.x) * inv)));
+				int z0 = std::max(0, int(std::ceil((std::min({ a.z, b.z, c.z }) - boundsMin.y) * inv)));
+				int z1 = std::min(d - 1, int(std::floor((std::max({ a.z, b.z, c.z }) - boundsMin.y) * inv)));
+
+				for (int iz = z0; iz <= z1; iz++) {
+					float pz = boundsMin.y + iz * cellSize;
+					for (int ix = x0; ix <= x1; ix++) {
+						float px = boundsMin.x + ix * cellSize;
+						float u = ((b.x - px) * (c.z - pz) - (c.x - px) * (b.z - pz)) * invArea;
+						float v = ((c.x - px) * (a.z - pz) - (a.x - px) * (c.z - pz)) * invArea;
+						float t = 1.0f - u - v;
+						const float eps = -1e-4f; // shared edges must not leave cracks
+						if (u < eps || v < eps || t < eps) continue;
+
+						float y = u * a.y + v * b.y + t * c.y;
+						size_t s = size_t(iz) * w + ix;
+						if (y > height[s]) {
+							height[s] = y;
+							owner[s] = (int8_t)l;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	std::vector<uint8_t> surface(size_t(w) * d, SURFACE_NONE);
+	for (int iz = 0; iz < d; iz++) {
+		for (int ix = 0; ix < w; ix++) {
+			size_t s = size_t(iz) * w + ix;
+			if (owner[s] < 0) {
+				height[s] = groundLevel;
+				continue;
+			}
+
+			if (height[s] > groundLevel + ROOF_MIN_HEIGHT) {
+				surface[s] = SURFACE_ROOF;
+				continue;
+			}
+
+			// Ground level: runway if the sample lies in a runway footprint
+			const HeightFieldLayer& layer = layers[owner[s]];
+			glm::vec3 p = glm::vec3(boundsMin.x + ix * cellSize, height[s], boundsMin.y + iz * cellSize) - layer.offset;
+			surface[s] = SURFACE_GRASS;
+			if (layer.runways) {
+				for (const auto& box : *layer.runways) {
+					if (p.x >= box.min.x && p.x <= box.max.x && p.z >= box.min.z && p.z <= box.max.z) {
+						surface[s] = SURFACE_RUNWAY;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	Header h = {};
+	std::memcpy(h.magic, "HGTF", 4);
+	h.version = VERSION;
+	h.width = (uint32_t)w;
+	h.depth = (uint32_t)d;
+	h.originX = boundsMin.x;
+	h.originZ = boundsMin.y;
+	h.cellSize = cellSize;
+	h.groundLevel = groundLevel;
+	h.sourceHash = sourceHash;
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cerr << "Cannot write height field " << path << "\n";
+		return false;
+	}
+	out.write((const char*)&h, sizeof(h));
+	out.write((const char*)height.data(), height.size() * sizeof(float));
+	out.write((const char*)surface.data(), surface.size());
+	return bool(out);
+}
+
+bool HeightField::load(const std::string& path, uint64_t sourceHash) {
+	header = nullptr;
+	heights = nullptr;
+	surfaces = nullptr;
+	if (!file.open(path)) return false;
+
+	const Header* h = (const Header*)file.data();
+	if (file.size() < sizeof(Header) || std::memcmp(h->magic, "HGTF", 4) != 0 ||
+		h->version != VERSION || h->sourceHash != sourceHash || h->width < 2 || h->depth < 2) {
+		file.close();
+		return false;
+	}
+	size_t samples = size_t(h->width) * h->depth;
+	if (file.size() != sizeof(Header) + samples * (sizeof(float) + 1)) {
+		file.close();
+		return false;
+	}
+
+	header = h;
+	heights = (const float*)(h + 1);
+	surfaces = (const uint8_t*)(heights + samples);
+	invCell = 1.0f / h->cellSize;
+	return true;
+}
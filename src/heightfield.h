@@ -0,0 +1,93 @@
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include "aabb.h"
+#include "mappedfile.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+enum SurfaceType : uint8_t {
+	SURFACE_NONE = 0, // no geometry above the sample, open ground at the default level
+	SURFACE_GRASS,
+	SURFACE_RUNWAY,
+	SURFACE_ROOF,
+};
+
+// One mesh rasterized into the height field
+struct HeightFieldLayer {
+	const std::vector<std::vector<float>>* vertsPerMat; // flat [x,y,z,w, ...] per material
+	glm::vec3 offset;                    // mesh -> world translation
+	const std::vector<AABB>* runways;    // runway footprints (XZ) in mesh coordinates, may be null
+};
+
+// Top surface of the static world sampled on a regular XZ grid: height and
+// surface type per sample. Baked offline into a file and memory-mapped, so a
+// query is two array reads and a bilinear blend.
+class HeightField {
+public:
+	// Rasterizes the non-vertical triangles of the layers (highest one wins) and
+	// writes the result to path. Samples every cellSize metres, coarser if the
+	// area would need too many samples.
+	static bool bake(const std::string& path, const std::vector<HeightFieldLayer>& layers,
+		glm::vec2 boundsMin, glm::vec2 boundsMax, float groundLevel, uint64_t sourceHash, float cellSize = 1.0f);
+
+	// Identifies the source geometry; a cache baked from other data is rejected
+	static uint64_t hashLayers(const std::vector<HeightFieldLayer>& layers);
+
+	// Maps a baked file; false if missing, damaged or baked from another source
+	bool load(const std::string& path, uint64_t sourceHash);
+	bool loaded() const { return header != nullptr; }
+
+	// Bilinear height; outside the grid the border samples are extended
+	float height(float x, float z) const;
+	SurfaceType surface(float x, float z) const; // nearest sample
+
+	int width() const { return header ? (int)header->width : 0; }
+	int depth() const { return header ? (int)header->depth : 0; }
+	size_t fileBytes() const { return file.size(); }
+
+private:
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t width, depth;  // samples along X and Z
+		float originX, originZ; // position of sample (0, 0)
+		float cellSize;
+		float groundLevel;
+		uint64_t sourceHash;
+	};
+	// followed by float heights[width * depth], uint8_t surfaces[width * depth], row-major in Z
+
+	static const uint32_t VERSION = 1;
+
+	MappedFile file;
+	const Header* header = nullptr;
+	const float* heights = nullptr;
+	const uint8_t* surfaces = nullptr;
+	float invCell = 1.0f;
+};
+
+inline float HeightField::height(float x, float z) const {
+	const int w = (int)header->width, d = (int)header->depth;
+	float fx = glm::clamp((x - header->originX) * invCell, 0.0f, float(w - 1));
+	float fz = glm::clamp((z - header->originZ) * invCell, 0.0f, float(d - 1));
+	int ix = glm::min(int(fx), w - 2);
+	int iz = glm::min(int(fz), d - 2);
+	float tx = fx - ix, tz = fz - iz;
+
+	const float* row = heights + size_t(iz) * w + ix;
+	float h0 = row[0] + (row[1] - row[0]) * tx;
+	float h1 = row[w] + (row[w + 1] - row[w]) * tx;
+	return h0 + (h1 - h0) * tz;
+}
+
+inline SurfaceType HeightField::surface(float x, float z) const {
+	const int w = (int)header->width, d = (int)header->depth;
+	int ix = glm::clamp(int((x - header->originX) * invCell + 0.5f), 0, w - 1);
+	int iz = glm::clamp(int((z - header->originZ) * invCell + 0.5f), 0, d - 1);
+	return (SurfaceType)surfaces[size_t(iz) * w + ix];
+}
+
+#endif
@@ -0,0 +1,203 @@
+#include "inputlog.h"
+
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+namespace {
+
+const char MAGIC[4] = { 'I', 'N', 'P', 'L' };
+const uint32_t VERSION = 3; // 2: checkpoints hash the controls, timers and AI state too; 3: player start in the header
+
+// Little-endian fixed-size fields, so logs move between machines
+void putU32(std::ofstream& out, uint32_t v) {
+	unsigned char b[4] = { (unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16), (unsigned char)(v >> 24) };
+	out.write((const char*)b, 4);
+}
+
+void putU64(std::ofstream& out, uint64_t v) {
+	putU32(out, (uint32_t)v);
+	putU32(out, (uint32_t)(v >> 32));
+}
+
+// Floats by their bits, so the start state comes back exactly
+void putF32(std::ofstream& out, float v) {
+	uint32_t bits;
+	memcpy(&bits, &v, sizeof(bits));
+	putU32(out, bits);
+}
+
+struct Reader {
+	const unsigned char* p;
+	const unsigned char* end;
+	bool ok = true;
+
+	uint8_t u8() {
+		if (p >= end) { ok = false; return 0; }
+		return *p++;
+	}
+	uint32_t u32() {
+		uint32_t v = 0;
+		for (int i = 0; i < 4; i++) v |= uint32_t(u8()) << (8 * i);
+		return v;
+	}
+	uint64_t u64() {
+		uint64_t lo = u32();
+		return lo | (uint64_t(u32()) << 32);
+	}
+	float f32() {
+		uint32_t bits = u32();
+		float v;
+		memcpy(&v, &bits, sizeof(v));
+		return v;
+	}
+	uint64_t varint() {
+		uint64_t v = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			uint8_t b = u8();
+			v |= uint64_t(b & 0x7f) << shift;
+			if (!(b & 0x80)) return v;
+		}
+		ok = false;
+		return 0;
+	}
+};
+
+// Zigzag keeps negative GLFW key codes (GLFW_KEY_UNKNOWN) to one byte
+uint64_t zigzag(int32_t v) { return (uint64_t(uint32_t(v)) << 1) ^ uint64_t(int64_t(v >> 31)); }
+int32_t unzigzag(uint64_t v) { return int32_t(uint32_t(v >> 1) ^ (0u - uint32_t(v & 1))); }
+
+}
+
+uint64_t inputLogHash(uint64_t h, const void* data, size_t bytes) {
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i = 0; i < bytes; i++) {
+		h ^= p[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+bool InputRecorder::open(const std::string& path, const InputLogHeader& header) {
+	out.open(path, std::ios::binary | std::ios::trunc);
+	if (!out) return false;
+
+	uint32_t dtBits;
+	memcpy(&dtBits, &header.tickSeconds, sizeof(dtBits));
+	out.write(MAGIC, sizeof(MAGIC));
+	putU32(out, VERSION);
+	putU32(out, dtBits);
+	putU32(out, (uint32_t)header.aiAircraft);
+	varint(header.cityObj.size());
+	out.write(header.cityObj.data(), header.cityObj.size());
+	for (float v : header.startPos) putF32(out, v);
+	for (float v : header.startAttitude) putF32(out, v);
+	putF32(out, header.startSpeed);
+	putF32(out, header.startThrottle);
+	putF32(out, header.startTargetThrottle);
+	out.put(char(header.startOnGround));
+	lastTick = 0;
+	return bool(out);
+}
+
+void InputRecorder::varint(uint64_t v) {
+	while (v >= 0x80) {
+		out.put(char((v & 0x7f) | 0x80));
+		v >>= 7;
+	}
+	out.put(char(v));
+}
+
+void InputRecorder::record(uint64_t tick, InputLogRecordType type) {
+	varint(tick - lastTick);
+	out.put(char(type));
+	lastTick = tick;
+}
+
+void InputRecorder::key(uint64_t tick, int key, int action) {
+	if (!out.is_open()) return;
+	record(tick, INPUT_LOG_KEY);
+	varint(zigzag(key));
+	out.put(char(action));
+}
+
+void InputRecorder::checkpoint(uint64_t tick, uint64_t stateHash) {
+	if (!out.is_open()) return;
+	record(tick, INPUT_LOG_CHECKPOINT);
+	putU64(out, stateHash);
+	out.flush(); // keep what led up to a crash
+}
+
+void InputRecorder::close(uint64_t tick, uint64_t stateHash) {
+	if (!out.is_open()) return;
+	record(tick, INPUT_LOG_END);
+	putU64(out, stateHash);
+	out.close();
+}
+
+bool InputReplay::load(const std::string& path, InputLogHeader& header) {
+	records.clear();
+	cursor = 0;
+	complete = true;
+
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return false;
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	Reader r = { data.data(), data.data() + data.size() };
+	if (data.size() < sizeof(MAGIC) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) return false;
+	r.p += sizeof(MAGIC);
+	if (r.u32() != VERSION) return false;
+
+	uint32_t dtBits = r.u32();
+	memcpy(&header.tickSeconds, &dtBits, sizeof(dtBits));
+	header.aiAircraft = (int32_t)r.u32();
+	uint64_t nameLen = r.varint();
+	if (!r.ok || nameLen > uint64_t(r.end - r.p)) return false;
+	header.cityObj.assign((const char*)r.p, (size_t)nameLen);
+	r.p += nameLen;
+	for (float& v : header.startPos) v = r.f32();
+	for (float& v : header.startAttitude) v = r.f32();
+	header.startSpeed = r.f32();
+	header.startThrottle = r.f32();
+	header.startTargetThrottle = r.f32();
+	header.startOnGround = r.u8() != 0;
+	if (!r.ok) return false;
+
+	uint64_t tick = 0;
+	while (r.ok) {
+		InputLogRecord rec = {};
+		tick += r.varint();
+		rec.tick = tick;
+		rec.type = (InputLogRecordType)r.u8();
+		if (rec.type == INPUT_LOG_KEY) {
+			rec.key = unzigzag(r.varint());
+			rec.action = r.u8();
+		}
+		else if (rec.type == INPUT_LOG_CHECKPOINT || rec.type == INPUT_LOG_END) {
+			rec.stateHash = r.u64();
+		}
+		else {
+			r.ok = false;
+		}
+		if (!r.ok) break;
+
+		records.push_back(rec);
+		if (rec.type == INPUT_LOG_END) return true;
+	}
+
+	// A session that crashed still replays up to its last checkpoint, just without a final hash
+	if (records.empty()) return false;
+	std::cerr << path << ": truncated input log, replaying " << records.back().tick << " ticks\n";
+	records.push_back({ records.back().tick, INPUT_LOG_END, 0, 0, 0 });
+	complete = false;
+	return true;
+}
+
+const InputLogRecord* InputReplay::next(uint64_t tick, InputLogRecordType type) {
+	if (cursor >= records.size()) return nullptr;
+	const InputLogRecord& rec = records[cursor];
+	if (rec.tick != tick || rec.type != type) return nullptr;
+	cursor++;
+	return &rec;
+}
@@ -0,0 +1,78 @@
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Everything besides the keys that decides how a recorded session plays out
+struct InputLogHeader {
+	float tickSeconds = 0.0f;
+	int32_t aiAircraft = 0;
+	std::string cityObj;
+
+	// Player when recording began; a scenario may start it away from initWorld's spot
+	float startPos[3] = { 0.0f, 0.0f, 0.0f };
+	float startAttitude[4] = { 1.0f, 0.0f, 0.0f, 0.0f }; // quaternion w, x, y, z
+	float startSpeed = 0.0f;
+	float startThrottle = 0.0f;
+	float startTargetThrottle = 0.0f;
+	bool startOnGround = true;
+};
+
+enum InputLogRecordType : uint8_t {
+	INPUT_LOG_END = 0,        // last record, hash of the final state
+	INPUT_LOG_KEY = 1,        // applied before the tick is simulated
+	INPUT_LOG_CHECKPOINT = 2, // state hash after `tick` ticks
+};
+
+struct InputLogRecord {
+	uint64_t tick;
+	InputLogRecordType type;
+	int32_t key;
+	int32_t action;
+	uint64_t stateHash;
+};
+
+// FNV-1a over raw bytes, chained from INPUT_LOG_HASH_SEED; used for state checkpoints
+const uint64_t INPUT_LOG_HASH_SEED = 14695981039346656037ull;
+uint64_t inputLogHash(uint64_t h, const void* data, size_t bytes);
+
+// Writes key events and state checkpoints of a session as they happen.
+// File: "INPL", version, header, then records of varint tick delta + type.
+class InputRecorder {
+public:
+	bool open(const std::string& path, const InputLogHeader& header);
+	bool isOpen() const { return out.is_open(); }
+
+	void key(uint64_t tick, int key, int action);
+	void checkpoint(uint64_t tick, uint64_t stateHash);
+	void close(uint64_t tick, uint64_t stateHash); // writes the end record
+
+private:
+	std::ofstream out;
+	uint64_t lastTick = 0;
+
+	void record(uint64_t tick, InputLogRecordType type);
+	void varint(uint64_t v);
+};
+
+// Plays a recording back record by record, in the order it was written
+class InputReplay {
+public:
+	bool load(const std::string& path, InputLogHeader& header);
+
+	// Next record if it is stamped with `tick`, advancing past it
+	const InputLogRecord* next(uint64_t tick, InputLogRecordType type);
+	uint64_t endTick() const { return records.empty() ? 0 : records.back().tick; }
+	uint64_t endHash() const { return records.empty() ? 0 : records.back().stateHash; }
+	bool hasEndHash() const { return complete; } // false for a log cut short by a crash
+
+private:
+	std::vector<InputLogRecord> records;
+	size_t cursor = 0;
+	bool complete = false;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "jobs.h"
+
+#include <algorithm>
+
+JobSystem::JobSystem(int threads) {
+	start(threads);
+}
+
+JobSystem::~JobSystem() {
+	stop();
+}
+
+void JobSystem::resize(int threads) {
+	stop();
+	start(threads);
+}
+
+void JobSystem::start(int threads) {
+	if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+	std::vector<Queue> fresh(threads);
+	queues.swap(fresh);
+	stopping = false;
+	for (int t = 1; t < threads; t++) {
+		workers.emplace_back(&JobSystem::workerLoop, this, t);
+	}
+}
+
+void JobSystem::stop() {
+	{
+		std::lock_guard<std::mutex> lk(wakeLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& w : workers) w.join();
+	workers.clear();
+}
+
+void JobSystem::workerLoop(int self) {
+	uint64_t seen = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lk(wakeLock);
+			wake.wait(lk, [&] { return stopping || epoch != seen; });
+			if (stopping) return;
+			seen = epoch;
+		}
+
+		// The job may already be over; busy keeps the submitter from returning
+		// while this thread still looks at it
+		busy.fetch_add(1);
+		if (Job* job = current.load()) work(*job, self);
+		busy.fetch_sub(1);
+	}
+}
+
+void JobSystem::work(Job& job, int self) {
+	Range r;
+	while (job.remaining.load(std::memory_order_acquire) > 0) {
+		if (popBack(self, r) || steal(self, r)) runRange(job, self, r);
+		else std::this_thread::yield();
+	}
+}
+
+// Splits off upper halves (on grain boundaries) for others to steal, then runs the rest
+void JobSystem::runRange(Job& job, int self, Range r) {
+	while (r.last - r.first > job.grain) {
+		size_t pieces = (r.last - r.first + job.grain - 1) / job.grain;
+		size_t mid = r.first + pieces / 2 * job.grain;
+		{
+			std::lock_guard<std::mutex> lk(queues[self].lock);
+			queues[self].ranges.push_back({ mid, r.last });
+		}
+		r.last = mid;
+	}
+	job.call(job.fn, r.first, r.last);
+	job.remaining.fetch_sub(r.last - r.first, std::memory_order_acq_rel);
+}
+
+bool JobSystem::popBack(int self, Range& out) {
+	Queue& q = queues[self];
+	std::lock_guard<std::mutex> lk(q.lock);
+	if (q.ranges.empty()) return false;
+	out = q.ranges.back();
+	q.ranges.pop_back();
+	return true;
+}
+
+bool JobSystem::steal(int self, Range& out) {
+	const int n = (int)queues.size();
+	for (int k = 1; k < n; k++) {
+		Queue& q = queues[(self + k) % n];
+		std::lock_guard<std::mutex> lk(q.lock);
+		if (q.ranges.empty()) continue;
+		out = q.ranges.front();
+		q.ranges.pop_front();
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::submit(Job& job, size_t count) {
+	{
+		std::lock_guard<std::mutex> lk(queues[0].lock);
+		queues[0].ranges.push_back({ 0, count });
+	}
+	current.store(&job);
+	{
+		std::lock_guard<std::mutex> lk(wakeLock);
+		epoch++;
+	}
+	wake.notify_all();
+
+	work(job, 0);
+
+	// Every index is done; wait until no worker can still read the job
+	current.store(nullptr);
+	while (busy.load() != 0) std::this_thread::yield();
+}
+
+JobSystem& sharedJobs() {
+	static JobSystem jobs;
+	return jobs;
+}
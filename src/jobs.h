@@ -0,0 +1,96 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Work-stealing thread pool for data-parallel loops. Every thread has its own
+// deque of index ranges: the owner splits a range in halves, pushes the upper
+// half at the back and keeps working on the lower one; a thread that runs dry
+// steals the oldest, largest range from the front of another deque. The thread
+// that calls parallelFor takes part and returns when the whole range is done.
+//
+// One thread submits at a time (the simulation thread), and fn must not call
+// parallelFor itself.
+class JobSystem {
+public:
+	explicit JobSystem(int threads = 0); // 0 = one per core; the caller counts as one
+	~JobSystem();
+
+	// Stops the workers and starts threads - 1 new ones; not during parallelFor
+	void resize(int threads);
+	int threadCount() const { return (int)queues.size(); }
+
+	// fn(first, last) over [0, count), in pieces of at most grain indices (and
+	// at least grain, the last one aside). A single piece runs inline.
+	template <typename Fn>
+	void parallelFor(size_t count, size_t grain, Fn&& fn);
+
+private:
+	struct Range {
+		size_t first, last;
+	};
+
+	// Ranges of one thread, back for its owner, front for thieves
+	struct Queue {
+		std::mutex lock;
+		std::deque<Range> ranges;
+	};
+
+	struct Job {
+		void (*call)(void* fn, size_t first, size_t last);
+		void* fn;
+		size_t grain;
+		std::atomic<size_t> remaining; // indices not yet done
+	};
+
+	void start(int threads);
+	void stop();
+	void workerLoop(int self);
+	void work(Job& job, int self);
+	void runRange(Job& job, int self, Range r);
+	bool popBack(int self, Range& out);
+	bool steal(int self, Range& out);
+	void submit(Job& job, size_t count);
+
+	std::vector<Queue> queues; // [0] belongs to the submitting thread
+	std::vector<std::thread> workers;
+
+	std::mutex wakeLock;
+	std::condition_variable wake;
+	uint64_t epoch = 0; // bumped for every job, under wakeLock
+	bool stopping = false;
+
+	std::atomic<Job*> current{ nullptr };
+	std::atomic<int> busy{ 0 }; // workers that may still touch current
+};
+
+// Shared by the simulation and the collision batch; sized by --threads
+JobSystem& sharedJobs();
+
+template <typename Fn>
+void JobSystem::parallelFor(size_t count, size_t grain, Fn&& fn) {
+	if (count == 0) return;
+	if (grain == 0) grain = 1;
+	if (count <= grain || queues.size() <= 1) {
+		fn(size_t(0), count);
+		return;
+	}
+
+	typedef typename std::remove_reference<Fn>::type F;
+	Job job;
+	job.call = [](void* f, size_t first, size_t last) { (*static_cast<F*>(f))(first, last); };
+	job.fn = (void*)&fn;
+	job.grain = grain;
+	job.remaining.store(count);
+	submit(job, count);
+}
+
+#endif
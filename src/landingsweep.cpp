@@ -0,0 +1,209 @@
+#include "landingsweep.h"
+#include "simulation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* OUTCOME_NAMES[LANDING_OUTCOMES] = { "safe", "overrun", "off-runway", "crash", "no-landing" };
+
+// Approach state relative to the threshold the player's runway start faces
+struct Approach {
+	float distance; // before the threshold, along the runway, m
+	float lateral;  // from the centre line, m
+	float height;   // above the ground, m
+	float speed;    // m/s
+	float pitchDeg; // flight path angle, positive descends
+	float yawDeg;   // from the runway heading
+};
+
+struct SampleResult {
+	Approach approach;
+	LandingOutcome outcome;
+	float seconds;          // simulated time to the outcome
+	float touchdownPastThr; // distance past the threshold at touchdown, NAN if none
+	float wallUs;
+};
+
+// Sample i depends only on (seed, i), not on which thread runs it
+uint64_t splitmix64(uint64_t& state) {
+	uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+float uniform(uint64_t& state, float lo, float hi) {
+	return lo + (hi - lo) * float(splitmix64(state) >> 40) * (1.0f / 16777216.0f);
+}
+
+const float DIST_MIN = 30.0f, DIST_MAX = 400.0f;
+const float HEIGHT_MIN = 3.0f, HEIGHT_MAX = 40.0f;
+
+Approach sampleApproach(uint32_t seed, int index, float distMax) {
+	uint64_t state = (uint64_t(seed) << 32) ^ uint64_t(index);
+	Approach a;
+	a.distance = uniform(state, DIST_MIN, distMax);
+	a.lateral = uniform(state, -25.0f, 25.0f);
+	a.height = uniform(state, HEIGHT_MIN, HEIGHT_MAX);
+	a.speed = uniform(state, 8.0f, 20.0f);
+	a.pitchDeg = uniform(state, -5.0f, 15.0f);
+	a.yawDeg = uniform(state, -15.0f, 15.0f);
+	return a;
+}
+
+// Threshold at the +z end of the first runway, approached heading -z like the player's start
+float thresholdZ() {
+	return mainRunway().maxZ;
+}
+
+SampleResult simulateApproach(const Approach& ap, const LandingSweepConfig& cfg) {
+	auto start = std::chrono::steady_clock::now();
+
+	float centreX = mainRunway().centreX;
+	float thrZ = thresholdZ();
+
+	Aircraft a;
+	a.ai = true; // not the player: no console messages
+	a.airplane.pos = glm::vec3(centreX + ap.lateral, 0.0f, thrZ + ap.distance);
+	a.airplane.pos.y = groundHeightAt(a.airplane.pos) + 2.0f + ap.height;
+	a.airplane.speed = ap.speed;
+	// Trimmed for level flight at that speed, pointed down (or up) the sampled path
+	float trimAlpha, trimThrottle;
+	a.type->levelTrim(ap.speed, 9.81f, trimAlpha, trimThrottle);
+	a.pathPitch = glm::radians(ap.pitchDeg);
+	a.airplane.attitude = attitudeFromEuler(glm::radians(180.0f + ap.yawDeg), a.pathPitch - trimAlpha, 0.0f);
+	a.throttle = a.targetThrottle = trimThrottle;
+	a.onGround = false;
+
+	SampleResult r = { ap, LANDING_NONE, cfg.maxSeconds, NAN, 0.0f };
+	bool rollingOnRunway = false;
+	const int maxTicks = int(cfg.maxSeconds / SIM_DT);
+	for (int tick = 1; tick <= maxTicks; tick++) {
+		bool wasOnGround = a.onGround;
+		stepIsolated(a, SIM_DT);
+		r.seconds = tick * SIM_DT;
+
+		if (a.explosionActive) {
+			r.outcome = rollingOnRunway ? LANDING_OVERRUN : (a.onGround ? LANDING_OFF_RUNWAY : LANDING_CRASH);
+			break;
+		}
+		if (a.onGround && !wasOnGround) {
+			r.touchdownPastThr = thrZ - a.airplane.pos.z;
+			rollingOnRunway = isOnRunway(a.airplane.pos);
+			if (!rollingOnRunway) {
+				r.outcome = LANDING_OFF_RUNWAY;
+				break;
+			}
+		}
+		if (a.onGround && a.airplane.speed <= 0.0f) {
+			r.outcome = isOnRunway(a.airplane.pos) ? LANDING_SAFE : LANDING_OVERRUN;
+			break;
+		}
+	}
+
+	r.wallUs = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+	return r;
+}
+
+}
+
+int runLandingSweep(const LandingSweepConfig& cfg) {
+	if (airportRunwayAABBs.empty()) {
+		fprintf(stderr, "Landing sweep: no runway\n");
+		return 1;
+	}
+
+	// Approaches start inside the map, leaving outside it is an explosion
+	float distMax = glm::clamp(MAX_Z - thresholdZ(), DIST_MIN + 1.0f, DIST_MAX);
+	const int n = std::max(1, cfg.samples);
+	int threads = cfg.threads > 0 ? cfg.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, n);
+	std::vector<SampleResult> results(n);
+
+	// Small chunks from a shared counter: sample cost varies from one tick to maxSeconds
+	const int CHUNK = 16;
+	std::atomic<int> nextSample(0);
+	auto worker = [&]() {
+		for (;;) {
+			int first = nextSample.fetch_add(CHUNK);
+			if (first >= n) return;
+			for (int i = first; i < std::min(n, first + CHUNK); i++) {
+				results[i] = simulateApproach(sampleApproach(cfg.seed, i, distMax), cfg);
+			}
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> pool;
+	for (int t = 1; t < threads; t++) pool.emplace_back(worker);
+	worker();
+	for (auto& t : pool) t.join();
+	double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	wallSec = std::max(wallSec, 1e-9);
+
+	if (FILE* csv = fopen(cfg.csvPath.c_str(), "w")) {
+		fprintf(csv, "sample,distance_m,lateral_m,height_m,speed_ms,pitch_deg,yaw_deg,outcome,seconds,touchdown_past_threshold_m,wall_us\n");
+		for (int i = 0; i < n; i++) {
+			const SampleResult& r = results[i];
+			const Approach& ap = r.approach;
+			fprintf(csv, "%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%s,%.3f,", i, ap.distance, ap.lateral, ap.height,
+				ap.speed, ap.pitchDeg, ap.yawDeg, OUTCOME_NAMES[r.outcome], r.seconds);
+			if (std::isnan(r.touchdownPastThr)) fprintf(csv, ",%.1f\n", r.wallUs);
+			else fprintf(csv, "%.2f,%.1f\n", r.touchdownPastThr, r.wallUs);
+		}
+		fclose(csv);
+	}
+	else {
+		fprintf(stderr, "Cannot write %s\n", cfg.csvPath.c_str());
+	}
+
+	int counts[LANDING_OUTCOMES] = {};
+	double simSec = 0.0;
+	std::vector<float> wall(n);
+	for (int i = 0; i < n; i++) {
+		counts[results[i].outcome]++;
+		simSec += results[i].seconds;
+		wall[i] = results[i].wallUs;
+	}
+
+	printf("%d approaches, %d threads, %.2f s wall: %.0f samples/s, %.0fx real time\n",
+		n, threads, wallSec, n / wallSec, simSec / wallSec);
+	for (int o = 0; o < LANDING_OUTCOMES; o++) {
+		printf("  %-11s %6d  %5.1f %%\n", OUTCOME_NAMES[o], counts[o], 100.0 * counts[o] / n);
+	}
+
+	std::sort(wall.begin(), wall.end());
+	printf("Per sample: median %.0f us, p90 %.0f us, p99 %.0f us, max %.0f us\n",
+		wall[n / 2], wall[n * 9 / 10], wall[n * 99 / 100], wall[n - 1]);
+
+	// Share of safe landings per distance x height cell, high approaches on top
+	const int COLS = 8, ROWS = 6;
+	int safe[ROWS][COLS] = {}, total[ROWS][COLS] = {};
+	for (const SampleResult& r : results) {
+		int c = std::min(COLS - 1, int((r.approach.distance - DIST_MIN) / (distMax - DIST_MIN) * COLS));
+		int row = std::min(ROWS - 1, int((r.approach.height - HEIGHT_MIN) / (HEIGHT_MAX - HEIGHT_MIN) * ROWS));
+		total[row][c]++;
+		safe[row][c] += r.outcome == LANDING_SAFE;
+	}
+	printf("Safe landings, %% (rows: height above ground, columns: distance before threshold)\n");
+	printf("%9s", "");
+	for (int c = 0; c < COLS; c++) printf(" %5.0fm", DIST_MIN + (c + 0.5f) * (distMax - DIST_MIN) / COLS);
+	printf("\n");
+	for (int row = ROWS - 1; row >= 0; row--) {
+		printf("%7.1fm ", HEIGHT_MIN + (row + 0.5f) * (HEIGHT_MAX - HEIGHT_MIN) / ROWS);
+		for (int c = 0; c < COLS; c++) {
+			if (total[row][c]) printf(" %5.0f%%", 100.0f * safe[row][c] / total[row][c]);
+			else printf(" %6s", "-");
+		}
+		printf("\n");
+	}
+	printf("Samples written to %s\n", cfg.csvPath.c_str());
+	return 0;
+}
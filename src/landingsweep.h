@@ -0,0 +1,31 @@
+#ifndef LANDINGSWEEP_H
+#define LANDINGSWEEP_H
+
+#include <cstdint>
+#include <string>
+
+struct LandingSweepConfig {
+	int samples = 4000;
+	int threads = 0;          // 0: one per hardware thread
+	uint32_t seed = 1;
+	float maxSeconds = 60.0f; // simulated time before a sample counts as no landing
+	std::string csvPath = "landing_sweep.csv";
+};
+
+enum LandingOutcome {
+	LANDING_SAFE,       // touched down on the runway and stopped on it
+	LANDING_OVERRUN,    // touched down on the runway, rolled off it
+	LANDING_OFF_RUNWAY, // touched down beside or short of the runway
+	LANDING_CRASH,      // hit something in the air
+	LANDING_NONE,       // still flying after maxSeconds
+	LANDING_OUTCOMES
+};
+
+// Monte Carlo sweep of approach states around the runway threshold: each sample
+// is one aircraft flown without input through updateLandingAssist and the
+// touchdown logic, on its own thread. Writes one CSV row per sample and prints
+// outcome counts, a safe-landing map over distance x height and timing.
+// Needs initWorld() first.
+int runLandingSweep(const LandingSweepConfig& cfg);
+
+#endif
@@ -1,7 +1,3 @@
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_SWIZZLE
-#define TINYOBJLOADER_IMPLEMENTATION
-
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -13,87 +9,92 @@
 #include "constants.h"
 #include "lodepng.h"
 #include "shaderprogram.h"
-
+#include "simsync.h"
+#include "simulation.h"
+#include "dynres.h"
+#include "gpws.h"
+#include "citygen.h"
+#include "benchmarks.h"
+#include "jobs.h"
+#include "assetmemory.h"
+#include "flythrough.h"
+#include "gpumodel.h"
+
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <chrono>
 #include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
 
 ShaderProgram* sp = nullptr;
 
-struct AABB {
-	glm::vec3 min;
-	glm::vec3 max;
-};
-std::vector<AABB> cityBuildings;
-
-struct AirplaneState {
-	glm::vec3 pos;
-	float yaw, pitch;
-	float speed;
-};
-
-bool throttleUpPressed = false;
-bool throttleDownPressed = false;
-
-AirplaneState airplane = { glm::vec3(0, 40, 0), 0.0f, 0.0f, 10.0f };
-float yawRate = 0.0f;
-float pitchRate = 0.0f;
-float targetYawRate = 0.0f;
-float currentYawRate = 0.0f;
-const float yawAccel = glm::radians(180.0f);
-
-float currentRollAngle = 0.0f;
-const float rollAccel = glm::radians(60.0f);
-
-bool explosionActive = false;
-float explosionTimer = 0.0f;
-glm::vec3 explosionPos;
-const float explosionDuration = 1.5f;
-
 GLuint explosionTexture = 0;
 const int explosionFramesX = 5;
 const int explosionFramesY = 5;
 const int explosionTotalFrames = explosionFramesX * explosionFramesY;
 
-float verticalSpeed = 0.0f;
-const float GRAVITY = 9.81f;
-bool isStalling = false;
+// Ground-proximity warnings, ray queries on their own worker
+Gpws gpws;
+int gpwsRaysPerTick = 6; // spread over ticks: a full sweep takes RAYS_PER_SWEEP / this ticks
 
+float aspectRatio = 1;
 
-const float MIN_TAKEOFF_SPEED = 10.0f;
-const float STALL_SPEED = 8.0f;
-const float MAX_SPEED = 20.0f;
+DynResConfig dynResConfig;
+DynamicResolution* dynRes = nullptr;
 
-float throttle = 0.0f;
-float targetThrottle = 0.0f;
+bool showMemoryOverlay = false; // F3
+bool dropCpuCopies = false;     // --drop-cpu-copies: models live only in GPU buffers after upload
 
-bool onGround = true;
+bool benchRender = false;       // --bench-render: fly the scripted path and time every frame
+bool benchRenderHidden = false; // --hidden: in an invisible window
 
-bool isLandingAssistActive = false;
-float landingAssistTimer = 0.0f;
-const float LANDING_ASSIST_DURATION = 2.0f;
-const float SAFE_LANDING_SPEED = 10.0f;
-const float LANDING_PITCH_THRESHOLD = glm::radians(25.0f);
+// Submitted by the draw functions since the last reset, for --bench-render
+struct RenderCounters {
+	long long drawCalls = 0;
+	long long triangles = 0;
+};
+RenderCounters renderCounters;
 
-AABB airportAABB;
-glm::vec3 airportCenter;
-std::vector<AABB> airportRunwayAABBs;
-std::vector<AABB> airportObstacles;
-glm::vec3 airportDrawOffset(-186.0f, 0.1f, 67.0f);
-float airportGroundLevel = airportAABB.min.y + airportDrawOffset.y;
-const float AIRPORT_SAFE_RADIUS = 30.0f;
-const float STALL_NOSEDOWN = glm::radians(55.0f);
-const float STALL_BLEND_SPEED = 2.5f;
+GpuModel gpuJet, gpuCity, gpuAirport;
 
-float MIN_X = -10.0f, MAX_X = 10.0f;
-float MIN_Z = -10.0f, MAX_Z = 10.0f;
-float MIN_Y = 1.0f, MAX_Y = 200.0f;
+// ----- Simulation thread -----
+// Physics and collision run on their own thread at a fixed rate. Keys reach it
+// through a lock-free queue, the renderer sees immutable snapshots of the state.
+const float SIM_MAX_LAG = 0.25f; // after a longer stall the sim skips ahead instead of catching up
 
-float aspectRatio = 1;
+// Other aircraft near the player, as much as the renderer needs
+struct TrafficSnapshot {
+	AirplaneState airplane;
+};
+
+struct SimSnapshot {
+	std::vector<TrafficSnapshot> traffic; // nearest first is not guaranteed
+	AirplaneState airplane;
+	float throttle;
+	bool onGround;
+	bool isStalling;
+	bool explosionActive;
+	float explosionTimer;
+	glm::vec3 explosionPos;
+};
+
+SpscQueue<InputEvent, 256> inputQueue;
+TripleBuffer<SimSnapshot> simSnapshots;
+std::atomic<bool> simRunning(false);
+std::thread simThread;
 
 void freeOpenGLProgram(GLFWwindow* w) {
+	for (GpuModel* model : { &gpuJet, &gpuCity, &gpuAirport }) {
+		glDeleteBuffers((GLsizei)model->verts.size(), model->verts.data());
+		glDeleteBuffers((GLsizei)model->norms.size(), model->norms.data());
+		glDeleteBuffers((GLsizei)model->uvs.size(), model->uvs.data());
+	}
+	delete dynRes;
 	delete sp;
 }
 
@@ -101,72 +102,28 @@ void error_callback(int e, const char* d) {
 	std::cerr << "GLFW Error: " << d << "\n";
 }
 
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-	constexpr float ANG_V = glm::radians(20.0f); // angular speed in radians/sec
-	constexpr float ANG_H = glm::radians(60.0f); // angular speed in radians/sec
-
-	if (action == GLFW_PRESS) {
-		if (airplane.speed > 0.1) {
-			if (key == GLFW_KEY_LEFT)   targetYawRate = ANG_H;  // bank left
-			if (key == GLFW_KEY_RIGHT)  targetYawRate = -ANG_H;  // bank right
-		}
-
-		if (airplane.speed >= MIN_TAKEOFF_SPEED) {
-			if (!onGround) {
-				if (key == GLFW_KEY_UP)     pitchRate = ANG_V;
-			}
-			if (key == GLFW_KEY_DOWN)   pitchRate = -ANG_V;
-		}
-	}
-	else if (action == GLFW_RELEASE) {
-		if (key == GLFW_KEY_LEFT || key == GLFW_KEY_RIGHT) targetYawRate = 0.0f;
-		if (key == GLFW_KEY_DOWN || key == GLFW_KEY_UP)    pitchRate = 0.0f;
-	}
+static_assert(SIM_KEY_LEFT == GLFW_KEY_LEFT && SIM_KEY_RIGHT == GLFW_KEY_RIGHT &&
+	SIM_KEY_UP == GLFW_KEY_UP && SIM_KEY_DOWN == GLFW_KEY_DOWN &&
+	SIM_KEY_W == GLFW_KEY_W && SIM_KEY_S == GLFW_KEY_S, "SimKey must match GLFW key codes");
+static_assert(SIM_PRESS == GLFW_PRESS && SIM_RELEASE == GLFW_RELEASE, "SimKeyAction must match GLFW actions");
 
-	if (key == GLFW_KEY_W) {
-		if (action == GLFW_PRESS)
-			throttleUpPressed = true;
-		else if (action == GLFW_RELEASE)
-			throttleUpPressed = false;
-	}
-	if (key == GLFW_KEY_S) {
-		if (action == GLFW_PRESS)
-			throttleDownPressed = true;
-		else if (action == GLFW_RELEASE)
-			throttleDownPressed = false;
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	if (action == GLFW_REPEAT) return; // repeats never change the controls
+	if (key == GLFW_KEY_F3) {
+		if (action == GLFW_PRESS) showMemoryOverlay = !showMemoryOverlay;
+		return;
 	}
-}
-
-bool isOverAirport(const glm::vec3& posWorld) {
-	glm::vec2 p2d(posWorld.x, posWorld.z);
-	glm::vec2 a2d = glm::vec2(
-		airportCenter.x + airportDrawOffset.x,
-		airportCenter.z + airportDrawOffset.z
-	);
-	bool over = glm::distance(p2d, a2d) < AIRPORT_SAFE_RADIUS;
-
-	return over;
-}
-
-bool isOnRunway(const glm::vec3& posWorld) {
-	glm::vec3 posLocal = posWorld - (airportCenter + airportDrawOffset);
-
-	for (const auto& box : airportRunwayAABBs) {
-		if (posLocal.x > box.min.x && posLocal.x < box.max.x &&
-			posLocal.y >(box.min.y - 2.0f) && posLocal.y < (box.max.y + 3.0f) &&
-			posLocal.z > box.min.z && posLocal.z < box.max.z) {
-
-			return true;
-		}
+	if (!inputQueue.push({ key, action })) {
+		std::cerr << "Input queue full, key event dropped\n";
 	}
-	return false;
 }
 
-
-void windowResizeCallback(GLFWwindow* w, int width, int height) {
+// Sizes in pixels, which differ from window coordinates on HiDPI displays
+void framebufferResizeCallback(GLFWwindow* w, int width, int height) {
 	if (height == 0) return;
 	aspectRatio = float(width) / float(height);
 	glViewport(0, 0, width, height);
+	if (dynRes) dynRes->resize(width, height);
 }
 
 GLuint readTexture(const std::string& fname) {
@@ -178,6 +135,7 @@ GLuint readTexture(const std::string& fname) {
 	glGenTextures(1, &tex);
 	glBindTexture(GL_TEXTURE_2D, tex);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, img.data());
+	assetMemoryAdd(fname, 0, 0, textureBytes(w, h, 4, false), 1); // the decoded pixels die with img
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
@@ -186,7 +144,7 @@ GLuint readTexture(const std::string& fname) {
 	return tex;
 }
 
-GLuint makeColorTexture(float r, float g, float b, float a = 1.0f) {
+GLuint makeColorTexture(float r, float g, float b, float a) {
 	GLuint tex;
 	unsigned char pixel[4] = {
 		(unsigned char)(r * 255.0f),
@@ -201,210 +159,63 @@ GLuint makeColorTexture(float r, float g, float b, float a = 1.0f) {
 		1, 1, 0,
 		GL_RGBA, GL_UNSIGNED_BYTE, pixel
 	);
+	assetMemoryAdd("material colours", 0, 0, textureBytes(1, 1, 4, false), 1);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	return tex;
 }
 
 
+GLuint uploadBuffer(const std::vector<float>& data) {
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
+	return buffer;
+}
+
+void uploadModel(const std::string& asset, std::vector<std::vector<float>>& verts,
+	std::vector<std::vector<float>>& norms, std::vector<std::vector<float>>& uvs, GpuModel& gpu) {
+	int64_t bytes = 0;
+	int buffers = 0;
+	gpu.verts.assign(verts.size(), 0);
+	gpu.norms.assign(verts.size(), 0);
+	gpu.uvs.assign(verts.size(), 0);
+	for (size_t m = 0; m < verts.size(); m++) {
+		if (verts[m].empty()) continue;
+		gpu.verts[m] = uploadBuffer(verts[m]);
+		gpu.norms[m] = uploadBuffer(norms[m]);
+		gpu.uvs[m] = uploadBuffer(uvs[m]);
+		bytes += int64_t((verts[m].size() + norms[m].size() + uvs[m].size()) * sizeof(float));
+		buffers += 3;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	assetMemoryAdd(asset, 0, bytes, 0, buffers);
+
+	if (dropCpuCopies) {
+		int64_t cpu = perMaterialBytes(verts) + perMaterialBytes(norms) + perMaterialBytes(uvs);
+		std::vector<std::vector<float>>().swap(verts);
+		std::vector<std::vector<float>>().swap(norms);
+		std::vector<std::vector<float>>().swap(uvs);
+		assetMemoryAdd(asset, -cpu, 0, 0);
+	}
+}
 
 // Globalne zmienne:
-std::vector<std::vector<float>> vertsPerMatJet, normsPerMatJet, uvsPerMatJet;
-std::vector<int> countsPerMatJet;
-std::vector<tinyobj::material_t> materialsJet;
 std::vector<GLuint> matTexIDsJet;
-
-std::vector<std::vector<float>> vertsPerMatCity, normsPerMatCity, uvsPerMatCity;
-std::vector<int> countsPerMatCity;
-std::vector<tinyobj::material_t> materialsCity;
 std::vector<GLuint> matTexIDsCity;
-
-std::vector<std::vector<float>> vertsPerMatAirport, normsPerMatAirport, uvsPerMatAirport;
-std::vector<int> countsPerMatAirport;
-std::vector<tinyobj::material_t> materialsAirport;
 std::vector<GLuint> matTexIDsAirport;
 
-
-
-bool loadModel(
-	const std::string& objFile,
-	std::vector<std::vector<float>>& vertsPerMat,
-	std::vector<std::vector<float>>& normsPerMat,
-	std::vector<std::vector<float>>& uvsPerMat,
-	std::vector<int>& countsPerMat,
-	std::vector<tinyobj::material_t>& materials,
-	AABB* outAABB = nullptr
-) {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::string warn, err;
-
-	bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, objFile.c_str(), ".");
-	if (!warn.empty()) std::cerr << "WARN: " << warn << "\n";
-	if (!err.empty()) std::cerr << "ERR : " << err << "\n";
-	if (!ret) return false;
-
-	std::cout << "Loaded " << shapes.size() << " shapes from " << objFile << std::endl;
-
-	int M = (int)materials.size();
-	vertsPerMat.assign(M, {});
-	normsPerMat.assign(M, {});
-	uvsPerMat.assign(M, {});
-	countsPerMat.assign(M, 0);
-
-	for (auto& shape : shapes) {
-		size_t index_offset = 0;
-		for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
-			int fv = shape.mesh.num_face_vertices[f];
-			int matID = shape.mesh.material_ids[f];
-			if (matID < 0 || matID >= M) matID = 0;
-
-			for (int v = 0; v < fv; v++) {
-				auto idx = shape.mesh.indices[index_offset + v];
-
-				vertsPerMat[matID].push_back(attrib.vertices[3 * idx.vertex_index + 0]);
-				vertsPerMat[matID].push_back(attrib.vertices[3 * idx.vertex_index + 1]);
-				vertsPerMat[matID].push_back(attrib.vertices[3 * idx.vertex_index + 2]);
-				vertsPerMat[matID].push_back(1.0f);
-
-				if (idx.normal_index >= 0) {
-					normsPerMat[matID].push_back(attrib.normals[3 * idx.normal_index + 0]);
-					normsPerMat[matID].push_back(attrib.normals[3 * idx.normal_index + 1]);
-					normsPerMat[matID].push_back(attrib.normals[3 * idx.normal_index + 2]);
-					normsPerMat[matID].push_back(0.0f);
-				}
-				else {
-					normsPerMat[matID].insert(normsPerMat[matID].end(), { 0,1,0,0 });
-				}
-
-				if (idx.texcoord_index >= 0) {
-					uvsPerMat[matID].push_back(attrib.texcoords[2 * idx.texcoord_index + 0]);
-					uvsPerMat[matID].push_back(attrib.texcoords[2 * idx.texcoord_index + 1]);
-				}
-				else {
-					uvsPerMat[matID].insert(uvsPerMat[matID].end(), { 0,0 });
-				}
-				countsPerMat[matID] += 1;
-			}
-			index_offset += fv;
-		}
-	}
-
-	glm::vec3 min(FLT_MAX), max(-FLT_MAX);
-	for (auto& shape : shapes) {
-		size_t index_offset = 0;
-		int matID = -1;
-		if (!shape.mesh.material_ids.empty())
-			matID = shape.mesh.material_ids[0];
-		std::string matName = (matID >= 0 && matID < materials.size()) ? materials[matID].name : "";
-
-		glm::vec3 shapeMin(FLT_MAX), shapeMax(-FLT_MAX);
-		for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
-			int fv = shape.mesh.num_face_vertices[f];
-			for (int v = 0; v < fv; v++) {
-				auto idx = shape.mesh.indices[index_offset + v];
-				glm::vec3 vtx(
-					attrib.vertices[3 * idx.vertex_index + 0],
-					attrib.vertices[3 * idx.vertex_index + 1],
-					attrib.vertices[3 * idx.vertex_index + 2]
-				);
-				shapeMin = glm::min(shapeMin, vtx);
-				shapeMax = glm::max(shapeMax, vtx);
-				min = glm::min(min, vtx);
-				max = glm::max(max, vtx);
-			}
-			index_offset += fv;
-		}
-
-		bool isRunway = false;
-		if (matName.find("Asphalt") != std::string::npos ||
-			matName.find("runway") != std::string::npos ||
-			matName.find("White") != std::string::npos ||
-			matName.find("Blue") != std::string::npos) {
-			isRunway = true;
-		}
-
-		if (isRunway)
-			airportRunwayAABBs.push_back({ shapeMin, shapeMax });
-		else
-			airportObstacles.push_back({ shapeMin, shapeMax });
-	}
-
-	if (outAABB) *outAABB = { min, max };
-	return true;
-}
-
-
 bool initOpenGLProgram(GLFWwindow* window) {
 	glClearColor(0.15f, 0.15f, 0.25f, 1);
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	glfwSetWindowSizeCallback(window, windowResizeCallback);
+	glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
 	glfwSetKeyCallback(window, keyCallback);
 
-	if (!loadModel("jetanima.obj", vertsPerMatJet, normsPerMatJet, uvsPerMatJet, countsPerMatJet, materialsJet)) {
-		std::cerr << "Failed to load jetanima.obj\n";
-		return false;
-	}
-	if (!loadModel("City.obj", vertsPerMatCity, normsPerMatCity, uvsPerMatCity, countsPerMatCity, materialsCity)) {
-		std::cerr << "Failed to load City.obj\n";
-		return false;
-	}
-
-	tinyobj::attrib_t attribCity;
-	std::vector<tinyobj::shape_t> shapesCity;
-	std::vector<tinyobj::material_t> matsCity;
-	std::string warnCity, errCity;
-	bool ok = tinyobj::LoadObj(&attribCity, &shapesCity, &matsCity, &warnCity, &errCity, "City.obj", ".");
-	if (!ok) {
-		std::cerr << "WARN: cannot reload City.obj for AABB generation\n";
-	}
-	else {
-		for (auto& shape : shapesCity) {
-			glm::vec3 shapeMin(FLT_MAX), shapeMax(-FLT_MAX);
-			size_t index_offset = 0;
-			for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
-				int fv = shape.mesh.num_face_vertices[f];
-				for (int v = 0; v < fv; v++) {
-					auto idx = shape.mesh.indices[index_offset + v];
-					glm::vec3 vtx(
-						attribCity.vertices[3 * idx.vertex_index + 0],
-						attribCity.vertices[3 * idx.vertex_index + 1],
-						attribCity.vertices[3 * idx.vertex_index + 2]
-					);
-					shapeMin = glm::min(shapeMin, vtx);
-					shapeMax = glm::max(shapeMax, vtx);
-				}
-				index_offset += fv;
-			}
-			cityBuildings.push_back({ shapeMin, shapeMax });
-		}
-	}
-
-
-	if (!loadModel("Airport.obj", vertsPerMatAirport, normsPerMatAirport, uvsPerMatAirport, countsPerMatAirport, materialsAirport, &airportAABB)) {
-		std::cerr << "Failed to load Airport.obj\n";
-		return false;
-	}
-
-	airportCenter = (airportAABB.min + airportAABB.max) * 0.5f;
-	airportGroundLevel = airportAABB.min.y;
-
-	airportRunwayAABBs.clear();
-	airportRunwayAABBs.push_back({
-		glm::vec3(-34.04f, -0.0062f, -188.0),
-		glm::vec3(3.0f, 0.00029f, 188.0f)
-		});
-
-	airplane.pos = airportCenter + airportDrawOffset + glm::vec3(-31.23f, 3.0f, 185);
-	airplane.yaw = glm::radians(180.0f);
-	airplane.pitch = 0.0f;
-	airplane.speed = 0.0f;
-	onGround = true;
-	throttle = 0.0f;
-	targetThrottle = 0.0f;
+	if (!initWorld()) return false;
 
 	matTexIDsJet.resize(materialsJet.size(), 0);
 	for (size_t i = 0; i < materialsJet.size(); i++) {
@@ -464,139 +275,20 @@ bool initOpenGLProgram(GLFWwindow* window) {
 		}
 	}
 
-	glm::vec2 cityMin(FLT_MAX, FLT_MAX);
-	glm::vec2 cityMax(-FLT_MAX, -FLT_MAX);
-
-	for (const auto& matVerts : vertsPerMatCity) {
-		// matVerts is a flat [x,y,z,1, x,y,z,1, …]
-		for (size_t i = 0; i + 3 < matVerts.size(); i += 4) {
-			float x = matVerts[i];
-			float z = matVerts[i + 2];
-			cityMin.x = glm::min(cityMin.x, x);
-			cityMax.x = glm::max(cityMax.x, x);
-			cityMin.y = glm::min(cityMin.y, z);
-			cityMax.y = glm::max(cityMax.y, z);
-		}
-	}
-
-	// store these in globals
-	MIN_X = cityMin.x;
-	MAX_X = cityMax.x;
-	MIN_Z = cityMin.y;
-	MAX_Z = cityMax.y;
-
 	explosionTexture = readTexture("explosion.png");
 
-	sp = new ShaderProgram("v_simplest.glsl", nullptr, "f_simplest.glsl");
-	return true;
-}
-
-bool checkCollision(const glm::vec3& posWorld) {
-	// Convert world coordinates back to airport‐local coordinates:
-	glm::vec3 posLocal = posWorld - airportDrawOffset;
-
-	// 1) If the plane is on the ground AND is exactly on a runway, skip collisions.
-	if (onGround) {
-		if (isOnRunway(posWorld)) {
-			return false; // На полосе — ок
-		}
-		else {
-			return true; // Не на полосе — взорвался!
-		}
-	}
-
-	// 2) If in the “safe radius” of the airport, do a more lenient check against obstacles
-	if (isOverAirport(posWorld)) {
-		float buffer = (airplane.speed < MIN_TAKEOFF_SPEED + 5.0f) ? 8.0f : 2.0f;
-		for (const auto& box : airportObstacles) {
-			// box.min/.max are in local coords
-			bool inExtended =
-				posLocal.x > (box.min.x - buffer) && posLocal.x < (box.max.x + buffer) &&
-				posLocal.y >(box.min.y - buffer) && posLocal.y < (box.max.y + buffer) &&
-				posLocal.z >(box.min.z - buffer) && posLocal.z < (box.max.z + buffer);
-
-			bool inCore =
-				posLocal.x > (box.min.x + 1.0f) && posLocal.x < (box.max.x - 1.0f) &&
-				posLocal.y >(box.min.y + 1.0f) && posLocal.y < (box.max.y - 1.0f) &&
-				posLocal.z >(box.min.z + 1.0f) && posLocal.z < (box.max.z - 1.0f);
-
-			if (inExtended && inCore) {
-				return true;
-			}
-		}
-		return false;
-	}
-
-	// 3) Check against city buildings (these AABBs are already in world coords from City.obj)
-	for (const auto& box : cityBuildings) {
-		bool coll =
-			posWorld.x > box.min.x && posWorld.x < box.max.x &&
-			posWorld.y > box.min.y && posWorld.y < box.max.y &&
-			posWorld.z > box.min.z && posWorld.z < box.max.z;
-
-		if (coll) {
-			return true;
-		}
-	}
-
-	return false;
-}
-
-
-bool isInLandingApproach(const glm::vec3& posWorld) {
-	for (const auto& box : airportRunwayAABBs) {
-		float approachDistance = 50.0f;
-		// Build an extended AABB around the runway to detect approach
-		AABB extendedRunway = {
-			glm::vec3(box.min.x - approachDistance, box.min.y - 10.0f, box.min.z - approachDistance),
-			glm::vec3(box.max.x + approachDistance, box.max.y + 20.0f, box.max.z + approachDistance)
-		};
-
-		if (posWorld.x > extendedRunway.min.x && posWorld.x < extendedRunway.max.x &&
-			posWorld.y > extendedRunway.min.y && posWorld.y < extendedRunway.max.y &&
-			posWorld.z > extendedRunway.min.z && posWorld.z < extendedRunway.max.z) {
-			return true;
-		}
-	}
-	return false;
-}
-
-void updateLandingAssist(float dt) {
-	if (!onGround && isInLandingApproach(airplane.pos)) {
-		if (!isLandingAssistActive) {
-			isLandingAssistActive = true;
-			landingAssistTimer = 0.0f;
-		}
-
-		landingAssistTimer += dt;
-		float assistStrength = glm::min(1.0f, landingAssistTimer / LANDING_ASSIST_DURATION);
+	uploadModel("jetanima.obj", vertsPerMatJet, normsPerMatJet, uvsPerMatJet, gpuJet);
+	uploadModel(cityObjPath, vertsPerMatCity, normsPerMatCity, uvsPerMatCity, gpuCity);
+	uploadModel("Airport.obj", vertsPerMatAirport, normsPerMatAirport, uvsPerMatAirport, gpuAirport);
 
-		// Limit extreme pitch angles
-		if (fabs(airplane.pitch) > LANDING_PITCH_THRESHOLD) {
-			float targetPitch = glm::clamp(airplane.pitch, -LANDING_PITCH_THRESHOLD, LANDING_PITCH_THRESHOLD);
-			airplane.pitch = glm::mix(airplane.pitch, targetPitch, assistStrength * 0.5f * dt);
-		}
-
-		// Limit extreme roll angles
-		if (fabs(currentRollAngle) > glm::radians(15.0f)) {
-			float maxLandingRoll = glm::radians(15.0f);
-			float targetRoll = glm::clamp(currentRollAngle, -maxLandingRoll, maxLandingRoll);
-			currentRollAngle = glm::mix(currentRollAngle, targetRoll, assistStrength * dt);
-		}
+	sp = new ShaderProgram("v_simplest.glsl", nullptr, "f_simplest.glsl");
 
-		// If too fast on approach, gently slow down
-		if (airplane.speed > SAFE_LANDING_SPEED) {
-			float speedReduction = assistStrength * 3.0f * dt;
-			airplane.speed = glm::max(SAFE_LANDING_SPEED, airplane.speed - speedReduction);
-		}
-	}
-	else {
-		isLandingAssistActive = false;
-		landingAssistTimer = 0.0f;
-	}
+	int fbW, fbH;
+	glfwGetFramebufferSize(window, &fbW, &fbH);
+	dynRes = new DynamicResolution(dynResConfig, fbW, fbH);
+	return true;
 }
 
-
 void drawExplosionSprite(float t, const glm::mat4& M) {
 	int frame = int(t * explosionTotalFrames);
 	if (frame >= explosionTotalFrames) frame = explosionTotalFrames - 1;
@@ -643,6 +335,8 @@ void drawExplosionSprite(float t, const glm::mat4& M) {
 	glVertexAttribPointer(sp->a("texCoord0"), 2, GL_FLOAT, GL_FALSE, 0, quadUV);
 
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	renderCounters.drawCalls++;
+	renderCounters.triangles += 2;
 
 	glDisableVertexAttribArray(sp->a("vertex"));
 	glDisableVertexAttribArray(sp->a("texCoord0"));
@@ -651,189 +345,6 @@ void drawExplosionSprite(float t, const glm::mat4& M) {
 }
 
 
-void startExplosion(const glm::vec3& pos) {
-	explosionActive = true;
-	explosionTimer = 0.0f;
-	explosionPos = pos;
-}
-
-float takeoffTimer = 0.0f;
-
-void updatePhysics(float dt) {
-	if (explosionActive) {
-		explosionTimer += dt;
-		if (explosionTimer >= explosionDuration) {
-			explosionActive = false;
-			// Reset to airport
-			airplane.pos = airportCenter + airportDrawOffset + glm::vec3(-31.23f, 3.0f, 185);
-			airplane.yaw = glm::radians(180.0f);
-			airplane.pitch = 0;
-			currentYawRate = 0;
-			targetYawRate = 0;
-			yawRate = 0;
-			pitchRate = 0;
-			currentRollAngle = 0;
-			throttle = 0.0f;
-			targetThrottle = 0.0f;
-			airplane.speed = 0.0f;
-			onGround = true;
-			verticalSpeed = 0.0f;
-			isStalling = false;
-			isLandingAssistActive = false;
-		}
-		return;
-	}
-
-	// Update landing assistance
-	updateLandingAssist(dt);
-
-	// Throttle handling
-	const float throttleRate = 0.5f;
-	if (throttleUpPressed)
-		targetThrottle = glm::min(1.0f, targetThrottle + throttleRate * dt);
-	if (throttleDownPressed)
-		targetThrottle = glm::max(0.0f, targetThrottle - throttleRate * dt);
-
-	// Smooth throttle change
-	float thrDiff = targetThrottle - throttle;
-	float maxThrStep = 1.5f * dt;
-	if (fabs(thrDiff) < maxThrStep) throttle = targetThrottle;
-	else throttle += glm::sign(thrDiff) * maxThrStep;
-	throttle = glm::clamp(throttle, 0.0f, 1.0f);
-
-	// Speed calculation
-	float targetSpeed = throttle * MAX_SPEED;
-	float spdDiff = targetSpeed - airplane.speed;
-	float maxSpdStep = 7.0f * dt;
-	if (fabs(spdDiff) < maxSpdStep) airplane.speed = targetSpeed;
-	else airplane.speed += glm::sign(spdDiff) * maxSpdStep;
-	airplane.speed = glm::clamp(airplane.speed, 0.0f, MAX_SPEED);
-
-	// ----------- On Ground ----------
-	if (onGround || airplane.pos.y == MIN_Y) {
-		airplane.pos.y = airportGroundLevel + 2.0f;
-		currentRollAngle = glm::mix(currentRollAngle, 0.0f, 0.3f);
-		verticalSpeed = 0.0f;
-		isStalling = false;
-
-		if (pitchRate == 0.0f) {
-			airplane.pitch = glm::mix(airplane.pitch, 0.0f, 0.1f);
-		}
-		else {
-			airplane.pitch += pitchRate * dt;
-			airplane.pitch = glm::clamp(airplane.pitch, glm::radians(-15.0f), glm::radians(15.0f));
-		}
-
-		// Improved takeoff conditions
-		if (airplane.speed >= MIN_TAKEOFF_SPEED && airplane.pitch < glm::radians(-5.0f)) { // Nose up for takeoff
-			onGround = false;
-			takeoffTimer = 1.2f; // Give more time for takeoff transition
-			verticalSpeed = 2.0f; // Initial upward velocity
-			std::cout << "Taking off! Speed: " << airplane.speed << std::endl;
-		}
-	}
-
-	// ---------- In Air -----------
-	else {
-		// Takeoff transition period - be extra careful about collisions
-		if (takeoffTimer > 0.0f) {
-			takeoffTimer -= dt;
-			// Gradually increase altitude during takeoff
-			airplane.pos.y = glm::max(airplane.pos.y, airportGroundLevel + 2.0f + (1.0f - takeoffTimer) * 5.0f);
-		}
-
-		// Free pitch control
-		airplane.pitch += pitchRate * dt;
-		airplane.pitch = glm::clamp(airplane.pitch, glm::radians(-45.0f), glm::radians(45.0f));
-
-		// Stall handling
-		if (airplane.speed < STALL_SPEED && airplane.pos.y > MIN_Y + 0.5f) {
-			if (!isStalling) {
-				isStalling = true;
-			}
-			airplane.pitch = glm::mix(airplane.pitch, STALL_NOSEDOWN, 1.0f - expf(-STALL_BLEND_SPEED * dt));
-			verticalSpeed -= GRAVITY * dt;
-			airplane.pos.y += verticalSpeed * dt;
-		}
-		else {
-			if (isStalling) {
-				isStalling = false;
-				verticalSpeed = 0.0f;
-			}
-		}
-
-		// Apply vertical movement for stalling
-		if (isStalling) {
-			glm::mat4 R(1.0f);
-			R = glm::rotate(R, airplane.yaw, glm::vec3(0, 1, 0));
-			R = glm::rotate(R, airplane.pitch, glm::vec3(1, 0, 0));
-			glm::vec3 localDown = glm::normalize(glm::vec3(R * glm::vec4(0, -1, 0, 0)));
-			airplane.pos += localDown * (-verticalSpeed * dt);
-		}
-
-	}
-
-	// Yaw and roll control
-	float diff = targetYawRate - currentYawRate;
-	float maxStep = yawAccel * dt;
-	diff = glm::clamp(diff, -maxStep, maxStep);
-	currentYawRate += diff;
-	airplane.yaw += currentYawRate * dt;
-
-	// Roll
-	float desiredRoll = glm::clamp(-currentYawRate * 0.5f,
-		glm::radians(-30.0f), glm::radians(30.0f));
-	float rollDiff = desiredRoll - currentRollAngle;
-	float maxRollStep = rollAccel * dt;
-	rollDiff = glm::clamp(rollDiff, -maxRollStep, maxRollStep);
-	currentRollAngle += rollDiff;
-
-	// Forward movement
-	glm::mat4 R(1.0f);
-	R = glm::rotate(R, airplane.yaw, glm::vec3(0, 1, 0));
-	R = glm::rotate(R, airplane.pitch, glm::vec3(1, 0, 0));
-	R = glm::rotate(R, currentRollAngle, glm::vec3(0, 0, 1));
-	glm::vec3 forward = glm::normalize(glm::vec3(R * glm::vec4(0, 0, 1, 0)));
-	airplane.pos += forward * (airplane.speed * dt);
-
-	// Boundary checks (more lenient)
-	bool outOfBounds = false;
-	float boundary_buffer = 20.0f; // Give some extra space
-	if (airplane.pos.x <= (MIN_X - boundary_buffer) || airplane.pos.x >= (MAX_X + boundary_buffer) ||
-		airplane.pos.z <= (MIN_Z - boundary_buffer) || airplane.pos.z >= (MAX_Z + boundary_buffer)) {
-		outOfBounds = true;
-	}
-
-	// Clamp position but don't explode immediately if near airport
-	airplane.pos.x = glm::clamp(airplane.pos.x, MIN_X - boundary_buffer, MAX_X + boundary_buffer);
-	airplane.pos.z = glm::clamp(airplane.pos.z, MIN_Z - boundary_buffer, MAX_Z + boundary_buffer);
-	airplane.pos.y = glm::clamp(airplane.pos.y, MIN_Y, MAX_Y);
-
-	if (!onGround && (airplane.pos.y <= airportGroundLevel + 2.0f)) {
-
-		onGround = true;
-		airplane.pos.y = airportGroundLevel + 2.0f;
-		verticalSpeed = 0.0f;
-		throttle = 0.0f;
-		targetThrottle = 0.0f;
-		std::cout << "Landed!" << std::endl;
-	}
-
-	// Only explode if really out of bounds and not near airport
-	if (outOfBounds && !isOverAirport(airplane.pos)) {
-		startExplosion(airplane.pos);
-		return;
-	}
-
-	// Only check collision if not in takeoff transition
-	if (takeoffTimer <= 0.0f && checkCollision(airplane.pos)) {
-		startExplosion(airplane.pos);
-		return;
-	}
-}
-
-
-
 void drawText(float x, float y, const char* text, float r, float g, float b) {
 	static char buffer[99999]; // duży bufor na wierzchołki
 	int num_quads = stb_easy_font_print(x, y, (char*)text, nullptr, buffer, sizeof(buffer));
@@ -842,23 +353,56 @@ void drawText(float x, float y, const char* text, float r, float g, float b) {
 	glEnableClientState(GL_VERTEX_ARRAY);
 	glVertexPointer(2, GL_FLOAT, 16, buffer);
 	glDrawArrays(GL_QUADS, 0, num_quads * 4);
+	renderCounters.drawCalls++;
+	renderCounters.triangles += 2 * num_quads;
 	glDisableClientState(GL_VERTEX_ARRAY);
 }
 
-void displayFlightInfo() {
-	static auto last = std::chrono::steady_clock::now();
-	auto now = std::chrono::steady_clock::now();
-	float dt = std::chrono::duration<float>(now - last).count();
-	if (dt > 1.5f) {
-		std::cout << "Speed & POS_Y: " << airplane.speed << ", " << airplane.pos.y
-			<< " | Throttle: " << int(throttle * 100)
-			<< " | " << (onGround ? "ON GROUND" : "IN AIR")
-			<< std::endl;
-		last = now;
-	}
+// Memory per asset (F3): totals, the process RSS and the largest assets, in MB
+void drawMemoryOverlay(int w) {
+	const size_t SHOWN = 8;
+	const float lineH = 15.0f, boxW = 440.0f;
+	std::vector<AssetMemory> report = assetMemoryReport();
+	AssetMemory total = assetMemoryTotal();
+	size_t rows = std::min(SHOWN, report.size());
+	float x = w - boxW - 10.0f, y = 10.0f;
+
+	glColor4f(0.0f, 0.0f, 0.0f, 0.5f);
+	glBegin(GL_QUADS);
+	glVertex2f(x, y);
+	glVertex2f(x + boxW, y);
+	glVertex2f(x + boxW, y + (rows + 4) * lineH + 10.0f);
+	glVertex2f(x, y + (rows + 4) * lineH + 10.0f);
+	glEnd();
+	renderCounters.drawCalls++;
+	renderCounters.triangles += 2;
+
+	char buf[64];
+	auto row = [&](float rowY, const std::string& name, const AssetMemory& a, float grey) {
+		std::string shown = name.size() > 32 ? "..." + name.substr(name.size() - 29) : name;
+		drawText(x + 10, rowY, shown.c_str(), grey, grey, grey);
+		const int64_t columns[3] = { a.cpuBytes, a.gpuBufferBytes, a.gpuTextureBytes };
+		for (int c = 0; c < 3; c++) {
+			snprintf(buf, sizeof(buf), "%.1f", double(columns[c]) / (1024.0 * 1024.0));
+			drawText(x + 230 + c * 70.0f, rowY, buf, grey, grey, grey);
+		}
+	};
+
+	float rowY = y + 8.0f;
+	drawText(x + 10, rowY, "Memory, MB", 1.0f, 1.0f, 0.0f);
+	drawText(x + 230, rowY, "CPU", 1.0f, 1.0f, 0.0f);
+	drawText(x + 300, rowY, "GPU buf", 1.0f, 1.0f, 0.0f);
+	drawText(x + 370, rowY, "GPU tex", 1.0f, 1.0f, 0.0f);
+	rowY += lineH;
+	row(rowY, "total", total, 1.0f);
+	rowY += lineH;
+	snprintf(buf, sizeof(buf), "process resident %.1f", double(processResidentBytes()) / (1024.0 * 1024.0));
+	drawText(x + 10, rowY, buf, 1.0f, 1.0f, 1.0f);
+	rowY += lineH;
+	for (size_t i = 0; i < rows; i++, rowY += lineH) row(rowY, report[i].name, report[i], 0.8f);
 }
 
-void drawOverlay() {
+void drawOverlay(const SimSnapshot& s) {
 	// Ustaw tryb 2D
 	glMatrixMode(GL_PROJECTION);
 	glPushMatrix();
@@ -885,21 +429,40 @@ void drawOverlay() {
 	glVertex2f(10 + boxW, 10 + boxH);
 	glVertex2f(10, 10 + boxH);
 	glEnd();
+	renderCounters.drawCalls++;
+	renderCounters.triangles += 2;
 
 	// Rysowanie tekstu
 	char buf[64];
-	snprintf(buf, sizeof(buf), "Throttle: %.1f %%", throttle * 100.0f);
-	if (isStalling && !onGround)
+	snprintf(buf, sizeof(buf), "Throttle: %.1f %%", s.throttle * 100.0f);
+	if (s.isStalling && !s.onGround)
 		drawText(20, 21, buf, 1.0f, 0.0f, 0.0f);
 	else
 		drawText(20, 21, buf, 1.0f, 1.0f, 1.0f);
 
-	if (airplane.pos.y > 1.05f)
-		snprintf(buf, sizeof(buf), "Altitude: %.1f m", airplane.pos.y * 15.0f - 15.2f);
+	if (s.airplane.pos.y > 1.05f)
+		snprintf(buf, sizeof(buf), "Altitude: %.1f m", s.airplane.pos.y * 15.0f - 15.2f);
 	else
 		snprintf(buf, sizeof(buf), "Altitude: 0.0 m");
 	drawText(20, 41, buf, 1.0f, 1.0f, 1.0f);
 
+	// GPWS alerts, most urgent first
+	uint32_t alerts = gpws.alerts();
+	float alertY = 80.0f;
+	if (alerts & GPWS_PULL_UP) {
+		drawText(w * 0.5f - 20.0f, alertY, "PULL UP", 1.0f, 0.0f, 0.0f);
+		alertY += 15.0f;
+	}
+	if (alerts & GPWS_BUILDING_AHEAD) {
+		drawText(w * 0.5f - 40.0f, alertY, "BUILDING AHEAD", 1.0f, 0.6f, 0.0f);
+		alertY += 15.0f;
+	}
+	if (alerts & GPWS_TOO_LOW) {
+		drawText(w * 0.5f - 20.0f, alertY, "TOO LOW", 1.0f, 0.6f, 0.0f);
+	}
+
+	if (showMemoryOverlay) drawMemoryOverlay(w);
+
 	// Przywrócenie stanu
 	glDisable(GL_BLEND);
 	glEnable(GL_DEPTH_TEST);
@@ -912,59 +475,53 @@ void drawOverlay() {
 
 
 
-void drawModel(
-	const std::vector<std::vector<float>>& vertsPerMat,
-	const std::vector<std::vector<float>>& normsPerMat,
-	const std::vector<std::vector<float>>& uvsPerMat,
-	const std::vector<int>& countsPerMat,
-	const std::vector<GLuint>& matTexIDs
-) {
+void drawModel(const GpuModel& model, const std::vector<int>& countsPerMat, const std::vector<GLuint>& matTexIDs) {
 	for (size_t m = 0; m < matTexIDs.size(); m++) {
+		if (countsPerMat[m] == 0) continue;
 		GLuint tex = matTexIDs[m];
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, tex);
 		glUniform1i(sp->u("textureMap0"), 0);
 
 		glEnableVertexAttribArray(sp->a("vertex"));
-		glVertexAttribPointer(sp->a("vertex"), 4, GL_FLOAT, GL_FALSE, 0, vertsPerMat[m].data());
+		glBindBuffer(GL_ARRAY_BUFFER, model.verts[m]);
+		glVertexAttribPointer(sp->a("vertex"), 4, GL_FLOAT, GL_FALSE, 0, nullptr);
 
 		glEnableVertexAttribArray(sp->a("normal"));
-		glVertexAttribPointer(sp->a("normal"), 4, GL_FLOAT, GL_FALSE, 0, normsPerMat[m].data());
+		glBindBuffer(GL_ARRAY_BUFFER, model.norms[m]);
+		glVertexAttribPointer(sp->a("normal"), 4, GL_FLOAT, GL_FALSE, 0, nullptr);
 
 		glEnableVertexAttribArray(sp->a("texCoord0"));
-		glVertexAttribPointer(sp->a("texCoord0"), 2, GL_FLOAT, GL_FALSE, 0, uvsPerMat[m].data());
+		glBindBuffer(GL_ARRAY_BUFFER, model.uvs[m]);
+		glVertexAttribPointer(sp->a("texCoord0"), 2, GL_FLOAT, GL_FALSE, 0, nullptr);
 
 		glDrawArrays(GL_TRIANGLES, 0, countsPerMat[m]);
+		renderCounters.drawCalls++;
+		renderCounters.triangles += countsPerMat[m] / 3;
 
 		glDisableVertexAttribArray(sp->a("vertex"));
 		glDisableVertexAttribArray(sp->a("normal"));
 		glDisableVertexAttribArray(sp->a("texCoord0"));
 	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0); // the sprites and the HUD draw from client memory
 }
 
-void drawScene(GLFWwindow* window) {
+// Draws one frame into the back buffer; the caller swaps
+void drawScene() {
+	// 3D scene goes to the scaled offscreen target, the HUD is drawn after the upscale
+	dynRes->beginScene();
 	glClearColor(0.2f, 0.5f, 1.0f, 1.0f); // Niebo
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	glm::mat4 R(1.0f);
-	R = glm::rotate(R, airplane.yaw, glm::vec3(0, 1, 0));
-	R = glm::rotate(R, airplane.pitch, glm::vec3(1, 0, 0));
-	float rollAngle = glm::clamp(-yawRate * 0.5f,
-		glm::radians(-30.0f),
-		glm::radians(30.0f));
-	R = glm::rotate(R, rollAngle, glm::vec3(0, 0, 1));
-
-	// model matrix for the airplane
-	glm::mat4 M = glm::translate(glm::mat4(1.0f), airplane.pos)
-		* glm::rotate(glm::mat4(1.0f), airplane.yaw, glm::vec3(0, 1, 0))
-		* glm::rotate(glm::mat4(1.0f), airplane.pitch, glm::vec3(1, 0, 0));
-
-	if (!onGround) {
-		M = M * glm::rotate(glm::mat4(1.0f), currentRollAngle, glm::vec3(0, 0, 1));
-	}
+	// Pick up the newest state published by the simulation thread
+	simSnapshots.update();
+	const SimSnapshot& s = simSnapshots.read();
+	const AirplaneState& airplane = s.airplane;
 
-	// recalc forward (−Z) after rotation
-	glm::vec3 forward = glm::normalize(glm::vec3(R * glm::vec4(0, 0, 1, 0)));
+	// model matrix for the airplane, straight from the simulated attitude
+	glm::mat4 M = glm::translate(glm::mat4(1.0f), airplane.pos) * glm::mat4_cast(airplane.attitude);
+
+	glm::vec3 forward = attitudeForward(airplane.attitude);
 	glm::vec3 worldUp = glm::vec3(0, 1, 0);
 
 	// place camera behind & above the plane
@@ -987,18 +544,18 @@ void drawScene(GLFWwindow* window) {
 	// draw City.obj
 	glm::mat4 I(1.0f);
 	glUniformMatrix4fv(sp->u("M"), 1, GL_FALSE, glm::value_ptr(I));
-	drawModel(vertsPerMatCity, normsPerMatCity, uvsPerMatCity, countsPerMatCity, matTexIDsCity);
+	drawModel(gpuCity, countsPerMatCity, matTexIDsCity);
 
 	// draw Airport.obj
 	glm::mat4 T = glm::translate(glm::mat4(1.0f), glm::vec3(-186.0f, 0.1f, 67.0f));
 	glUniformMatrix4fv(sp->u("M"), 1, GL_FALSE, glm::value_ptr(T));
-	drawModel(vertsPerMatAirport, normsPerMatAirport, uvsPerMatAirport, countsPerMatAirport, matTexIDsAirport);
+	drawModel(gpuAirport, countsPerMatAirport, matTexIDsAirport);
 
-	if (explosionActive) {
-		float t = explosionTimer / explosionDuration;
+	if (s.explosionActive) {
+		float t = s.explosionTimer / explosionDuration;
 		float scale = 1.5f;
 
-		glm::mat4 model = glm::translate(glm::mat4(1.0f), explosionPos);
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), s.explosionPos);
 
 		glm::vec3 camForward = glm::normalize(airplane.pos - camPos);
 		glm::vec3 up = glm::vec3(0, 1, 0);
@@ -1020,55 +577,340 @@ void drawScene(GLFWwindow* window) {
 			glm::mat4 M = model * crossRot;
 			drawExplosionSprite(t, M);
 		}
-		displayFlightInfo();
-		glfwSwapBuffers(window);
+		dynRes->endScene();
 		return;
 	}
 
 	// draw airplane
 	glUniformMatrix4fv(sp->u("M"), 1, GL_FALSE, glm::value_ptr(M));
-	drawModel(vertsPerMatJet, normsPerMatJet, uvsPerMatJet,
-		countsPerMatJet, matTexIDsJet);
+	drawModel(gpuJet, countsPerMatJet, matTexIDsJet);
+
+	// AI traffic close enough to see
+	for (const TrafficSnapshot& t : s.traffic) {
+		glm::mat4 TM = glm::translate(glm::mat4(1.0f), t.airplane.pos) * glm::mat4_cast(t.airplane.attitude);
+		glUniformMatrix4fv(sp->u("M"), 1, GL_FALSE, glm::value_ptr(TM));
+		drawModel(gpuJet, countsPerMatJet, matTexIDsJet);
+	}
 
 	glUseProgram(0);
-	drawOverlay();
+	dynRes->endScene();
+	drawOverlay(s);
+}
+
+
+
+const size_t MAX_DRAWN_TRAFFIC = 64;
+const float TRAFFIC_DRAW_DISTANCE = 600.0f;
+
+// Copies the current flight state into the next snapshot for the renderer
+void publishSnapshot() {
+	const Aircraft& a = aircraft[0];
+	SimSnapshot& s = simSnapshots.writeBuffer();
+	s.airplane = a.airplane;
+	s.throttle = a.throttle;
+	s.onGround = a.onGround;
+	s.isStalling = a.isStalling;
+	s.explosionActive = a.explosionActive;
+	s.explosionTimer = a.explosionTimer;
+	s.explosionPos = a.explosionPos;
+
+	s.traffic.clear();
+	for (size_t i = 1; i < aircraft.size() && s.traffic.size() < MAX_DRAWN_TRAFFIC; i++) {
+		const Aircraft& t = aircraft[i];
+		if (t.explosionActive || glm::distance(t.airplane.pos, a.airplane.pos) > TRAFFIC_DRAW_DISTANCE) continue;
+		s.traffic.push_back({ t.airplane });
+	}
+	simSnapshots.publish();
+}
+
+// Hands the current flight state to the GPWS worker
+void postGpwsState() {
+	const Aircraft& a = aircraft[0];
+	GpwsState g;
+	g.pos = a.airplane.pos;
+	g.forward = flightDirection(a.airplane.attitude, a.pathPitch);
+	g.speed = a.airplane.speed;
+	g.turnRate = a.currentYawRate;
+	g.active = !a.onGround && !a.explosionActive;
+	g.landing = a.isLandingAssistActive || a.takeoffTimer > 0.0f;
+	gpws.post(g);
+}
+
+void simulationLoop() {
+	using clock = std::chrono::steady_clock;
+	const auto tick = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(SIM_DT));
+	const auto maxLag = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(SIM_MAX_LAG));
+
+	std::vector<InputEvent> events;
+	auto next = clock::now();
+	while (simRunning.load(std::memory_order_acquire)) {
+		InputEvent ev;
+		events.clear();
+		while (inputQueue.pop(ev)) events.push_back(ev);
+		simulateTick(events.data(), events.size());
+		publishSnapshot();
+		postGpwsState();
+
+		next += tick;
+		auto now = clock::now();
+		if (now - next > maxLag) next = now;
+		std::this_thread::sleep_until(next);
+	}
+}
 
-	glfwSwapBuffers(window);
+// Plays the scripted fly-through through drawScene with the simulation stopped:
+// the player follows the path, the AI traffic stays where initWorld put it, so
+// every run draws the same frames. GPU time comes from timestamps around
+// drawScene, read a few frames late so the queries never stall the pipeline.
+int runRenderBenchmark(GLFWwindow* w) {
+	const float FRAME_SECONDS = 1.0f / 30.0f; // of flight per rendered frame
+	const int WARMUP_FRAMES = 60;
+	const int QUERY_FRAMES = 8;
+
+	std::vector<FlyThroughFrame> frames;
+	if (!buildFlyThrough(FRAME_SECONDS, frames)) {
+		std::cerr << "Cannot build the fly-through path\n";
+		return 1;
+	}
+	std::cout << "Fly-through: " << frames.size() << " frames, " << frames.size() * FRAME_SECONDS << " s of flight\n";
+
+	GLuint queries[2 * QUERY_FRAMES];
+	glGenQueries(2 * QUERY_FRAMES, queries);
+	std::vector<RenderFrameSample> samples;
+	samples.reserve(frames.size());
+	auto collectGpu = [&](size_t frame) {
+		GLuint64 begin = 0, end = 0;
+		int slot = int(frame % QUERY_FRAMES);
+		glGetQueryObjectui64v(queries[2 * slot], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(queries[2 * slot + 1], GL_QUERY_RESULT, &end);
+		samples[frame].gpuMs = double(end - begin) * 1e-6;
+	};
 
-	// DEBUG ONLY
-	// displayFlightInfo();
+	using clock = std::chrono::steady_clock;
+	auto lastSwap = clock::now();
+	for (size_t i = 0; i < frames.size() + WARMUP_FRAMES; i++) {
+		bool warmup = i < WARMUP_FRAMES; // the first frame again, while the driver settles
+		const FlyThroughFrame& f = frames[warmup ? 0 : i - WARMUP_FRAMES];
+		Aircraft& a = aircraft[0];
+		a.airplane.pos = f.pos;
+		a.airplane.attitude = f.attitude;
+		a.airplane.speed = f.speed;
+		a.throttle = f.throttle;
+		a.onGround = f.onGround;
+		a.isStalling = false;
+		a.explosionActive = false;
+		publishSnapshot();
+		renderCounters = RenderCounters();
+
+		size_t frame = samples.size();
+		if (!warmup && frame >= QUERY_FRAMES) collectGpu(frame - QUERY_FRAMES);
+		int slot = int(frame % QUERY_FRAMES);
+		if (!warmup) glQueryCounter(queries[2 * slot], GL_TIMESTAMP);
+		auto start = clock::now();
+		drawScene();
+		double cpuMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		if (!warmup) glQueryCounter(queries[2 * slot + 1], GL_TIMESTAMP);
+		glfwSwapBuffers(w);
+		glfwPollEvents();
+		auto now = clock::now();
+		double frameMs = std::chrono::duration<double, std::milli>(now - lastSwap).count();
+		lastSwap = now;
+
+		if (!warmup) samples.push_back({ cpuMs, 0.0, frameMs, renderCounters.drawCalls, renderCounters.triangles, f.phase });
+		if (glfwWindowShouldClose(w)) {
+			std::cerr << "Window closed, " << samples.size() << " of " << frames.size() << " frames rendered\n";
+			break;
+		}
+	}
+	for (size_t i = samples.size() > QUERY_FRAMES ? samples.size() - QUERY_FRAMES : 0; i < samples.size(); i++) collectGpu(i);
+	glDeleteQueries(2 * QUERY_FRAMES, queries);
+
+	int fbW, fbH;
+	glfwGetFramebufferSize(w, &fbW, &fbH);
+	std::cout << "Window " << fbW << " x " << fbH << ", scene scale " << dynRes->scale() << ", "
+		<< aircraft.size() - 1 << " AI aircraft" << (benchRenderHidden ? ", hidden" : "") << "\n";
+	reportRenderBenchmark(samples, "render_bench.csv");
+	return 0;
 }
 
 
+bool benchBvh = false;
+bool benchMesh = false;
+bool benchAabb = false;
+bool benchBatch = false;
+bool benchCity = false;
+bool benchFlight = false;
+std::string recordPath;
+std::string replayPath;
+std::string telemetryPath;
+bool replayWatch = false; // replay in the window at real time instead of headless
+int genCityBuildings = 0; // > 0: write a procedural city and exit
+CityGenConfig genCityConfig;
+
+// Command line: --target-ms <ms> --min-scale <s> --max-scale <s> --gpws-rays <n> --city <obj> --ai <n> --threads <n>
+//   --gen-city <buildings> [--gen-materials <n>] [--gen-tris <per building>] [--seed <n>]
+//   --record <file> --replay <file> [--watch] --telemetry <file> --drop-cpu-copies
+//   --bench-bvh --bench-mesh --bench-aabb --bench-batch --bench-city --bench-flight --bench-render [--hidden]
+
+void parseArgs(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--target-ms") && hasValue)
+			dynResConfig.targetFrameMs = float(atof(argv[++i]));
+		else if (!strcmp(argv[i], "--min-scale") && hasValue)
+			dynResConfig.minScale = float(atof(argv[++i]));
+		else if (!strcmp(argv[i], "--max-scale") && hasValue)
+			dynResConfig.maxScale = float(atof(argv[++i]));
+		else if (!strcmp(argv[i], "--gpws-rays") && hasValue)
+			gpwsRaysPerTick = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--ai") && hasValue)
+			aiAircraftCount = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && hasValue)
+			sharedJobs().resize(atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--city") && hasValue)
+			cityObjPath = argv[++i];
+		else if (!strcmp(argv[i], "--gen-city") && hasValue)
+			genCityBuildings = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--gen-materials") && hasValue)
+			genCityConfig.materials = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--gen-tris") && hasValue)
+			genCityConfig.trianglesPerBuilding = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && hasValue)
+			genCityConfig.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "--record") && hasValue)
+			recordPath = argv[++i];
+		else if (!strcmp(argv[i], "--replay") && hasValue)
+			replayPath = argv[++i];
+		else if (!strcmp(argv[i], "--telemetry") && hasValue)
+			telemetryPath = argv[++i];
+		else if (!strcmp(argv[i], "--drop-cpu-copies"))
+			dropCpuCopies = true;
+		else if (!strcmp(argv[i], "--watch"))
+			replayWatch = true;
+		else if (!strcmp(argv[i], "--bench-bvh"))
+			benchBvh = true;
+		else if (!strcmp(argv[i], "--bench-mesh"))
+			benchMesh = true;
+		else if (!strcmp(argv[i], "--bench-aabb"))
+			benchAabb = true;
+		else if (!strcmp(argv[i], "--bench-batch"))
+			benchBatch = true;
+		else if (!strcmp(argv[i], "--bench-city"))
+			benchCity = true;
+		else if (!strcmp(argv[i], "--bench-flight"))
+			benchFlight = true;
+		else if (!strcmp(argv[i], "--bench-render"))
+			benchRender = true;
+		else if (!strcmp(argv[i], "--hidden"))
+			benchRenderHidden = true;
+		else
+			std::cerr << "Unknown argument: " << argv[i] << "\n";
+	}
+}
+
 
 // ===== MAIN =====
-int main() {
+int main(int argc, char** argv) {
+	parseArgs(argc, argv);
+	if (benchBvh) return runBvhBenchmark();
+	if (benchMesh) return runMeshBenchmark();
+	if (benchAabb) return runAabbKernelBenchmark();
+	if (benchBatch) return runBatchBenchmark();
+	if (benchCity) return runCityBenchmark();
+	if (benchFlight) return runFlightBenchmark();
+	if (genCityBuildings > 0) {
+		genCityConfig.buildings = genCityBuildings;
+		std::string out = "city_" + std::to_string(genCityBuildings) + ".obj";
+		CityGenStats stats;
+		if (!generateCity(out, genCityConfig, &stats)) {
+			std::cerr << "Cannot write " << out << "\n";
+			return 1;
+		}
+		std::cout << "Wrote " << out << ": " << stats.buildings << " buildings, " << stats.materials
+			<< " materials, " << stats.triangles << " triangles\n";
+		return 0;
+	}
+
+	if (!telemetryPath.empty()) {
+		if (telemetryRecorder.open(telemetryPath, SIM_DT)) std::cout << "Recording telemetry to " << telemetryPath << "\n";
+		else std::cerr << "Cannot write telemetry " << telemetryPath << "\n";
+	}
+
+	InputLogHeader replayHeader;
+	if (!replayPath.empty()) {
+		// The recording decides the world; the command line cannot change it
+		if (!inputReplay.load(replayPath, replayHeader)) {
+			std::cerr << "Cannot read input log " << replayPath << "\n";
+			return 1;
+		}
+		if (replayHeader.tickSeconds != SIM_DT) {
+			std::cerr << replayPath << " was recorded with a different tick (" << replayHeader.tickSeconds << " s)\n";
+			return 1;
+		}
+		aiAircraftCount = replayHeader.aiAircraft;
+		cityObjPath = replayHeader.cityObj;
+		replayActive = true;
+		if (!replayWatch) {
+			if (!initWorld()) return 1;
+			applyLogStart(replayHeader);
+			int result = runReplay();
+			telemetryRecorder.close();
+			return result;
+		}
+	}
+
 	glfwSetErrorCallback(error_callback);
 	if (!glfwInit()) { std::cerr << "GLFW init failed\n"; return 1; }
 
 	int width = 1600;
 	int height = 900;
+	if (benchRender) {
+		// A fixed scene scale, or the frame times would steer what is being measured
+		dynResConfig.minScale = dynResConfig.maxScale;
+		if (benchRenderHidden) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 	GLFWwindow* w = glfwCreateWindow(width, height, "Symulator lotu", nullptr, nullptr);
 	glViewport(0, 0, width, height);
 	aspectRatio = float(width) / float(height);
 
 	if (!w) { glfwTerminate(); return 1; }
 	glfwMakeContextCurrent(w);
-	glfwSwapInterval(1);
+	glfwSwapInterval(benchRender ? 0 : 1);
 	if (glewInit() != GLEW_OK) { std::cerr << "GLEW init failed\n"; return 1; }
 
 	if (!initOpenGLProgram(w)) return 1;
+	if (replayActive) applyLogStart(replayHeader);
 
-	glfwSetTime(0);
-	while (!glfwWindowShouldClose(w)) {
-		float dt = glfwGetTime();
-		glfwSetTime(0);
+	if (benchRender) {
+		int result = runRenderBenchmark(w);
+		freeOpenGLProgram(w);
+		glfwDestroyWindow(w);
+		glfwTerminate();
+		return result;
+	}
+
+	if (!recordPath.empty() && !replayActive) {
+		if (inputRecorder.open(recordPath, sessionLogHeader())) std::cout << "Recording input to " << recordPath << "\n";
+		else std::cerr << "Cannot write input log " << recordPath << "\n";
+	}
 
-		updatePhysics(dt);
+	publishSnapshot();
+	simRunning = true;
+	simThread = std::thread(simulationLoop);
+	gpws.start(gpwsRayCast, SIM_DT, gpwsRaysPerTick);
 
-		drawScene(w);
+	while (!glfwWindowShouldClose(w)) {
+		drawScene();
+		glfwSwapBuffers(w);
 		glfwPollEvents();
 	}
+
+	simRunning = false;
+	simThread.join();
+	inputRecorder.close(simTick, hashSimState());
+	telemetryRecorder.close();
+	gpws.stop();
+	printAssetMemory(std::cout);
 	freeOpenGLProgram(w);
 	glfwDestroyWindow(w);
 	glfwTerminate();
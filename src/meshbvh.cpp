@@ -0,0 +1,285 @@
+#include "meshbvh.h"
+
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHBVH_SSE 1
+#include <emmintrin.h>
+#endif
+
+void MeshBvh::build(const std::vector<glm::vec3>& tv) {
+	packs.clear();
+	leafPack.clear();
+	triCount = tv.size() / 3;
+
+	std::vector<AABB> bounds(triCount);
+	for (size_t i = 0; i < triCount; i++) {
+		const glm::vec3& a = tv[3 * i], & b = tv[3 * i + 1], & c = tv[3 * i + 2];
+		bounds[i] = { glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)) };
+	}
+	bvh.build(bounds);
+
+	// Repack the triangles in leaf order, each leaf padded to whole packs.
+	// Padding lanes stay all zero: a degenerate triangle never reports a hit.
+	leafPack.assign(triCount, -1);
+	bvh.forEachLeaf([&](int32_t first, int32_t count) {
+		leafPack[first] = (int32_t)packs.size();
+		for (int32_t k = 0; k < count; k += 4) {
+			TriPack4 p = {};
+			for (int32_t j = 0; j < 4 && k + j < count; j++) {
+				size_t tri = bvh.originalIndex(first + k + j);
+				glm::vec3 v0 = tv[3 * tri];
+				glm::vec3 e1 = tv[3 * tri + 1] - v0;
+				glm::vec3 e2 = tv[3 * tri + 2] - v0;
+				p.v0x[j] = v0.x; p.v0y[j] = v0.y; p.v0z[j] = v0.z;
+				p.e1x[j] = e1.x; p.e1y[j] = e1.y; p.e1z[j] = e1.z;
+				p.e2x[j] = e2.x; p.e2y[j] = e2.y; p.e2z[j] = e2.z;
+			}
+			packs.push_back(p);
+		}
+	});
+}
+
+void MeshBvh::build(const std::vector<std::vector<float>>& vertsPerMat) {
+	std::vector<glm::vec3> tv;
+	for (const auto& verts : vertsPerMat) {
+		size_t vertexCount = verts.size() / 4;
+		for (size_t v = 0; v + 2 < vertexCount; v += 3) {
+			for (size_t k = 0; k < 3; k++) {
+				const float* p = &verts[4 * (v + k)];
+				tv.push_back(glm::vec3(p[0], p[1], p[2]));
+			}
+		}
+	}
+	build(tv);
+}
+
+int MeshBvh::intersectPack(const TriPack4& p, const glm::vec3& a, const glm::vec3& dir, float tMax, float& tOut) {
+	float t[4];
+	int mask;
+
+#ifdef MESHBVH_SSE
+	const __m128 dx = _mm_set1_ps(dir.x), dy = _mm_set1_ps(dir.y), dz = _mm_set1_ps(dir.z);
+	const __m128 e1x = _mm_loadu_ps(p.e1x), e1y = _mm_loadu_ps(p.e1y), e1z = _mm_loadu_ps(p.e1z);
+	const __m128 e2x = _mm_loadu_ps(p.e2x), e2y = _mm_loadu_ps(p.e2y), e2z = _mm_loadu_ps(p.e2z);
+
+	// pvec = dir x e2, det = e1 . pvec
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+	__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+	__m128 tx = _mm_sub_ps(_mm_set1_ps(a.x), _mm_loadu_ps(p.v0x));
+	__m128 ty = _mm_sub_ps(_mm_set1_ps(a.y), _mm_loadu_ps(p.v0y));
+	__m128 tz = _mm_sub_ps(_mm_set1_ps(a.z), _mm_loadu_ps(p.v0z));
+	__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), invDet);
+
+	// qvec = tvec x e1
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+	__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+	__m128 tt = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+	const __m128 zero = _mm_setzero_ps();
+	__m128 ok = _mm_cmpneq_ps(det, zero);
+	ok = _mm_and_ps(ok, _mm_cmpge_ps(u, zero));
+	ok = _mm_and_ps(ok, _mm_cmpge_ps(v, zero));
+	ok = _mm_and_ps(ok, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+	ok = _mm_and_ps(ok, _mm_cmpge_ps(tt, zero));
+	ok = _mm_and_ps(ok, _mm_cmple_ps(tt, _mm_set1_ps(tMax)));
+	mask = _mm_movemask_ps(ok);
+	_mm_storeu_ps(t, tt);
+#else
+	mask = 0;
+	for (int j = 0; j < 4; j++) {
+		glm::vec3 e1(p.e1x[j], p.e1y[j], p.e1z[j]);
+		glm::vec3 e2(p.e2x[j], p.e2y[j], p.e2z[j]);
+		glm::vec3 pv = glm::cross(dir, e2);
+		float det = glm::dot(e1, pv);
+		if (det == 0.0f) continue;
+		float invDet = 1.0f / det;
+		glm::vec3 tv = a - glm::vec3(p.v0x[j], p.v0y[j], p.v0z[j]);
+		float u = glm::dot(tv, pv) * invDet;
+		glm::vec3 qv = glm::cross(tv, e1);
+		float v = glm::dot(dir, qv) * invDet;
+		t[j] = glm::dot(e2, qv) * invDet;
+		if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t[j] >= 0.0f && t[j] <= tMax) mask |= 1 << j;
+	}
+#endif
+
+	int lane = -1;
+	for (int j = 0; j < 4; j++) {
+		if ((mask & (1 << j)) && (lane < 0 || t[j] < t[lane])) lane = j;
+	}
+	if (lane >= 0) tOut = t[lane];
+	return lane;
+}
+
+template <typename OnHit>
+void MeshBvh::walk(const glm::vec3& a, const glm::vec3& b, float& tMax, OnHit&& onHit) const {
+	glm::vec3 dir = b - a;
+	bvh.traverseSegment(a, b, tMax, [&](int32_t first, int32_t count, float& tLimit) {
+		int32_t pack = leafPack[first];
+		int32_t packEnd = pack + (count + 3) / 4;
+		for (; pack < packEnd; pack++) {
+			float t;
+			int lane = intersectPack(packs[pack], a, dir, tLimit, t);
+			if (lane >= 0 && onHit(packs[pack], lane, t, tLimit)) return true;
+		}
+		return false;
+	});
+}
+
+bool MeshBvh::firstHit(const glm::vec3& a, const glm::vec3& b, MeshHit& hit) const {
+	float tMax = 1.0f;
+	const TriPack4* bestPack = nullptr;
+	int bestLane = 0;
+	walk(a, b, tMax, [&](const TriPack4& p, int lane, float t, float& tLimit) {
+		tLimit = t;
+		bestPack = &p;
+		bestLane = lane;
+		return false;
+	});
+	if (!bestPack) return false;
+
+	glm::vec3 dir = b - a;
+	glm::vec3 e1(bestPack->e1x[bestLane], bestPack->e1y[bestLane], bestPack->e1z[bestLane]);
+	glm::vec3 e2(bestPack->e2x[bestLane], bestPack->e2y[bestLane], bestPack->e2z[bestLane]);
+	glm::vec3 n = glm::normalize(glm::cross(e1, e2));
+	hit.t = tMax;
+	hit.normal = glm::dot(n, dir) > 0.0f ? -n : n;
+	return true;
+}
+
+bool MeshBvh::anyHit(const glm::vec3& a, const glm::vec3& b) const {
+	float tMax = 1.0f;
+	bool found = false;
+	walk(a, b, tMax, [&](const TriPack4&, int, float, float&) {
+		found = true;
+		return true;
+	});
+	return found;
+}
+
+namespace {
+
+// Nearest point of triangle v0 + s e1 + t e2 to p (Ericson, Real-Time Collision Detection 5.1.5)
+glm::vec3 closestOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+	glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return b;
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return c;
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// Nearest points of segments p1->q1 and p2->q2 (Ericson 5.1.9); returns the squared distance
+float closestSegmentSegment(const glm::vec3& p1, const glm::vec3& q1, const glm::vec3& p2, const glm::vec3& q2,
+	glm::vec3& c1, glm::vec3& c2) {
+	const float EPS = 1e-12f;
+	glm::vec3 d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+	float a = glm::dot(d1, d1), e = glm::dot(d2, d2), f = glm::dot(d2, r);
+	float s, t;
+	if (a <= EPS && e <= EPS) {
+		s = t = 0.0f;
+	}
+	else if (a <= EPS) {
+		s = 0.0f;
+		t = glm::clamp(f / e, 0.0f, 1.0f);
+	}
+	else {
+		float c = glm::dot(d1, r);
+		if (e <= EPS) {
+			t = 0.0f;
+			s = glm::clamp(-c / a, 0.0f, 1.0f);
+		}
+		else {
+			float b = glm::dot(d1, d2);
+			float denom = a * e - b * b;
+			s = denom != 0.0f ? glm::clamp((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+			t = (b * s + f) / e;
+			if (t < 0.0f) {
+				t = 0.0f;
+				s = glm::clamp(-c / a, 0.0f, 1.0f);
+			}
+			else if (t > 1.0f) {
+				t = 1.0f;
+				s = glm::clamp((b - c) / a, 0.0f, 1.0f);
+			}
+		}
+	}
+	c1 = p1 + d1 * s;
+	c2 = p2 + d2 * t;
+	return glm::dot(c1 - c2, c1 - c2);
+}
+
+// Squared distance between the segment a->b and a triangle, with the nearest
+// point of the triangle. Either the segment crosses the triangle, or the
+// nearest pair has an end of the segment or lies on an edge of the triangle.
+float segmentTriangleDistSq(const glm::vec3& a, const glm::vec3& b, const glm::vec3& v0, const glm::vec3& e1,
+	const glm::vec3& e2, glm::vec3& onTriangle) {
+	glm::vec3 v1 = v0 + e1, v2 = v0 + e2;
+	glm::vec3 dir = b - a;
+	glm::vec3 pv = glm::cross(dir, e2);
+	float det = glm::dot(e1, pv);
+	if (det != 0.0f) {
+		float invDet = 1.0f / det;
+		glm::vec3 tv = a - v0;
+		float u = glm::dot(tv, pv) * invDet;
+		glm::vec3 qv = glm::cross(tv, e1);
+		float v = glm::dot(dir, qv) * invDet;
+		float t = glm::dot(e2, qv) * invDet;
+		if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t <= 1.0f) {
+			onTriangle = a + dir * t;
+			return 0.0f;
+		}
+	}
+
+	float best = FLT_MAX;
+	for (const glm::vec3& p : { a, b }) {
+		glm::vec3 q = closestOnTriangle(p, v0, v1, v2);
+		float d = glm::dot(p - q, p - q);
+		if (d < best) { best = d; onTriangle = q; }
+	}
+	const glm::vec3 edges[3][2] = { { v0, v1 }, { v1, v2 }, { v2, v0 } };
+	for (const auto& edge : edges) {
+		glm::vec3 onSegment, onEdge;
+		float d = closestSegmentSegment(a, b, edge[0], edge[1], onSegment, onEdge);
+		if (d < best) { best = d; onTriangle = onEdge; }
+	}
+	return best;
+}
+
+}
+
+bool MeshBvh::capsuleHit(const glm::vec3& a, const glm::vec3& b, float radius, glm::vec3& contact) const {
+	glm::vec3 r(radius);
+	AABB bounds = { glm::min(a, b) - r, glm::max(a, b) + r };
+	const float r2 = radius * radius;
+	return bvh.anyLeafOverlapping(bounds, [&](int32_t first, int32_t count) {
+		int32_t pack = leafPack[first];
+		for (int32_t k = 0; k < count; k++) {
+			const TriPack4& p = packs[pack + k / 4];
+			int j = k % 4;
+			glm::vec3 v0(p.v0x[j], p.v0y[j], p.v0z[j]);
+			glm::vec3 e1(p.e1x[j], p.e1y[j], p.e1z[j]);
+			glm::vec3 e2(p.e2x[j], p.e2y[j], p.e2z[j]);
+			if (segmentTriangleDistSq(a, b, v0, e1, e2, contact) < r2) return true;
+		}
+		return false;
+	});
+}
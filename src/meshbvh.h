@@ -0,0 +1,56 @@
+#ifndef MESHBVH_H
+#define MESHBVH_H
+
+#include "bvh.h"
+
+#include <vector>
+#include <cstdint>
+
+struct MeshHit {
+	float t;          // fraction along the segment, 0..1
+	glm::vec3 normal; // triangle normal, facing against the segment
+};
+
+// Triangle-level BVH used as the narrow phase behind the box tests. Every BVH
+// leaf owns whole packs of four triangles stored as structure of arrays, so one
+// SSE Moller-Trumbore pass tests four triangles at once.
+class MeshBvh {
+public:
+	// Three vertices per triangle
+	void build(const std::vector<glm::vec3>& triangleVerts);
+	// Flat [x,y,z,w, ...] vertex arrays as kept by loadModel, three vertices per triangle
+	void build(const std::vector<std::vector<float>>& vertsPerMat);
+
+	bool empty() const { return packs.empty(); }
+	size_t triangleCount() const { return triCount; }
+	size_t memoryBytes() const { return bvh.memoryBytes() + packs.capacity() * sizeof(TriPack4) + leafPack.capacity() * sizeof(int32_t); }
+
+	// Earliest triangle crossed by the segment a->b
+	bool firstHit(const glm::vec3& a, const glm::vec3& b, MeshHit& hit) const;
+	// Whether the segment a->b crosses any triangle (stops at the first one)
+	bool anyHit(const glm::vec3& a, const glm::vec3& b) const;
+	// Whether any triangle comes closer than radius to the segment a->b, i.e.
+	// touches the capsule around it; contact is the nearest point of the first
+	// such triangle
+	bool capsuleHit(const glm::vec3& a, const glm::vec3& b, float radius, glm::vec3& contact) const;
+
+private:
+	struct TriPack4 {
+		float v0x[4], v0y[4], v0z[4];
+		float e1x[4], e1y[4], e1z[4];
+		float e2x[4], e2y[4], e2z[4];
+	};
+
+	Bvh bvh;                         // over triangle bounds
+	std::vector<TriPack4> packs;     // leaves padded to whole packs
+	std::vector<int32_t> leafPack;   // first pack of the leaf starting at a leaf slot
+	size_t triCount = 0;
+
+	// Lowest t in (0, tMax] among the pack's triangles, lane index or -1
+	static int intersectPack(const TriPack4& p, const glm::vec3& a, const glm::vec3& dir, float tMax, float& tOut);
+
+	template <typename OnHit>
+	void walk(const glm::vec3& a, const glm::vec3& b, float& tMax, OnHit&& onHit) const;
+};
+
+#endif
@@ -0,0 +1,253 @@
+#include "microbench.h"
+#include "simulation.h"
+#include "lodepng.h"
+#include "jobs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using BenchClock = std::chrono::steady_clock;
+
+double secondsSince(BenchClock::time_point start) {
+	return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+volatile uint64_t sink; // every result ends up here, so no call is optimized away
+
+struct Result {
+	std::string name;
+	double medianNs, madNs, minNs, maxNs;
+	int samples;
+	uint64_t batch; // calls per sample
+};
+
+double median(std::vector<double> v) {
+	std::sort(v.begin(), v.end());
+	size_t n = v.size();
+	return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+// fn() is one call; reset() runs before the warmup and every sample, untimed.
+// maxBatch caps the calls per sample, 1 when every call must start from reset()
+template <typename Fn, typename Reset>
+Result measure(const std::string& name, const MicroBenchConfig& cfg, Fn&& fn, Reset&& reset, uint64_t maxBatch = UINT64_MAX) {
+	// The warmup also tells how many calls fill a sample
+	reset();
+	uint64_t calls = 0;
+	double elapsed = 0.0;
+	auto start = BenchClock::now();
+	do {
+		fn();
+		calls++;
+		elapsed = secondsSince(start);
+	} while (elapsed < cfg.warmupSeconds);
+	uint64_t batch = std::min(maxBatch, std::max<uint64_t>(1, uint64_t(cfg.sampleSeconds / (elapsed / calls))));
+
+	std::vector<double> perCall;
+	auto budget = BenchClock::now();
+	while ((int)perCall.size() < std::max(cfg.samples, 1)) {
+		reset();
+		auto t0 = BenchClock::now();
+		for (uint64_t i = 0; i < batch; i++) fn();
+		perCall.push_back(secondsSince(t0) * 1e9 / double(batch));
+		if (perCall.size() >= 5 && secondsSince(budget) > cfg.maxSeconds) break;
+	}
+
+	Result r;
+	r.name = name;
+	r.medianNs = median(perCall);
+	std::vector<double> deviation;
+	for (double t : perCall) deviation.push_back(std::fabs(t - r.medianNs));
+	r.madNs = median(deviation);
+	r.minNs = *std::min_element(perCall.begin(), perCall.end());
+	r.maxNs = *std::max_element(perCall.begin(), perCall.end());
+	r.samples = (int)perCall.size();
+	r.batch = batch;
+	printf("%-44s %14.1f %12.1f %6.1f%% %4d x %-8llu\n", name.c_str(), r.medianNs, r.madNs,
+		100.0 * r.madNs / std::max(r.medianNs, 1e-9), r.samples, (unsigned long long)r.batch);
+	fflush(stdout);
+	return r;
+}
+
+template <typename Fn>
+Result measure(const std::string& name, const MicroBenchConfig& cfg, Fn&& fn) {
+	return measure(name, cfg, fn, []() {});
+}
+
+std::string jsonEscape(const std::string& s) {
+	std::string out;
+	for (char c : s) {
+		if (c == '"' || c == '\\') out += '\\';
+		out += c;
+	}
+	return out;
+}
+
+bool writeJson(const std::string& path, const std::vector<Result>& results) {
+	std::ofstream out(path);
+	if (!out) return false;
+	char line[512];
+	out << "{\n  \"suite\": \"microbench\",\n  \"threads\": " << sharedJobs().threadCount()
+		<< ",\n  \"aircraft\": " << aircraft.size() << ",\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result& r = results[i];
+		snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"median_ns\": %.3f, \"mad_ns\": %.3f, \"min_ns\": %.3f, "
+			"\"max_ns\": %.3f, \"samples\": %d, \"batch\": %llu}%s\n", jsonEscape(r.name).c_str(), r.medianNs, r.madNs,
+			r.minNs, r.maxNs, r.samples, (unsigned long long)r.batch, i + 1 < results.size() ? "," : "");
+		out << line;
+	}
+	out << "  ]\n}\n";
+	return bool(out);
+}
+
+// Reads back what writeJson wrote: name -> (median, MAD)
+bool readJson(const std::string& path, std::map<std::string, std::pair<double, double>>& results) {
+	std::ifstream in(path);
+	if (!in) return false;
+	std::string line;
+	while (std::getline(in, line)) {
+		size_t key = line.find("\"name\": \"");
+		size_t median = line.find("\"median_ns\": ");
+		size_t mad = line.find("\"mad_ns\": ");
+		if (key == std::string::npos || median == std::string::npos || mad == std::string::npos) continue;
+		std::string name;
+		for (size_t i = key + 9; i < line.size() && line[i] != '"'; i++) {
+			if (line[i] == '\\' && i + 1 < line.size()) i++;
+			name += line[i];
+		}
+		results[name] = { atof(line.c_str() + median + 13), atof(line.c_str() + mad + 10) };
+	}
+	return true;
+}
+
+std::string baseName(const std::string& path) {
+	auto pos = path.find_last_of("/\\");
+	return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+}
+
+int runMicroBenchmarks(const MicroBenchConfig& cfg) {
+	std::vector<Result> results;
+	printf("%-44s %14s %12s %7s %s\n", "benchmark", "median ns", "MAD ns", "MAD", "samples x calls");
+
+	// Models, with the boxes loadModel appends dropped again after every call
+	{
+		const std::string models[] = { "jetanima.obj", cityObjPath, "Airport.obj" };
+		std::vector<std::vector<float>> verts, norms, uvs;
+		std::vector<int> counts;
+		std::vector<tinyobj::material_t> materials;
+		const size_t runways = airportRunwayAABBs.size(), obstacles = airportObstacles.size();
+		for (const std::string& model : models) {
+			std::streambuf* console = std::cout.rdbuf(nullptr); // loadModel reports every load
+			bool ok = true;
+			Result r = measure("loadModel " + model, cfg, [&]() {
+				ok &= loadModel(model, verts, norms, uvs, counts, materials);
+				airportRunwayAABBs.resize(runways);
+				airportObstacles.resize(obstacles);
+			});
+			std::cout.rdbuf(console);
+			std::cout.clear();
+			if (ok) results.push_back(r);
+			else std::cerr << "Cannot load " << model << ", left out\n";
+		}
+	}
+
+	// The three largest textures the models use, decoded from memory
+	{
+		std::vector<std::pair<long long, std::string>> textures;
+		for (const auto* materials : { &materialsJet, &materialsCity, &materialsAirport }) {
+			for (const auto& mat : *materials) {
+				std::string file = baseName(mat.diffuse_texname);
+				if (file.empty()) continue;
+				bool known = false;
+				for (const auto& t : textures) known |= t.second == file;
+				std::ifstream in(file, std::ios::binary | std::ios::ate);
+				if (!known && in) textures.push_back({ (long long)in.tellg(), file });
+			}
+		}
+		std::sort(textures.rbegin(), textures.rend());
+		if (textures.size() > 3) textures.resize(3);
+		if (textures.empty()) std::cerr << "No model textures found, lodepng::decode left out\n";
+		for (const auto& t : textures) {
+			std::vector<unsigned char> png;
+			if (lodepng::load_file(png, t.second)) continue;
+			std::vector<unsigned char> image;
+			results.push_back(measure("lodepng::decode " + t.second, cfg, [&]() {
+				unsigned w, h;
+				sink += lodepng::decode(image, w, h, png);
+				sink += image.size();
+			}));
+		}
+	}
+
+	// Point queries: half around the runway and its approaches, half anywhere over the map
+	{
+		const size_t POINTS = 4096; // a power of two
+		RunwayInfo rw = mainRunway();
+		uint32_t rng = 12345u;
+		auto random = [&](float lo, float hi) {
+			rng = rng * 1664525u + 1013904223u;
+			return lo + (hi - lo) * float(rng >> 8) * (1.0f / 16777216.0f);
+		};
+		std::vector<glm::vec3> points;
+		for (size_t i = 0; i < POINTS; i++) {
+			if (i % 2) points.push_back(glm::vec3(random(rw.centreX - 60.0f, rw.centreX + 60.0f), rw.groundY + random(0.0f, 30.0f),
+				random(rw.minZ - 80.0f, rw.maxZ + 80.0f)));
+			else points.push_back(glm::vec3(random(MIN_X, MAX_X), rw.groundY + random(0.0f, 100.0f), random(MIN_Z, MAX_Z)));
+		}
+		size_t next = 0;
+		results.push_back(measure("checkCollision", cfg, [&]() {
+			const glm::vec3& p = points[next++ & (POINTS - 1)];
+			sink += checkCollision(p, p.y < rw.groundY + 1.0f);
+		}));
+		results.push_back(measure("isOnRunway", cfg, [&]() { sink += isOnRunway(points[next++ & (POINTS - 1)]); }));
+		results.push_back(measure("isInLandingApproach", cfg, [&]() { sink += isInLandingApproach(points[next++ & (POINTS - 1)]); }));
+	}
+
+	// One tick of the whole fleet, every sample a single tick from the same state
+	{
+		const std::vector<Aircraft> saved = aircraft;
+		bool report = simTickReport;
+		simTickReport = false;
+		results.push_back(measure("updatePhysics, " + std::to_string(aircraft.size()) + " aircraft", cfg,
+			[]() { updatePhysics(SIM_DT); }, [&]() { aircraft = saved; }, 1));
+		aircraft = saved;
+		simTickReport = report;
+	}
+
+	if (writeJson(cfg.jsonPath, results)) printf("Results written to %s\n", cfg.jsonPath.c_str());
+	else std::cerr << "Cannot write " << cfg.jsonPath << "\n";
+
+	if (!cfg.baselinePath.empty()) {
+		std::map<std::string, std::pair<double, double>> baseline;
+		if (!readJson(cfg.baselinePath, baseline)) {
+			std::cerr << "Cannot read baseline " << cfg.baselinePath << "\n";
+			return 1;
+		}
+		// A change counts when the medians are further apart than three MADs of the noisier run
+		printf("\n%-44s %14s %14s %9s\n", "against baseline", "before ns", "now ns", "change");
+		for (const Result& r : results) {
+			auto it = baseline.find(r.name);
+			if (it == baseline.end()) continue;
+			double before = it->second.first;
+			double noise = 3.0 * std::max(r.madNs, it->second.second);
+			const char* verdict = std::fabs(r.medianNs - before) <= noise ? "same" : (r.medianNs < before ? "faster" : "slower");
+			printf("%-44s %14.1f %14.1f %+8.1f%% %s\n", r.name.c_str(), before, r.medianNs,
+				100.0 * (r.medianNs - before) / std::max(before, 1e-9), verdict);
+		}
+	}
+	return 0;
+}
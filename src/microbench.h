@@ -0,0 +1,23 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <string>
+
+struct MicroBenchConfig {
+	double warmupSeconds = 0.2;  // per benchmark, untimed
+	double sampleSeconds = 0.02; // calls are batched to fill about this much per sample
+	int samples = 31;
+	double maxSeconds = 3.0;     // per benchmark; slow ones stop early, after at least 5 samples
+	std::string jsonPath = "microbench.json";
+	std::string baselinePath;    // earlier JSON output to compare with, optional
+};
+
+// Hot functions of the loaders and the simulation tick: loadModel of every
+// model, lodepng::decode of the largest textures, checkCollision, isOnRunway,
+// isInLandingApproach and updatePhysics. Each gets a warmup, then samples of
+// batched calls; the median and the median absolute deviation of the time per
+// call are printed and written to jsonPath, one result per line. With a
+// baseline the change against it is printed too. Needs initWorld() first.
+int runMicroBenchmarks(const MicroBenchConfig& cfg);
+
+#endif
@@ -0,0 +1,422 @@
+#include "navgrid.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+const int NavGrid::MAX_CLEARANCE;
+const int NavGrid::BLOCK;
+
+namespace {
+
+const size_t MAX_CELLS = size_t(1) << 24; // 8 MB of clearance at most
+const float FAR_AWAY = 1e20f;             // squared distance of a cell with no obstacle yet
+const int CORNER_STEPS = 4;               // segments per rounded corner
+const float HEURISTIC_WEIGHT = 1.5f;
+const float MOVE_COST[4] = { 0.0f, 1.0f, 1.41421356f, 1.73205081f }; // by squared length
+
+uint64_t fnv1a(uint64_t h, const void* data, size_t bytes) {
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i = 0; i < bytes; i++) {
+		h ^= p[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+// Squared Euclidean distance transform of one line of n samples, spaced by
+// stride, in place (Felzenszwalb and Huttenlocher: lower envelope of parabolas)
+void distanceLine(float* line, size_t stride, int n, std::vector<float>& f, std::vector<int>& v, std::vector<float>& z) {
+	for (int q = 0; q < n; q++) f[q] = line[q * stride];
+
+	int k = 0;
+	v[0] = 0;
+	z[0] = -FLT_MAX;
+	z[1] = FLT_MAX;
+	auto meet = [&](int q, int r) { return ((f[q] + float(q * q)) - (f[r] + float(r * r))) / float(2 * (q - r)); };
+	for (int q = 1; q < n; q++) {
+		float s = meet(q, v[k]);
+		while (s <= z[k]) s = meet(q, v[--k]);
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = FLT_MAX;
+	}
+
+	k = 0;
+	for (int q = 0; q < n; q++) {
+		while (z[k + 1] < float(q)) k++;
+		float dq = float(q - v[k]);
+		line[q * stride] = dq * dq + f[v[k]];
+	}
+}
+
+}
+
+uint64_t NavGrid::hashObstacles(const std::vector<AABB>& obstacles, glm::vec3 boundsMin, glm::vec3 boundsMax) {
+	uint64_t h = 14695981039346656037ull;
+	if (!obstacles.empty()) h = fnv1a(h, obstacles.data(), obstacles.size() * sizeof(AABB));
+	h = fnv1a(h, &boundsMin, sizeof(boundsMin));
+	h = fnv1a(h, &boundsMax, sizeof(boundsMax));
+	return h;
+}
+
+bool NavGrid::bake(const std::string& path, const std::vector<AABB>& obstacles,
+	glm::vec3 boundsMin, glm::vec3 boundsMax, uint64_t sourceHash, float cellSize) {
+	glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(cellSize));
+	cellSize = std::max(cellSize, std::cbrt(extent.x * extent.y * extent.z / MAX_CELLS));
+	const int w = std::max(2, int(std::ceil(extent.x / cellSize)));
+	const int h = std::max(2, int(std::ceil(extent.y / cellSize))) + 1; // + the ground layer
+	const int d = std::max(2, int(std::ceil(extent.z / cellSize)));
+	const glm::vec3 origin = boundsMin - glm::vec3(0.0f, cellSize, 0.0f);
+	const float inv = 1.0f / cellSize;
+	const size_t layer = size_t(w) * d;
+
+	// Squared distance in cells to the nearest blocked cell; the ground and every
+	// cell a box touches are blocked
+	std::vector<float> dist(layer * h, FAR_AWAY);
+	std::fill(dist.begin(), dist.begin() + layer, 0.0f);
+	for (const auto& box : obstacles) {
+		int x0 = std::max(0, int(std::floor((box.min.x - origin.x) * inv)));
+		int x1 = std::min(w - 1, int(std::floor((box.max.x - origin.x) * inv)));
+		int y0 = std::max(0, int(std::floor((box.min.y - origin.y) * inv)));
+		int y1 = std::min(h - 1, int(std::floor((box.max.y - origin.y) * inv)));
+		int z0 = std::max(0, int(std::floor((box.min.z - origin.z) * inv)));
+		int z1 = std::min(d - 1, int(std::floor((box.max.z - origin.z) * inv)));
+		if (x0 > x1 || y0 > y1 || z0 > z1) continue; // outside the grid
+		for (int iy = y0; iy <= y1; iy++) {
+			for (int iz = z0; iz <= z1; iz++) {
+				float* row = dist.data() + (size_t(iy) * d + iz) * w;
+				std::fill(row + x0, row + x1 + 1, 0.0f);
+			}
+		}
+	}
+
+	// Separable transform: along X, then Z, then Y
+	int longest = std::max({ w, h, d });
+	std::vector<float> f(longest), z(longest + 1);
+	std::vector<int> v(longest);
+	for (int iy = 0; iy < h; iy++) {
+		for (int iz = 0; iz < d; iz++) distanceLine(dist.data() + (size_t(iy) * d + iz) * w, 1, w, f, v, z);
+		for (int ix = 0; ix < w; ix++) distanceLine(dist.data() + size_t(iy) * layer + ix, w, d, f, v, z);
+	}
+	for (size_t i = 0; i < layer; i++) distanceLine(dist.data() + i, layer, h, f, v, z);
+
+	// Whole cells of clearance, at least 1 for a free cell
+	std::vector<uint8_t> cells(dist.size());
+	uint32_t storedLayers = 0;
+	for (int iy = 0; iy < h; iy++) {
+		for (size_t i = 0; i < layer; i++) {
+			float d2 = dist[size_t(iy) * layer + i];
+			int c = d2 == 0.0f ? 0 : std::min(MAX_CLEARANCE, std::max(1, int(std::sqrt(d2))));
+			cells[size_t(iy) * layer + i] = (uint8_t)c;
+			if (c < MAX_CLEARANCE) storedLayers = iy + 1;
+		}
+	}
+
+	const int bw = (w + BLOCK - 1) / BLOCK, bh = (h + BLOCK - 1) / BLOCK, bd = (d + BLOCK - 1) / BLOCK;
+	std::vector<uint8_t> blockMin(size_t(bw) * bh * bd, MAX_CLEARANCE);
+	for (int iy = 0; iy < h; iy++) {
+		for (int iz = 0; iz < d; iz++) {
+			for (int ix = 0; ix < w; ix++) {
+				uint8_t& b = blockMin[(size_t(iy / BLOCK) * bd + iz / BLOCK) * bw + ix / BLOCK];
+				b = std::min(b, cells[(size_t(iy) * d + iz) * w + ix]);
+			}
+		}
+	}
+
+	size_t storedCells = layer * storedLayers;
+	std::vector<uint8_t> packed((storedCells + 1) / 2, 0);
+	for (size_t i = 0; i < storedCells; i++) packed[i >> 1] |= uint8_t(cells[i] << ((i & 1) * 4));
+
+	Header hd = {};
+	std::memcpy(hd.magic, "NAVG", 4);
+	hd.version = VERSION;
+	hd.width = (uint32_t)w;
+	hd.height = (uint32_t)h;
+	hd.depth = (uint32_t)d;
+	hd.storedLayers = storedLayers;
+	hd.originX = origin.x;
+	hd.originY = origin.y;
+	hd.originZ = origin.z;
+	hd.cellSize = cellSize;
+	hd.blocksX = (uint32_t)bw;
+	hd.blocksY = (uint32_t)bh;
+	hd.blocksZ = (uint32_t)bd;
+	hd.sourceHash = sourceHash;
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cerr << "Cannot write navigation grid " << path << "\n";
+		return false;
+	}
+	out.write((const char*)&hd, sizeof(hd));
+	out.write((const char*)packed.data(), packed.size());
+	out.write((const char*)blockMin.data(), blockMin.size());
+	return bool(out);
+}
+
+bool NavGrid::load(const std::string& path, uint64_t sourceHash) {
+	header = nullptr;
+	packed = nullptr;
+	blocks = nullptr;
+	if (!file.open(path)) return false;
+
+	const Header* h = (const Header*)file.data();
+	if (file.size() < sizeof(Header) || std::memcmp(h->magic, "NAVG", 4) != 0 || h->version != VERSION ||
+		h->sourceHash != sourceHash || h->width < 2 || h->height < 2 || h->depth < 2 || h->storedLayers > h->height ||
+		h->blocksX != (h->width + BLOCK - 1) / BLOCK || h->blocksY != (h->height + BLOCK - 1) / BLOCK ||
+		h->blocksZ != (h->depth + BLOCK - 1) / BLOCK) {
+		file.close();
+		return false;
+	}
+	size_t packedBytes = (size_t(h->width) * h->depth * h->storedLayers + 1) / 2;
+	size_t blockBytes = size_t(h->blocksX) * h->blocksY * h->blocksZ;
+	if (file.size() != sizeof(Header) + packedBytes + blockBytes) {
+		file.close();
+		return false;
+	}
+
+	header = h;
+	packed = (const uint8_t*)(h + 1);
+	blocks = packed + packedBytes;
+	invCell = 1.0f / h->cellSize;
+	return true;
+}
+
+glm::ivec3 NavGrid::cells() const {
+	return header ? glm::ivec3(header->width, header->height, header->depth) : glm::ivec3(0);
+}
+
+bool NavGrid::segmentClear(glm::vec3 a, glm::vec3 b, float minClearance) const {
+	glm::vec3 d = b - a;
+	int steps = std::max(1, int(std::ceil(glm::length(d) * invCell * 2.0f)));
+	for (int i = 0; i <= steps; i++) {
+		if (clearance(a + d * (float(i) / steps)) < minClearance) return false;
+	}
+	return true;
+}
+
+int NavGrid::blockClearance(int bx, int by, int bz) const {
+	const Header& h = *header;
+	if (bx < 0 || by < 0 || bz < 0 || bx >= (int)h.blocksX || by >= (int)h.blocksY || bz >= (int)h.blocksZ) return 0;
+	return blocks[(size_t(by) * h.blocksZ + bz) * h.blocksX + bx];
+}
+
+// Middle of the block's cells inside the grid
+glm::vec3 NavGrid::blockCentre(int bx, int by, int bz) const {
+	const Header& h = *header;
+	glm::vec3 first(bx * BLOCK, by * BLOCK, bz * BLOCK);
+	glm::vec3 last(std::min<int>(bx * BLOCK + BLOCK, h.width), std::min<int>(by * BLOCK + BLOCK, h.height),
+		std::min<int>(bz * BLOCK + BLOCK, h.depth));
+	return glm::vec3(h.originX, h.originY, h.originZ) + (first + last) * 0.5f * h.cellSize;
+}
+
+// The block around p, or a neighbour p sees with the clearance; -1 if none
+int NavPlanner::entryBlock(const NavGrid& grid, glm::vec3 p, int needed, float clearance) const {
+	const NavGrid::Header& h = *grid.header;
+	const float blockSize = h.cellSize * NavGrid::BLOCK;
+	int bx = (int)std::floor((p.x - h.originX) / blockSize);
+	int by = (int)std::floor((p.y - h.originY) / blockSize);
+	int bz = (int)std::floor((p.z - h.originZ) / blockSize);
+	auto index = [&](int x, int y, int z) { return int((size_t(y) * h.blocksZ + z) * h.blocksX + x); };
+	if (grid.blockClearance(bx, by, bz) >= needed) return index(bx, by, bz);
+
+	int best = -1;
+	float bestDist = FLT_MAX;
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dz = -1; dz <= 1; dz++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				int x = bx + dx, y = by + dy, z = bz + dz;
+				if (grid.blockClearance(x, y, z) < needed) continue;
+				glm::vec3 c = grid.blockCentre(x, y, z);
+				float dist = glm::length(c - p);
+				if (dist < bestDist && grid.segmentClear(p, c, clearance)) {
+					best = index(x, y, z);
+					bestDist = dist;
+				}
+			}
+		}
+	}
+	return best;
+}
+
+// Calls fn(neighbour, cost) for the moves out of block b between blocks with
+// at least `needed` cells of clearance everywhere: 26 neighbours but no
+// straight climbs, and no cutting past a blocked corner
+template <typename Fn>
+void NavPlanner::forEachMove(const NavGrid& grid, int b, int needed, Fn&& fn) const {
+	const NavGrid::Header& h = *grid.header;
+	const int bw = (int)h.blocksX, bd = (int)h.blocksZ;
+	const glm::ivec3 c(b % bw, b / (bw * bd), (b / bw) % bd);
+	auto usable = [&](glm::ivec3 p) { return grid.blockClearance(p.x, p.y, p.z) >= needed; };
+
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dz = -1; dz <= 1; dz++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				if (dx == 0 && dz == 0) continue;
+				glm::ivec3 n = c + glm::ivec3(dx, dy, dz);
+				if (!usable(n)) continue;
+
+				// Every block the move's bounding box touches
+				bool clear = true;
+				for (int k = 1; k < 7 && clear; k++) {
+					glm::ivec3 corner = c + glm::ivec3(k & 1 ? dx : 0, k & 2 ? dy : 0, k & 4 ? dz : 0);
+					if (corner != c && corner != n) clear = usable(corner);
+				}
+				if (clear) fn(int((size_t(n.y) * bd + n.z) * bw + n.x), MOVE_COST[dx * dx + dy * dy + dz * dz]);
+			}
+		}
+	}
+}
+
+// Connected sets of blocks for one clearance, so that unreachable goals fail
+// without searching everything
+void NavPlanner::labelComponents(const NavGrid& grid, int needed) {
+	if (componentGrid == &grid && componentNeeded == needed) return;
+	const NavGrid::Header& h = *grid.header;
+	const int bw = (int)h.blocksX, bd = (int)h.blocksZ;
+	const size_t count = size_t(h.blocksX) * h.blocksY * h.blocksZ;
+	component.assign(count, -1);
+
+	std::vector<int> stack;
+	int label = 0;
+	for (size_t b = 0; b < count; b++) {
+		if (component[b] >= 0) continue;
+		int x = int(b % bw), y = int(b / (bw * bd)), z = int((b / bw) % bd);
+		if (grid.blockClearance(x, y, z) < needed) continue;
+
+		component[b] = label;
+		stack.push_back((int)b);
+		while (!stack.empty()) {
+			int cur = stack.back();
+			stack.pop_back();
+			forEachMove(grid, cur, needed, [&](int n, float) {
+				if (component[n] < 0) {
+					component[n] = label;
+					stack.push_back(n);
+				}
+			});
+		}
+		label++;
+	}
+	componentGrid = &grid;
+	componentNeeded = needed;
+}
+
+// Weighted A*: a little longer than the shortest block path at most, which the
+// string pulling straightens anyway, for far fewer expanded blocks
+bool NavPlanner::search(const NavGrid& grid, int start, int goal, int needed) {
+	const NavGrid::Header& h = *grid.header;
+	const int bw = (int)h.blocksX, bd = (int)h.blocksZ;
+	const size_t count = size_t(h.blocksX) * h.blocksY * h.blocksZ;
+	if (g.size() != count) {
+		g.assign(count, 0.0f);
+		parent.assign(count, -1);
+		seen.assign(count, 0);
+		closed.assign(count, 0);
+		generation = 0;
+	}
+	if (++generation == 0) {
+		std::fill(seen.begin(), seen.end(), 0);
+		std::fill(closed.begin(), closed.end(), 0);
+		generation = 1;
+	}
+
+	auto coords = [&](int b) { return glm::vec3(float(b % bw), float(b / (bw * bd)), float((b / bw) % bd)); };
+	const glm::vec3 goalPos = coords(goal);
+
+	open.clear();
+	g[start] = 0.0f;
+	parent[start] = -1;
+	seen[start] = generation;
+	open.push_back({ HEURISTIC_WEIGHT * glm::length(coords(start) - goalPos), start });
+	expanded = 0;
+
+	while (!open.empty()) {
+		std::pop_heap(open.begin(), open.end());
+		int b = open.back().block;
+		open.pop_back();
+		if (closed[b] == generation) continue;
+		closed[b] = generation;
+		expanded++;
+		if (b == goal) return true;
+
+		forEachMove(grid, b, needed, [&](int n, float step) {
+			if (closed[n] == generation) return;
+			float cost = g[b] + step;
+			if (seen[n] == generation && cost >= g[n]) return;
+			seen[n] = generation;
+			g[n] = cost;
+			parent[n] = b;
+			open.push_back({ cost + HEURISTIC_WEIGHT * glm::length(coords(n) - goalPos), n });
+			std::push_heap(open.begin(), open.end());
+		});
+	}
+	return false;
+}
+
+bool NavPlanner::findPath(const NavGrid& grid, glm::vec3 from, glm::vec3 to, const Config& cfg, std::vector<glm::vec3>& path) {
+	path.clear();
+	expanded = 0;
+	if (!grid.loaded() || grid.clearance(from) < cfg.clearance || grid.clearance(to) < cfg.clearance) return false;
+
+	// Blocks whose every cell keeps the clearance, so any move between them does too
+	int needed = std::min(NavGrid::MAX_CLEARANCE, int(std::ceil(cfg.clearance / grid.cellSize() + 0.5f)));
+	int start = entryBlock(grid, from, needed, cfg.clearance);
+	int goal = entryBlock(grid, to, needed, cfg.clearance);
+	if (start < 0 || goal < 0) return false;
+	labelComponents(grid, needed);
+	if (component[start] != component[goal] || !search(grid, start, goal, needed)) return false;
+
+	const NavGrid::Header& h = *grid.header;
+	const int bw = (int)h.blocksX, bd = (int)h.blocksZ;
+	corridor.clear();
+	corridor.push_back(to);
+	for (int b = goal; b >= 0; b = parent[b]) corridor.push_back(grid.blockCentre(b % bw, b / (bw * bd), (b / bw) % bd));
+	corridor.push_back(from);
+	std::reverse(corridor.begin(), corridor.end());
+
+	path.swap(corridor);
+	smooth(grid, cfg, path);
+	return true;
+}
+
+// String pulling against the fine cells, then quadratic arcs at the corners
+void NavPlanner::smooth(const NavGrid& grid, const Config& cfg, std::vector<glm::vec3>& path) {
+	auto flyable = [&](glm::vec3 a, glm::vec3 b) {
+		glm::vec3 d = b - a;
+		return std::fabs(d.y) <= std::sqrt(d.x * d.x + d.z * d.z) && grid.segmentClear(a, b, cfg.clearance);
+	};
+
+	corridor.clear();
+	corridor.push_back(path[0]);
+	for (size_t i = 0; i + 1 < path.size();) {
+		size_t j = i + 1;
+		while (j + 1 < path.size() && flyable(path[i], path[j + 1])) j++;
+		corridor.push_back(path[j]);
+		i = j;
+	}
+
+	path.clear();
+	path.push_back(corridor[0]);
+	for (size_t k = 1; k + 1 < corridor.size(); k++) {
+		glm::vec3 a = corridor[k - 1], b = corridor[k], c = corridor[k + 1];
+		float ab = glm::length(a - b), cb = glm::length(c - b);
+		float r = std::min({ cfg.turnRadius, 0.5f * ab, 0.5f * cb });
+		glm::vec3 p0 = b + (a - b) * (r / ab), p1 = b + (c - b) * (r / cb);
+
+		glm::vec3 arc[CORNER_STEPS + 1];
+		bool clear = true;
+		for (int s = 0; s <= CORNER_STEPS; s++) {
+			float t = float(s) / CORNER_STEPS;
+			arc[s] = (1.0f - t) * (1.0f - t) * p0 + 2.0f * (1.0f - t) * t * b + t * t * p1;
+			if (s > 0 && !grid.segmentClear(arc[s - 1], arc[s], cfg.clearance)) clear = false;
+		}
+		if (clear) path.insert(path.end(), arc, arc + CORNER_STEPS + 1);
+		else path.push_back(b);
+	}
+	path.push_back(corridor.back());
+}
@@ -0,0 +1,135 @@
+#ifndef NAVGRID_H
+#define NAVGRID_H
+
+#include "aabb.h"
+#include "mappedfile.h"
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+
+// Free airspace over the map as a voxel grid: per cell the distance to the
+// nearest obstacle, in whole cells and capped at MAX_CLEARANCE, packed in four
+// bits. The lowest layer is the ground. Layers above the last one that sees an
+// obstacle within the cap are not stored at all. Every BLOCK^3 cells also have
+// their smallest clearance, the coarse level of the planner. Baked offline from
+// obstacle boxes and memory-mapped, like the height field.
+class NavGrid {
+public:
+	static const int MAX_CLEARANCE = 15; // cells
+	static const int BLOCK = 4;          // cells per coarse block along each axis
+
+	// Voxelizes the boxes between boundsMin and boundsMax (boundsMin.y is the
+	// ground) and writes the result to path. Coarser than cellSize if the
+	// volume would need too many cells.
+	static bool bake(const std::string& path, const std::vector<AABB>& obstacles,
+		glm::vec3 boundsMin, glm::vec3 boundsMax, uint64_t sourceHash, float cellSize = 4.0f);
+
+	static uint64_t hashObstacles(const std::vector<AABB>& obstacles, glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+	// Maps a baked file; false if missing, damaged or baked from another source
+	bool load(const std::string& path, uint64_t sourceHash);
+	bool loaded() const { return header != nullptr; }
+
+	// Metres of free space around p (conservative by half a cell); 0 in an
+	// obstacle or outside the grid
+	float clearance(glm::vec3 p) const;
+	// Samples every half cell between a and b
+	bool segmentClear(glm::vec3 a, glm::vec3 b, float minClearance) const;
+
+	float cellSize() const { return header ? header->cellSize : 0.0f; }
+	glm::ivec3 cells() const;
+	size_t fileBytes() const { return file.size(); }
+
+private:
+	friend class NavPlanner;
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t width, height, depth; // cells along X, Y and Z
+		uint32_t storedLayers;         // layers in the file, the rest are fully clear
+		float originX, originY, originZ;
+		float cellSize;
+		uint32_t blocksX, blocksY, blocksZ;
+		uint32_t reserved;
+		uint64_t sourceHash;
+	};
+	// followed by uint8_t clearance[(width * depth * storedLayers + 1) / 2], two
+	// cells per byte (low nibble first), X fastest, then Z, then Y; then
+	// uint8_t blockClearance[blocksX * blocksZ * blocksY] in the same order
+
+	static const uint32_t VERSION = 1;
+
+	int cellClearance(int ix, int iy, int iz) const; // in cells, 0 blocked or outside
+	int blockClearance(int bx, int by, int bz) const;
+	glm::vec3 blockCentre(int bx, int by, int bz) const;
+
+	MappedFile file;
+	const Header* header = nullptr;
+	const uint8_t* packed = nullptr;
+	const uint8_t* blocks = nullptr;
+	float invCell = 1.0f;
+};
+
+inline int NavGrid::cellClearance(int ix, int iy, int iz) const {
+	const Header& h = *header;
+	if (ix < 0 || iy < 0 || iz < 0 || ix >= (int)h.width || iy >= (int)h.height || iz >= (int)h.depth) return 0;
+	if (iy >= (int)h.storedLayers) return MAX_CLEARANCE;
+	size_t i = (size_t(iy) * h.depth + iz) * h.width + ix;
+	return (packed[i >> 1] >> ((i & 1) * 4)) & 15;
+}
+
+inline float NavGrid::clearance(glm::vec3 p) const {
+	int ix = (int)std::floor((p.x - header->originX) * invCell);
+	int iy = (int)std::floor((p.y - header->originY) * invCell);
+	int iz = (int)std::floor((p.z - header->originZ) * invCell);
+	int c = cellClearance(ix, iy, iz);
+	return c > 0 ? (c - 0.5f) * header->cellSize : 0.0f;
+}
+
+// Hierarchical path search over a NavGrid: A* over the coarse blocks that keep
+// the whole clearance, then string pulling against the fine cells and rounded
+// corners. Keeps its search buffers between queries, so use one per thread.
+class NavPlanner {
+public:
+	struct Config {
+		float clearance = 8.0f;   // m from any obstacle
+		float turnRadius = 30.0f; // m, corners are rounded up to this
+	};
+
+	// Path from `from` to `to`, both included; between blocks it climbs or sinks
+	// at most 45 degrees. False if either end lacks the clearance or they are
+	// not connected.
+	bool findPath(const NavGrid& grid, glm::vec3 from, glm::vec3 to, const Config& cfg, std::vector<glm::vec3>& path);
+
+	size_t lastExpanded() const { return expanded; } // coarse blocks, last query
+
+private:
+	template <typename Fn>
+	void forEachMove(const NavGrid& grid, int block, int needed, Fn&& fn) const;
+	void labelComponents(const NavGrid& grid, int needed);
+	bool search(const NavGrid& grid, int start, int goal, int needed);
+	int entryBlock(const NavGrid& grid, glm::vec3 p, int needed, float clearance) const;
+	void smooth(const NavGrid& grid, const Config& cfg, std::vector<glm::vec3>& path);
+
+	struct Open {
+		float f;
+		int block;
+		bool operator<(const Open& o) const { return f > o.f; } // min-heap
+	};
+
+	std::vector<float> g;
+	std::vector<int32_t> parent;
+	std::vector<uint32_t> seen, closed; // == generation: touched / expanded in this query
+	std::vector<Open> open;
+	std::vector<glm::vec3> corridor;
+	std::vector<int32_t> component; // per block, -1 without the clearance
+	const NavGrid* componentGrid = nullptr;
+	int componentNeeded = -1;
+	uint32_t generation = 0;
+	size_t expanded = 0;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "scenario.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+struct KeyName {
+	const char* name;
+	int key;
+};
+
+const KeyName KEY_NAMES[] = {
+	{ "W", SIM_KEY_W }, { "S", SIM_KEY_S },
+	{ "LEFT", SIM_KEY_LEFT }, { "RIGHT", SIM_KEY_RIGHT },
+	{ "UP", SIM_KEY_UP }, { "DOWN", SIM_KEY_DOWN },
+};
+
+// Text without the comment, false for blank lines
+bool stripComment(std::string& line) {
+	size_t hash = line.find('#');
+	if (hash != std::string::npos) line.erase(hash);
+	return line.find_first_not_of(" \t\r") != std::string::npos;
+}
+
+}
+
+bool loadScenario(const std::string& path, Scenario& out) {
+	std::ifstream in(path);
+	if (!in) return false;
+
+	std::string line;
+	int lineNo = 0;
+	while (std::getline(in, line)) {
+		lineNo++;
+		if (!stripComment(line)) continue;
+
+		std::istringstream ls(line);
+		std::string name;
+		ls >> name;
+		if (name == "city") ls >> out.cityObj;
+		else if (name == "ai") ls >> out.aiAircraft;
+		else if (name == "seconds") ls >> out.seconds;
+		else if (name == "script") ls >> out.script;
+		else if (name == "start") {
+			ls >> out.start.x >> out.start.y >> out.start.z;
+			out.customStart = true;
+		}
+		else if (name == "yaw") ls >> out.yawDeg;
+		else if (name == "speed") ls >> out.speed;
+		else if (name == "throttle") ls >> out.throttle;
+		else if (name == "airborne") ls >> out.airborne;
+		else {
+			std::cerr << path << ":" << lineNo << ": unknown setting " << name << "\n";
+			return false;
+		}
+		if (ls.fail()) {
+			std::cerr << path << ":" << lineNo << ": bad value for " << name << "\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool loadInputScript(const std::string& path, std::vector<ScriptedInput>& out) {
+	std::ifstream in(path);
+	if (!in) return false;
+
+	out.clear();
+	std::string line;
+	int lineNo = 0;
+	while (std::getline(in, line)) {
+		lineNo++;
+		if (!stripComment(line)) continue;
+
+		std::istringstream ls(line);
+		float seconds;
+		std::string action, keyName;
+		ls >> seconds >> action >> keyName;
+
+		const KeyName* key = std::find_if(std::begin(KEY_NAMES), std::end(KEY_NAMES),
+			[&](const KeyName& k) { return keyName == k.name; });
+		if (ls.fail() || seconds < 0.0f || (action != "press" && action != "release") || key == std::end(KEY_NAMES)) {
+			std::cerr << path << ":" << lineNo << ": expected \"<seconds> press|release <key>\"\n";
+			return false;
+		}
+
+		// Same rounding for every run, so a script always hits the same ticks
+		uint64_t tick = (uint64_t)std::llround(seconds / SIM_DT);
+		out.push_back({ tick, { key->key, action == "press" ? SIM_PRESS : SIM_RELEASE } });
+	}
+
+	std::stable_sort(out.begin(), out.end(),
+		[](const ScriptedInput& a, const ScriptedInput& b) { return a.tick < b.tick; });
+	return true;
+}
+
+void applyScenarioStart(const Scenario& s) {
+	if (!s.customStart) return;
+
+	Aircraft& player = aircraft[0];
+	player.airplane.pos = s.start;
+	player.airplane.attitude = attitudeFromEuler(glm::radians(s.yawDeg), 0.0f, 0.0f);
+	player.airplane.speed = s.speed;
+	player.throttle = player.targetThrottle = s.throttle;
+	player.onGround = !s.airborne;
+}
@@ -0,0 +1,40 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "simulation.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Setup of a headless run, a text file of "name value" lines (# starts a comment):
+//   city City.obj      ai 100        seconds 60      script takeoff.txt
+//   start <x> <y> <z>  yaw <deg>     speed <m/s>     throttle <0..1>     airborne 1
+// Without `start` the player waits on the runway like in the simulator.
+struct Scenario {
+	std::string cityObj = "City.obj";
+	int aiAircraft = 0;
+	float seconds = 60.0f;
+	std::string script; // input script, relative to the working directory
+
+	bool customStart = false;
+	glm::vec3 start = glm::vec3(0.0f);
+	float yawDeg = 180.0f;
+	float speed = 0.0f;
+	float throttle = 0.0f;
+	bool airborne = false;
+};
+
+// One line of an input script: "<seconds> press|release <W|S|LEFT|RIGHT|UP|DOWN>"
+struct ScriptedInput {
+	uint64_t tick;
+	InputEvent event;
+};
+
+bool loadScenario(const std::string& path, Scenario& out);
+bool loadInputScript(const std::string& path, std::vector<ScriptedInput>& out); // sorted by tick
+
+// Overrides the player set up by initWorld() with the scenario start
+void applyScenarioStart(const Scenario& s);
+
+#endif
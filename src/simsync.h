@@ -0,0 +1,74 @@
+#ifndef SIMSYNC_H
+#define SIMSYNC_H
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free triple buffer: one thread writes successive state snapshots,
+// the other always reads the newest complete one. Neither side ever waits.
+template <typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() : shared(1), writeIndex(0), readIndex(2) {}
+
+	// Buffer the writer fills with the next snapshot
+	T& writeBuffer() { return buffers[writeIndex]; }
+
+	// Hands the finished snapshot to the reader and takes the spare buffer
+	void publish() {
+		unsigned prev = shared.exchange(writeIndex | DIRTY_BIT, std::memory_order_acq_rel);
+		writeIndex = prev & INDEX_MASK;
+	}
+
+	// Switches the reader to the newest snapshot; false if nothing new arrived
+	bool update() {
+		if (!(shared.load(std::memory_order_relaxed) & DIRTY_BIT)) return false;
+		unsigned prev = shared.exchange(readIndex, std::memory_order_acq_rel);
+		readIndex = prev & INDEX_MASK;
+		return true;
+	}
+
+	const T& read() const { return buffers[readIndex]; }
+
+private:
+	static const unsigned INDEX_MASK = 3u;
+	static const unsigned DIRTY_BIT = 4u;
+
+	T buffers[3];
+	std::atomic<unsigned> shared; // index of the middle buffer + new-snapshot bit
+	unsigned writeIndex;          // owned by the writer only
+	unsigned readIndex;           // owned by the reader only
+};
+
+// Single-producer / single-consumer ring queue with a fixed power-of-two capacity.
+template <typename T, size_t Capacity>
+class SpscQueue {
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+public:
+	SpscQueue() : head(0), tail(0) {}
+
+	// Producer side only; false when the queue is full
+	bool push(const T& item) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+		items[t & (Capacity - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side only; false when the queue is empty
+	bool pop(T& out) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) return false;
+		out = items[h & (Capacity - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T items[Capacity];
+	alignas(64) std::atomic<size_t> head; // separate cache lines for both sides
+	alignas(64) std::atomic<size_t> tail;
+};
+
+#endif
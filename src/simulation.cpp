@@ -0,0 +1,1339 @@
+#define TINYOBJLOADER_IMPLEMENTATION
+
+#include "simulation.h"
+#include "bvh.h"
+#include "uniformgrid.h"
+#include "meshbvh.h"
+#include "aabbsoa.h"
+#include "collisionproxy.h"
+#include "flightsoa.h"
+#include "aero.h"
+#include "jobs.h"
+#include "assetmemory.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+
+std::vector<AABB> cityBuildings;
+Bvh cityBuildingsBvh;
+UniformGrid cityBuildingsGrid;
+
+std::vector<Aircraft> aircraft(1);
+int aiAircraftCount = 0; // --ai
+
+// Per-tick cost of updatePhysics over all aircraft
+float simTickMs = 0.0f;
+float simTickMaxMs = 0.0f;
+int simReportSteps = 0;
+bool simTickReport = true;
+
+const float yawAccel = glm::radians(180.0f);
+
+const float rollAccel = glm::radians(60.0f);
+
+const float GRAVITY = 9.81f;
+
+// Takeoff, stall and top speeds come with the aircraft type
+AircraftType jetType;
+const char* AIRCRAFT_TYPE_FILE = "jet.aero"; // baked from the built-in model if missing
+
+const float LANDING_ASSIST_DURATION = 2.0f;
+const float SAFE_LANDING_SPEED = 10.0f;
+const float LANDING_PITCH_THRESHOLD = glm::radians(25.0f);
+
+AABB airportAABB;
+glm::vec3 airportCenter;
+std::vector<AABB> airportRunwayAABBs;
+std::vector<AABB> airportObstacles;
+Bvh airportObstaclesBvh;
+Bvh airportObstacleCoresBvh; // obstacles shrunk by the 1 m core margin of the point test
+UniformGrid airportObstaclesGrid;
+UniformGrid airportRunwayGrid;
+AabbSoA airportRunwaySoA;
+
+// Triangle narrow phase behind the box tests (City.obj in world, Airport.obj in airport-local coords)
+MeshBvh cityMesh;
+MeshBvh airportMesh;
+
+// Everything above bundled for the stateless (and batched) collision queries
+CollisionWorld collisionWorld;
+
+// Aircraft collision volume: capsules fitted to jetanima.obj, placed like the drawn model
+AircraftProxy jetProxy;
+thread_local std::vector<Capsule> jetCapsules; // world space, refreshed every step; per thread for stepIsolated
+const float PROXY_BUDGET_US = 50.0f; // per-step cost target for proxyCollision
+float proxyCostUs = 0.0f;    // smoothed cost of one test
+float proxyCostMaxUs = 0.0f; // worst test since the last report
+int proxyReportSteps = 0;
+glm::vec3 airportDrawOffset(-186.0f, 0.1f, 67.0f);
+float airportGroundLevel = airportAABB.min.y + airportDrawOffset.y;
+const float AIRPORT_SAFE_RADIUS = 30.0f;
+const float STALL_NOSEDOWN = glm::radians(55.0f);
+const float STALL_BLEND_SPEED = 2.5f;
+const float MAX_PATH_PITCH = glm::radians(85.0f);
+
+// Baked top surface of City.obj + Airport.obj, rebuilt when the meshes change
+HeightField terrain;
+const char* TERRAIN_FILE = "terrain.hgt"; // next to the OBJ files
+
+NavGrid navGrid;
+const char* NAV_FILE = "city.nav"; // next to the OBJ files
+
+float MIN_X = -10.0f, MAX_X = 10.0f;
+float MIN_Z = -10.0f, MAX_Z = 10.0f;
+float MIN_Y = 1.0f, MAX_Y = 200.0f;
+
+std::string cityObjPath = "City.obj"; // --city
+
+void applyInputEvent(const InputEvent& ev) {
+	Aircraft& a = aircraft[0];
+	const int key = ev.key;
+	const int action = ev.action;
+	constexpr float ANG_V = glm::radians(20.0f); // angular speed in radians/sec
+	constexpr float ANG_H = glm::radians(60.0f); // angular speed in radians/sec
+
+	if (action == SIM_PRESS) {
+		if (a.airplane.speed > 0.1) {
+			if (key == SIM_KEY_LEFT)   a.targetYawRate = ANG_H;  // bank left
+			if (key == SIM_KEY_RIGHT)  a.targetYawRate = -ANG_H;  // bank right
+		}
+
+		if (a.airplane.speed >= a.type->params().minTakeoffSpeed) {
+			if (!a.onGround) {
+				if (key == SIM_KEY_UP)     a.pitchRate = ANG_V;
+			}
+			if (key == SIM_KEY_DOWN)   a.pitchRate = -ANG_V;
+		}
+	}
+	else if (action == SIM_RELEASE) {
+		if (key == SIM_KEY_LEFT || key == SIM_KEY_RIGHT) a.targetYawRate = 0.0f;
+		if (key == SIM_KEY_DOWN || key == SIM_KEY_UP)    a.pitchRate = 0.0f;
+	}
+
+	if (key == SIM_KEY_W) {
+		if (action == SIM_PRESS)
+			a.throttleUpPressed = true;
+		else if (action == SIM_RELEASE)
+			a.throttleUpPressed = false;
+	}
+	if (key == SIM_KEY_S) {
+		if (action == SIM_PRESS)
+			a.throttleDownPressed = true;
+		else if (action == SIM_RELEASE)
+			a.throttleDownPressed = false;
+	}
+}
+
+bool isOverAirport(const glm::vec3& posWorld) {
+	return collisionWorld.overAirport(posWorld);
+}
+
+bool isOnRunway(const glm::vec3& posWorld) {
+	return collisionWorld.onRunway(posWorld);
+}
+
+bool checkCollision(const glm::vec3& posWorld, bool onGround) {
+	return collisionWorld.pointHit(posWorld, onGround);
+}
+
+// Height of the surface under p (runway, grass or roof)
+float groundHeightAt(const glm::vec3& posWorld) {
+	if (!terrain.loaded()) return airportGroundLevel;
+	return terrain.height(posWorld.x, posWorld.z);
+}
+
+RunwayInfo mainRunway() {
+	const AABB& rw = airportRunwayAABBs[0];
+	glm::vec3 o = airportCenter + airportDrawOffset;
+	return { o.x + (rw.min.x + rw.max.x) * 0.5f, o.z + rw.min.z, o.z + rw.max.z, o.y + rw.max.y };
+}
+
+// ----- AI traffic -----
+// Each AI aircraft cruises over the city through a few random waypoints, flies
+// a pattern to the first runway and lands towards -z like the landing sweep,
+// backtracks along the runway and takes off from its +z end like the player.
+const float AI_MIN_ALT = 60.0f, AI_MAX_ALT = 150.0f;
+const float AI_PATTERN_HEIGHT = 25.0f;   // above the runway, downwind leg
+const float AI_FIX_HEIGHT = 15.0f;       // above the runway, start of the final
+const float AI_FINAL_LENGTH = 150.0f;    // fix to threshold, m, shortened by the map edge
+const float AI_TOUCHDOWN_PAST = 40.0f;   // aim point past the threshold, m
+const float AI_TAXI_SPEED = 4.0f;        // m/s
+const float AI_CLIMB_OUT_HEIGHT = 40.0f; // cruise resumes above this
+const float AI_ROUTE_CLEARANCE = 10.0f;  // m from buildings on cruise routes
+
+float aiRandom(Aircraft& a, float lo, float hi) {
+	a.rng = a.rng * 1664525u + 1013904223u;
+	return lo + (hi - lo) * float(a.rng >> 8) * (1.0f / 16777216.0f);
+}
+
+// Route around the buildings; where the planner finds none the aircraft flies straight
+void pickAiWaypoint(Aircraft& a) {
+	a.waypoint = glm::vec3(aiRandom(a, MIN_X, MAX_X), aiRandom(a, AI_MIN_ALT, AI_MAX_ALT), aiRandom(a, MIN_Z, MAX_Z));
+	a.routeNext = 0;
+	a.route.clear();
+	if (!navGrid.loaded()) return;
+
+	thread_local NavPlanner planner;
+	NavPlanner::Config cfg;
+	cfg.clearance = AI_ROUTE_CLEARANCE;
+	if (!planner.findPath(navGrid, a.airplane.pos, a.waypoint, cfg, a.route)) a.route.clear();
+}
+
+void startAiCruise(Aircraft& a, int legs) {
+	a.aiPhase = AI_CRUISE;
+	a.aiLegs = legs;
+	pickAiWaypoint(a);
+}
+
+// Airborne somewhere over the map, cruising towards a random waypoint
+void spawnAiAircraft(Aircraft& a) {
+	uint32_t rng = a.rng;
+	const AircraftType* type = a.type;
+	a = Aircraft();
+	a.ai = true;
+	a.rng = rng;
+	a.type = type;
+	a.airplane.pos = glm::vec3(aiRandom(a, MIN_X, MAX_X), aiRandom(a, AI_MIN_ALT, AI_MAX_ALT), aiRandom(a, MIN_Z, MAX_Z));
+	a.airplane.attitude = attitudeFromEuler(aiRandom(a, -glm::pi<float>(), glm::pi<float>()), 0.0f, 0.0f);
+	a.throttle = a.targetThrottle = 0.8f;
+	a.airplane.speed = a.type->params().cruiseSpeed;
+	a.onGround = false;
+	startAiCruise(a, 1 + int(aiRandom(a, 0.0f, 3.0f)));
+}
+
+// Yaw rate that turns the nose to a heading; err is what is left of the turn
+float aiSteerHeading(const Aircraft& a, float heading, float& err) {
+	const float ANG_H = glm::radians(60.0f);
+	err = std::remainder(heading - attitudeYaw(a.airplane.attitude), 2.0f * glm::pi<float>());
+	return glm::clamp(err * 1.5f, -ANG_H, ANG_H);
+}
+
+// Yaw rate that turns the nose towards p
+float aiSteerTowards(const Aircraft& a, const glm::vec3& p) {
+	glm::vec3 to = p - a.airplane.pos;
+	float err;
+	return aiSteerHeading(a, std::atan2(to.x, to.z), err);
+}
+
+// Pitch rate that brings the nose to wantedPitch; nose up is negative pitch
+float aiPitchTowards(const Aircraft& a, float wantedPitch) {
+	const float ANG_V = glm::radians(20.0f);
+	return glm::clamp((wantedPitch - attitudePitch(a.airplane.attitude)) * 2.0f, -ANG_V, ANG_V);
+}
+
+// Pitch rate that brings the climb rate to wantedVs
+float aiHoldClimbRate(const Aircraft& a, float wantedVs, float maxPitch) {
+	float pitch = attitudePitch(a.airplane.attitude);
+	return aiPitchTowards(a, glm::clamp(pitch - (wantedVs - a.verticalSpeed) * 0.08f, -maxPitch, maxPitch));
+}
+
+// Downwind over the runway, a turn at the fix, then the centre line and glide path
+void flyAiApproach(Aircraft& a, const RunwayInfo& rw) {
+	const glm::vec3& p = a.airplane.pos;
+	float finalLength = glm::min(AI_FINAL_LENGTH, (MAX_Z - 10.0f) - rw.maxZ);
+	float touchZ = rw.maxZ - AI_TOUCHDOWN_PAST;
+	glm::vec3 fix(rw.centreX, rw.groundY + AI_FIX_HEIGHT, rw.maxZ + finalLength);
+	glm::vec3 downwind(rw.centreX, rw.groundY + AI_PATTERN_HEIGHT, (rw.minZ + rw.maxZ) * 0.5f);
+
+	if (a.aiApproachLeg < 2) {
+		const glm::vec3& target = a.aiApproachLeg == 0 ? downwind : fix;
+		a.targetYawRate = aiSteerTowards(a, target);
+		// Descends to the pattern only near the airport, clear of the city
+		float distance = glm::length(glm::vec2(target.x - p.x, target.z - p.z));
+		float wantedVs = distance > 150.0f && p.y > target.y ? 0.0f : glm::clamp((target.y - p.y) * 0.3f, -3.0f, 3.0f);
+		a.pitchRate = aiHoldClimbRate(a, wantedVs, glm::radians(20.0f));
+		a.targetThrottle = 0.6f;
+		if (distance < 30.0f) a.aiApproachLeg++;
+		return;
+	}
+
+	// Past the touchdown zone or off the centre line over the runway: go around
+	if (p.z < touchZ - 100.0f || (p.z < rw.maxZ && std::fabs(p.x - rw.centreX) > 15.0f)) {
+		startAiCruise(a, 1);
+		return;
+	}
+
+	a.targetYawRate = aiSteerTowards(a, glm::vec3(rw.centreX, p.y, p.z - 40.0f));
+	float slope = (AI_FIX_HEIGHT - 2.0f) / (fix.z - touchZ);
+	float height = p.y - rw.groundY;
+	float wanted = 2.0f + glm::max(0.0f, p.z - touchZ) * slope;
+	float wantedVs = -a.airplane.speed * slope + (wanted - height) * 0.5f;
+	if (height < 4.0f) wantedVs = -0.4f; // flare
+	a.pitchRate = aiHoldClimbRate(a, glm::clamp(wantedVs, -3.0f, 1.0f), glm::radians(15.0f));
+
+	float approachSpeed = glm::max(a.type->params().stallSpeed * 1.4f, 10.0f);
+	a.targetThrottle = glm::clamp(0.4f + (approachSpeed - a.airplane.speed) * 0.2f, 0.0f, 1.0f);
+}
+
+// Steers with the same inputs the player has
+void updateAiPilot(Aircraft& a) {
+	if (a.explosionActive) return;
+	const float ANG_V = glm::radians(20.0f);
+	const RunwayInfo rw = mainRunway();
+	const glm::vec3& p = a.airplane.pos;
+	float err;
+
+	switch (a.aiPhase) {
+	case AI_CRUISE: {
+		// Yaw rate towards the next route point, pitch rate to hold its altitude
+		glm::vec3 to = a.waypoint - p;
+		if (glm::length(glm::vec2(to.x, to.z)) < 60.0f) {
+			if (--a.aiLegs <= 0) {
+				a.aiPhase = AI_APPROACH;
+				a.aiApproachLeg = 0;
+				break;
+			}
+			pickAiWaypoint(a);
+		}
+		while (a.routeNext < a.route.size() &&
+			glm::length(glm::vec2(a.route[a.routeNext].x - p.x, a.route[a.routeNext].z - p.z)) < 25.0f) {
+			a.routeNext++;
+		}
+		glm::vec3 target = a.routeNext < a.route.size() ? a.route[a.routeNext] : a.waypoint;
+		to = target - p;
+		a.targetYawRate = aiSteerTowards(a, target);
+		a.pitchRate = aiPitchTowards(a, glm::clamp(-to.y * 0.02f, glm::radians(-20.0f), glm::radians(20.0f)));
+		a.targetThrottle = 0.8f;
+		break;
+	}
+	case AI_APPROACH:
+		if (a.onGround) {
+			a.aiPhase = AI_ROLLOUT;
+			break;
+		}
+		flyAiApproach(a, rw);
+		break;
+	case AI_ROLLOUT:
+		// Brakes (closed throttle) along the centre line until stopped
+		a.targetThrottle = 0.0f;
+		a.pitchRate = 0.0f;
+		a.targetYawRate = aiSteerTowards(a, glm::vec3(rw.centreX, p.y, p.z - 40.0f));
+		if (a.airplane.speed < 0.1f) a.aiPhase = AI_BACKTRACK;
+		break;
+	case AI_BACKTRACK:
+		// Turn round on the spot, then taxi back up the runway
+		if (p.z > rw.maxZ - 30.0f) {
+			a.targetThrottle = 0.0f;
+			a.targetYawRate = aiSteerHeading(a, glm::pi<float>(), err);
+			if (a.airplane.speed < 0.1f && std::fabs(err) < glm::radians(3.0f)) a.aiPhase = AI_TAKEOFF;
+			break;
+		}
+		a.targetYawRate = aiSteerHeading(a, 0.0f, err);
+		if (std::fabs(err) > glm::radians(10.0f)) {
+			a.targetThrottle = 0.0f;
+			break;
+		}
+		a.targetYawRate = aiSteerTowards(a, glm::vec3(rw.centreX, p.y, p.z + 30.0f));
+		a.targetThrottle = glm::clamp((AI_TAXI_SPEED - a.airplane.speed) * 0.3f, 0.0f, 0.3f);
+		break;
+	case AI_TAKEOFF:
+		a.targetThrottle = 1.0f;
+		if (a.onGround) {
+			a.targetYawRate = aiSteerTowards(a, glm::vec3(rw.centreX, p.y, p.z - 60.0f));
+			a.pitchRate = a.airplane.speed >= a.type->params().minTakeoffSpeed + 1.0f ? -ANG_V * 0.5f : 0.0f;
+		}
+		else {
+			a.targetYawRate = aiSteerHeading(a, glm::pi<float>(), err);
+			a.pitchRate = aiHoldClimbRate(a, 2.0f, glm::radians(15.0f));
+			if (p.y - groundHeightAt(p) > AI_CLIMB_OUT_HEIGHT) startAiCruise(a, 2 + int(aiRandom(a, 0.0f, 4.0f)));
+		}
+		break;
+	}
+}
+
+std::vector<std::vector<float>> vertsPerMatJet, normsPerMatJet, uvsPerMatJet;
+std::vector<int> countsPerMatJet;
+std::vector<tinyobj::material_t> materialsJet;
+
+std::vector<std::vector<float>> vertsPerMatCity, normsPerMatCity, uvsPerMatCity;
+std::vector<int> countsPerMatCity;
+std::vector<tinyobj::material_t> materialsCity;
+
+std::vector<std::vector<float>> vertsPerMatAirport, normsPerMatAirport, uvsPerMatAirport;
+std::vector<int> countsPerMatAirport;
+std::vector<tinyobj::material_t> materialsAirport;
+
+bool loadModel(
+	const std::string& objFile,
+	std::vector<std::vector<float>>& vertsPerMat,
+	std::vector<std::vector<float>>& normsPerMat,
+	std::vector<std::vector<float>>& uvsPerMat,
+	std::vector<int>& countsPerMat,
+	std::vector<tinyobj::material_t>& materials,
+	AABB* outAABB
+) {
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::string warn, err;
+
+	bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, objFile.c_str(), ".");
+	if (!warn.empty()) std::cerr << "WARN: " << warn << "\n";
+	if (!err.empty()) std::cerr << "ERR : " << err << "\n";
+	if (!ret) return false;
+
+	std::cout << "Loaded " << shapes.size() << " shapes from " << objFile << std::endl;
+
+	int M = (int)materials.size();
+	vertsPerMat.assign(M, {});
+	normsPerMat.assign(M, {});
+	uvsPerMat.assign(M, {});
+	countsPerMat.assign(M, 0);
+
+	for (auto& shape : shapes) {
+		size_t index_offset = 0;
+		for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+			int fv = shape.mesh.num_face_vertices[f];
+			int matID = shape.mesh.material_ids[f];
+			if (matID < 0 || matID >= M) matID = 0;
+
+			for (int v = 0; v < fv; v++) {
+				auto idx = shape.mesh.indices[index_offset + v];
+
+				vertsPerMat[matID].push_back(attrib.vertices[3 * idx.vertex_index + 0]);
+				vertsPerMat[matID].push_back(attrib.vertices[3 * idx.vertex_index + 1]);
+				vertsPerMat[matID].push_back(attrib.vertices[3 * idx.vertex_index + 2]);
+				vertsPerMat[matID].push_back(1.0f);
+
+				if (idx.normal_index >= 0) {
+					normsPerMat[matID].push_back(attrib.normals[3 * idx.normal_index + 0]);
+					normsPerMat[matID].push_back(attrib.normals[3 * idx.normal_index + 1]);
+					normsPerMat[matID].push_back(attrib.normals[3 * idx.normal_index + 2]);
+					normsPerMat[matID].push_back(0.0f);
+				}
+				else {
+					normsPerMat[matID].insert(normsPerMat[matID].end(), { 0,1,0,0 });
+				}
+
+				if (idx.texcoord_index >= 0) {
+					uvsPerMat[matID].push_back(attrib.texcoords[2 * idx.texcoord_index + 0]);
+					uvsPerMat[matID].push_back(attrib.texcoords[2 * idx.texcoord_index + 1]);
+				}
+				else {
+					uvsPerMat[matID].insert(uvsPerMat[matID].end(), { 0,0 });
+				}
+				countsPerMat[matID] += 1;
+			}
+			index_offset += fv;
+		}
+	}
+
+	glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+	for (auto& shape : shapes) {
+		size_t index_offset = 0;
+		int matID = -1;
+		if (!shape.mesh.material_ids.empty())
+			matID = shape.mesh.material_ids[0];
+		std::string matName = (matID >= 0 && matID < materials.size()) ? materials[matID].name : "";
+
+		glm::vec3 shapeMin(FLT_MAX), shapeMax(-FLT_MAX);
+		for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+			int fv = shape.mesh.num_face_vertices[f];
+			for (int v = 0; v < fv; v++) {
+				auto idx = shape.mesh.indices[index_offset + v];
+				glm::vec3 vtx(
+					attrib.vertices[3 * idx.vertex_index + 0],
+					attrib.vertices[3 * idx.vertex_index + 1],
+					attrib.vertices[3 * idx.vertex_index + 2]
+				);
+				shapeMin = glm::min(shapeMin, vtx);
+				shapeMax = glm::max(shapeMax, vtx);
+				min = glm::min(min, vtx);
+				max = glm::max(max, vtx);
+			}
+			index_offset += fv;
+		}
+
+		bool isRunway = false;
+		if (matName.find("Asphalt") != std::string::npos ||
+			matName.find("runway") != std::string::npos ||
+			matName.find("White") != std::string::npos ||
+			matName.find("Blue") != std::string::npos) {
+			isRunway = true;
+		}
+
+		if (isRunway)
+			airportRunwayAABBs.push_back({ shapeMin, shapeMax });
+		else
+			airportObstacles.push_back({ shapeMin, shapeMax });
+	}
+
+	if (outAABB) *outAABB = { min, max };
+	return true;
+}
+
+
+void spawnAiTraffic(int count) {
+	aircraft.resize(1 + std::max(0, count));
+	for (size_t i = 1; i < aircraft.size(); i++) {
+		aircraft[i].rng = 0x9e3779b9u * uint32_t(i);
+		spawnAiAircraft(aircraft[i]);
+	}
+}
+
+// Models, collision structures, terrain and aircraft: everything the simulation needs, no GL
+bool initWorld() {
+	jetType.loadOrBake(AIRCRAFT_TYPE_FILE);
+	const AircraftParams& jet = jetType.params();
+	std::cout << "Aircraft type " << AIRCRAFT_TYPE_FILE << ": stall " << jet.stallSpeed << " m/s, takeoff "
+		<< jet.minTakeoffSpeed << " m/s, limit " << jet.maxSpeed << " m/s\n";
+	assetMemoryAdd(AIRCRAFT_TYPE_FILE, (int64_t)jetType.fileBytes(), 0, 0);
+
+	if (!loadModel("jetanima.obj", vertsPerMatJet, normsPerMatJet, uvsPerMatJet, countsPerMatJet, materialsJet)) {
+		std::cerr << "Failed to load jetanima.obj\n";
+		return false;
+	}
+	if (!loadModel(cityObjPath, vertsPerMatCity, normsPerMatCity, uvsPerMatCity, countsPerMatCity, materialsCity)) {
+		std::cerr << "Failed to load " << cityObjPath << "\n";
+		return false;
+	}
+
+	tinyobj::attrib_t attribCity;
+	std::vector<tinyobj::shape_t> shapesCity;
+	std::vector<tinyobj::material_t> matsCity;
+	std::string warnCity, errCity;
+	bool ok = tinyobj::LoadObj(&attribCity, &shapesCity, &matsCity, &warnCity, &errCity, cityObjPath.c_str(), ".");
+	if (!ok) {
+		std::cerr << "WARN: cannot reload " << cityObjPath << " for AABB generation\n";
+	}
+	else {
+		for (auto& shape : shapesCity) {
+			glm::vec3 shapeMin(FLT_MAX), shapeMax(-FLT_MAX);
+			size_t index_offset = 0;
+			for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+				int fv = shape.mesh.num_face_vertices[f];
+				for (int v = 0; v < fv; v++) {
+					auto idx = shape.mesh.indices[index_offset + v];
+					glm::vec3 vtx(
+						attribCity.vertices[3 * idx.vertex_index + 0],
+						attribCity.vertices[3 * idx.vertex_index + 1],
+						attribCity.vertices[3 * idx.vertex_index + 2]
+					);
+					shapeMin = glm::min(shapeMin, vtx);
+					shapeMax = glm::max(shapeMax, vtx);
+				}
+				index_offset += fv;
+			}
+			cityBuildings.push_back({ shapeMin, shapeMax });
+		}
+	}
+
+
+	if (!loadModel("Airport.obj", vertsPerMatAirport, normsPerMatAirport, uvsPerMatAirport, countsPerMatAirport, materialsAirport, &airportAABB)) {
+		std::cerr << "Failed to load Airport.obj\n";
+		return false;
+	}
+
+	airportCenter = (airportAABB.min + airportAABB.max) * 0.5f;
+	airportGroundLevel = airportAABB.min.y;
+
+	airportRunwayAABBs.clear();
+	airportRunwayAABBs.push_back({
+		glm::vec3(-34.04f, -0.0062f, -188.0),
+		glm::vec3(3.0f, 0.00029f, 188.0f)
+		});
+
+	cityBuildingsBvh.build(cityBuildings);
+	airportObstaclesBvh.build(airportObstacles);
+
+	std::vector<AABB> obstacleCores;
+	for (const auto& box : airportObstacles) {
+		AABB core = { box.min + glm::vec3(1.0f), box.max - glm::vec3(1.0f) };
+		if (core.min.x < core.max.x && core.min.y < core.max.y && core.min.z < core.max.z)
+			obstacleCores.push_back(core);
+	}
+	airportObstacleCoresBvh.build(obstacleCores);
+
+	cityMesh.build(vertsPerMatCity);
+	jetProxy.build(vertsPerMatJet);
+	std::cout << "Jet collision proxy: " << jetProxy.modelCapsules().size() << " capsules\n";
+	airportMesh.build(vertsPerMatAirport);
+
+	// CPU side of the models: the per-material arrays the renderer draws or
+	// uploads, and the collision structures built from them
+	auto modelBytes = [](const std::vector<std::vector<float>>& verts, const std::vector<std::vector<float>>& norms,
+		const std::vector<std::vector<float>>& uvs) {
+		return perMaterialBytes(verts) + perMaterialBytes(norms) + perMaterialBytes(uvs);
+	};
+	assetMemoryAdd("jetanima.obj", modelBytes(vertsPerMatJet, normsPerMatJet, uvsPerMatJet), 0, 0);
+	assetMemoryAdd(cityObjPath, modelBytes(vertsPerMatCity, normsPerMatCity, uvsPerMatCity), 0, 0);
+	assetMemoryAdd("Airport.obj", modelBytes(vertsPerMatAirport, normsPerMatAirport, uvsPerMatAirport), 0, 0);
+	assetMemoryAdd(cityObjPath + " collision mesh", (int64_t)cityMesh.memoryBytes(), 0, 0);
+	assetMemoryAdd("Airport.obj collision mesh", (int64_t)airportMesh.memoryBytes(), 0, 0);
+	assetMemoryAdd("collision boxes", int64_t(cityBuildingsBvh.memoryBytes() + airportObstaclesBvh.memoryBytes()
+		+ airportObstacleCoresBvh.memoryBytes() + (cityBuildings.capacity() + airportObstacles.capacity()
+		+ airportRunwayAABBs.capacity()) * sizeof(AABB)), 0, 0);
+
+	Aircraft& player = aircraft[0];
+	player.airplane.pos = airportCenter + airportDrawOffset + glm::vec3(-31.23f, 3.0f, 185);
+	player.airplane.attitude = attitudeFromEuler(glm::radians(180.0f), 0.0f, 0.0f);
+	player.airplane.speed = 0.0f;
+	player.onGround = true;
+	player.throttle = 0.0f;
+	player.targetThrottle = 0.0f;
+
+	glm::vec2 cityMin(FLT_MAX, FLT_MAX);
+	glm::vec2 cityMax(-FLT_MAX, -FLT_MAX);
+
+	for (const auto& matVerts : vertsPerMatCity) {
+		// matVerts is a flat [x,y,z,1, x,y,z,1, …]
+		for (size_t i = 0; i + 3 < matVerts.size(); i += 4) {
+			float x = matVerts[i];
+			float z = matVerts[i + 2];
+			cityMin.x = glm::min(cityMin.x, x);
+			cityMax.x = glm::max(cityMax.x, x);
+			cityMin.y = glm::min(cityMin.y, z);
+			cityMax.y = glm::max(cityMax.y, z);
+		}
+	}
+
+	// store these in globals
+	MIN_X = cityMin.x;
+	MAX_X = cityMax.x;
+	MIN_Z = cityMin.y;
+	MAX_Z = cityMax.y;
+
+	// Broadphase grids for the point tests, built once from the bounds above
+	cityBuildingsGrid.build(cityBuildings, glm::vec2(MIN_X, MIN_Z), glm::vec2(MAX_X, MAX_Z));
+	airportObstaclesGrid.build(airportObstacles,
+		glm::vec2(airportAABB.min.x, airportAABB.min.z), glm::vec2(airportAABB.max.x, airportAABB.max.z));
+	AABB runwayBounds = airportRunwayAABBs[0];
+	for (const auto& box : airportRunwayAABBs) runwayBounds = aabbUnion(runwayBounds, box);
+	airportRunwayGrid.build(airportRunwayAABBs,
+		glm::vec2(runwayBounds.min.x, runwayBounds.min.z), glm::vec2(runwayBounds.max.x, runwayBounds.max.z));
+	for (size_t i = 0; i < airportRunwayAABBs.size(); i++) airportRunwaySoA.append(airportRunwayAABBs[i], (int32_t)i);
+	airportRunwaySoA.seal();
+	assetMemoryAdd("collision grids", int64_t(cityBuildingsGrid.memoryBytes() + airportObstaclesGrid.memoryBytes()
+		+ airportRunwayGrid.memoryBytes() + airportRunwaySoA.memoryBytes()), 0, 0);
+
+	collisionWorld.cityGrid = &cityBuildingsGrid;
+	collisionWorld.cityBvh = &cityBuildingsBvh;
+	collisionWorld.cityMesh = &cityMesh;
+	collisionWorld.airportGrid = &airportObstaclesGrid;
+	collisionWorld.airportBvh = &airportObstaclesBvh;
+	collisionWorld.airportCoresBvh = &airportObstacleCoresBvh;
+	collisionWorld.airportMesh = &airportMesh;
+	collisionWorld.runwayGrid = &airportRunwayGrid;
+	collisionWorld.airportOffset = airportDrawOffset;
+	collisionWorld.airportCenter = airportCenter;
+	collisionWorld.airportSafeRadius = AIRPORT_SAFE_RADIUS;
+
+	// Airspace for AI routes: buildings and airport obstacles up to the flight ceiling
+	std::vector<AABB> navObstacles = cityBuildings;
+	for (const auto& box : airportObstacles) navObstacles.push_back({ box.min + airportDrawOffset, box.max + airportDrawOffset });
+	glm::vec3 navMin(glm::min(MIN_X, airportAABB.min.x + airportDrawOffset.x), airportGroundLevel,
+		glm::min(MIN_Z, airportAABB.min.z + airportDrawOffset.z));
+	glm::vec3 navMax(glm::max(MAX_X, airportAABB.max.x + airportDrawOffset.x), MAX_Y,
+		glm::max(MAX_Z, airportAABB.max.z + airportDrawOffset.z));
+	uint64_t navHash = NavGrid::hashObstacles(navObstacles, navMin, navMax);
+	if (!navGrid.load(NAV_FILE, navHash)) {
+		std::cout << "Baking " << NAV_FILE << "..." << std::endl;
+		if (!NavGrid::bake(NAV_FILE, navObstacles, navMin, navMax, navHash) || !navGrid.load(NAV_FILE, navHash)) {
+			std::cerr << "WARN: no navigation grid, AI aircraft fly straight to their waypoints\n";
+		}
+	}
+	if (navGrid.loaded()) {
+		glm::ivec3 c = navGrid.cells();
+		std::cout << "Navigation grid: " << c.x << " x " << c.y << " x " << c.z << " cells of " << navGrid.cellSize()
+			<< " m, " << navGrid.fileBytes() / 1024 << " KB\n";
+		assetMemoryAdd(NAV_FILE, (int64_t)navGrid.fileBytes(), 0, 0); // mapped
+	}
+
+	// AI traffic needs the map bounds computed above
+	aircraft.resize(1);
+	spawnAiTraffic(aiAircraftCount);
+	if (aiAircraftCount > 0) std::cout << "AI traffic: " << aiAircraftCount << " aircraft\n";
+
+	// Ground raster: runway boxes are relative to the airport centre, the layer wants mesh coordinates
+	std::vector<AABB> runwayFootprints;
+	for (const auto& box : airportRunwayAABBs) runwayFootprints.push_back({ box.min + airportCenter, box.max + airportCenter });
+	std::vector<HeightFieldLayer> terrainLayers = {
+		{ &vertsPerMatCity, glm::vec3(0.0f), nullptr },
+		{ &vertsPerMatAirport, airportDrawOffset, &runwayFootprints },
+	};
+	uint64_t terrainHash = HeightField::hashLayers(terrainLayers);
+	if (!terrain.load(TERRAIN_FILE, terrainHash)) {
+		glm::vec2 lo(glm::min(MIN_X, airportAABB.min.x + airportDrawOffset.x), glm::min(MIN_Z, airportAABB.min.z + airportDrawOffset.z));
+		glm::vec2 hi(glm::max(MAX_X, airportAABB.max.x + airportDrawOffset.x), glm::max(MAX_Z, airportAABB.max.z + airportDrawOffset.z));
+		std::cout << "Baking " << TERRAIN_FILE << "..." << std::endl;
+		if (!HeightField::bake(TERRAIN_FILE, terrainLayers, lo, hi, airportGroundLevel, terrainHash) ||
+			!terrain.load(TERRAIN_FILE, terrainHash)) {
+			std::cerr << "WARN: no ground raster, using a flat ground level\n";
+		}
+	}
+	if (terrain.loaded()) {
+		std::cout << "Ground raster: " << terrain.width() << " x " << terrain.depth() << " samples\n";
+		assetMemoryAdd(TERRAIN_FILE, (int64_t)terrain.fileBytes(), 0, 0); // mapped
+	}
+	return true;
+}
+
+// Volume test for the whole airframe. Each capsule of the proxy is placed with
+// the model matrix of the drawn jet, then checked against the ground and, after
+// a BVH box query, against the same boxes and meshes as the point test.
+bool proxyCollisionTest(const Aircraft& a, glm::vec3& hitPoint) {
+	glm::mat4 M = glm::translate(glm::mat4(1.0f), a.airplane.pos) * glm::mat4_cast(a.airplane.attitude);
+	jetProxy.transform(M, jetCapsules);
+
+	bool overAirport = isOverAirport(a.airplane.pos);
+	glm::vec3 offset = overAirport ? airportDrawOffset : glm::vec3(0.0f);
+	const Bvh& boxes = overAirport ? airportObstacleCoresBvh : cityBuildingsBvh;
+	const MeshBvh& mesh = overAirport ? airportMesh : cityMesh;
+
+	for (const Capsule& c : jetCapsules) {
+		// Nose or wingtip axis below the ground: the skin is already a radius deep
+		if (c.a.y < groundHeightAt(c.a) || c.b.y < groundHeightAt(c.b)) {
+			hitPoint = c.a.y < c.b.y ? c.a : c.b;
+			return true;
+		}
+
+		Capsule local = { c.a - offset, c.b - offset, c.radius };
+		float hitT = 0.0f;
+		bool nearBox = boxes.anyOverlapping(capsuleBounds(local), [&](const AABB& box, int) {
+			return segmentAabbDistSq(local.a, local.b, box, &hitT) < local.radius * local.radius;
+		});
+		if (!nearBox) continue;
+
+		// Shapes are not boxes: the capsule has to reach a triangle of the mesh
+		if (mesh.empty()) {
+			hitPoint = glm::mix(c.a, c.b, hitT);
+			return true;
+		}
+		glm::vec3 contact;
+		if (mesh.capsuleHit(local.a, local.b, local.radius, contact)) {
+			hitPoint = contact + offset;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool proxyCollision(const Aircraft& a, glm::vec3& hitPoint) {
+	auto start = std::chrono::steady_clock::now();
+	bool hit = proxyCollisionTest(a, hitPoint);
+	float us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+	proxyCostUs = proxyCostUs * 0.99f + us * 0.01f;
+	proxyCostMaxUs = glm::max(proxyCostMaxUs, us);
+	if (++proxyReportSteps >= int(10.0f / SIM_DT)) {
+		if (proxyCostUs > PROXY_BUDGET_US) {
+			std::cout << "Collision proxy over budget: " << proxyCostUs << " us avg, "
+				<< proxyCostMaxUs << " us max (budget " << PROXY_BUDGET_US << " us)" << std::endl;
+		}
+		proxyReportSteps = 0;
+		proxyCostMaxUs = 0.0f;
+	}
+	return hit;
+}
+
+
+// Ray query for the warning system: first triangle of either mesh (boxes if a
+// mesh is missing), or the ground raster if that comes first
+bool gpwsRayCast(const glm::vec3& a, const glm::vec3& b, GpwsHit& hit) {
+	float best = 2.0f;
+	glm::vec3 normal(0, 1, 0);
+
+	for (int region = 0; region < 2; region++) {
+		glm::vec3 offset = region ? airportDrawOffset : glm::vec3(0.0f);
+		const MeshBvh& mesh = region ? airportMesh : cityMesh;
+		const Bvh& boxes = region ? airportObstaclesBvh : cityBuildingsBvh;
+		if (!mesh.empty()) {
+			MeshHit mh;
+			if (mesh.firstHit(a - offset, b - offset, mh) && mh.t < best) {
+				best = mh.t;
+				normal = mh.normal;
+			}
+		}
+		else {
+			BvhHit bh;
+			if (boxes.firstHit(a - offset, b - offset, bh) && bh.t < best) {
+				best = bh.t;
+				normal = bh.normal;
+			}
+		}
+	}
+
+	// Open ground outside the meshes: march the raster at its own resolution
+	if (terrain.loaded()) {
+		int steps = glm::clamp(int(glm::length(b - a)), 1, 256);
+		for (int i = 1; i <= steps; i++) {
+			float t = float(i) / steps;
+			if (t >= best) break;
+			glm::vec3 p = glm::mix(a, b, t);
+			if (p.y <= terrain.height(p.x, p.z)) {
+				best = t;
+				normal = glm::vec3(0, 1, 0);
+				break;
+			}
+		}
+	}
+
+	if (best > 1.0f) return false;
+	glm::vec3 p = glm::mix(a, b, best);
+	hit.t = best;
+	hit.building = std::abs(normal.y) < 0.5f ||
+		(terrain.loaded() && terrain.surface(p.x, p.z) == SURFACE_ROOF);
+	return true;
+}
+
+
+bool isInLandingApproach(const glm::vec3& posWorld) {
+	// Extended box around each runway to detect approach
+	const float approachDistance = 50.0f;
+	return airportRunwaySoA.anyContaining(posWorld,
+		glm::vec3(-approachDistance, -10.0f, -approachDistance),
+		glm::vec3(approachDistance, 20.0f, approachDistance));
+}
+
+void updateLandingAssist(Aircraft& a, float dt) {
+	if (!a.onGround && isInLandingApproach(a.airplane.pos)) {
+		if (!a.isLandingAssistActive) {
+			a.isLandingAssistActive = true;
+			a.landingAssistTimer = 0.0f;
+		}
+
+		a.landingAssistTimer += dt;
+		float assistStrength = glm::min(1.0f, a.landingAssistTimer / LANDING_ASSIST_DURATION);
+
+		// Limit extreme pitch angles
+		float pitch = attitudePitch(a.airplane.attitude);
+		if (fabs(pitch) > LANDING_PITCH_THRESHOLD) {
+			float targetPitch = glm::clamp(pitch, -LANDING_PITCH_THRESHOLD, LANDING_PITCH_THRESHOLD);
+			a.airplane.attitude = attitudePitchBy(a.airplane.attitude, (targetPitch - pitch) * assistStrength * 0.5f * dt);
+		}
+
+		// Limit extreme roll angles
+		float roll = attitudeRoll(a.airplane.attitude);
+		if (fabs(roll) > glm::radians(15.0f)) {
+			float maxLandingRoll = glm::radians(15.0f);
+			float targetRoll = glm::clamp(roll, -maxLandingRoll, maxLandingRoll);
+			a.airplane.attitude = attitudeRollBy(a.airplane.attitude, (targetRoll - roll) * assistStrength * dt);
+		}
+
+		// If too fast on approach, gently slow down
+		if (a.airplane.speed > SAFE_LANDING_SPEED) {
+			float speedReduction = assistStrength * 3.0f * dt;
+			a.airplane.speed = glm::max(SAFE_LANDING_SPEED, a.airplane.speed - speedReduction);
+		}
+	}
+	else {
+		a.isLandingAssistActive = false;
+		a.landingAssistTimer = 0.0f;
+	}
+}
+
+
+void startExplosion(Aircraft& a, const glm::vec3& pos) {
+	a.explosionActive = true;
+	a.explosionTimer = 0.0f;
+	a.explosionPos = pos;
+}
+
+// Explosion timer, assists and throttle keys; false while the aircraft is exploding
+bool beginStep(Aircraft& a, float dt) {
+	if (a.explosionActive) {
+		a.explosionTimer += dt;
+		if (a.explosionTimer >= explosionDuration) {
+			a.explosionActive = false;
+			if (a.ai) {
+				spawnAiAircraft(a);
+				return false;
+			}
+			// Reset to airport
+			a.airplane.pos = airportCenter + airportDrawOffset + glm::vec3(-31.23f, 3.0f, 185);
+			a.airplane.attitude = attitudeFromEuler(glm::radians(180.0f), 0.0f, 0.0f);
+			a.pathPitch = 0;
+			a.currentYawRate = 0;
+			a.targetYawRate = 0;
+			a.pitchRate = 0;
+			a.throttle = 0.0f;
+			a.targetThrottle = 0.0f;
+			a.airplane.speed = 0.0f;
+			a.onGround = true;
+			a.verticalSpeed = 0.0f;
+			a.isStalling = false;
+			a.isLandingAssistActive = false;
+		}
+		return false;
+	}
+
+	// Start of this step's path for the swept collision test
+	a.prevPos = a.airplane.pos;
+
+	// Update landing assistance
+	updateLandingAssist(a, dt);
+
+	// Throttle handling
+	const float throttleRate = 0.5f;
+	if (a.throttleUpPressed)
+		a.targetThrottle = glm::min(1.0f, a.targetThrottle + throttleRate * dt);
+	if (a.throttleDownPressed)
+		a.targetThrottle = glm::max(0.0f, a.targetThrottle - throttleRate * dt);
+	return true;
+}
+
+// Airborne aircraft past takeoff follow the same model as integrateFlight()
+bool canBatchFlight(const Aircraft& a) {
+	return a.ai && !a.onGround && a.airplane.pos.y != MIN_Y && a.takeoffTimer <= 0.0f;
+}
+
+// Throttle, speed, attitude and movement of one aircraft
+void integrateAircraft(Aircraft& a, float dt) {
+	// Smooth a.throttle change
+	float thrDiff = a.targetThrottle - a.throttle;
+	float maxThrStep = 1.5f * dt;
+	if (fabs(thrDiff) < maxThrStep) a.throttle = a.targetThrottle;
+	else a.throttle += glm::sign(thrDiff) * maxThrStep;
+	a.throttle = glm::clamp(a.throttle, 0.0f, 1.0f);
+
+	const AircraftParams& type = a.type->params();
+	glm::quat& q = a.airplane.attitude;
+
+	// Yaw rate follows its target with limited acceleration, roll follows the yaw rate
+	float diff = a.targetYawRate - a.currentYawRate;
+	float maxStep = yawAccel * dt;
+	diff = glm::clamp(diff, -maxStep, maxStep);
+	a.currentYawRate += diff;
+
+	float desiredRoll = glm::clamp(-a.currentYawRate * 0.5f,
+		glm::radians(-30.0f), glm::radians(30.0f));
+	float maxRollStep = rollAccel * dt;
+	float rollRate = glm::clamp(desiredRoll - attitudeRoll(q), -maxRollStep, maxRollStep) / dt;
+
+	// ----------- On Ground ----------
+	if (a.onGround || a.airplane.pos.y == MIN_Y) {
+		a.airplane.speed += a.type->groundAccel(a.airplane.speed, attitudePitch(q), a.throttle, GRAVITY) * dt;
+		a.airplane.speed = glm::clamp(a.airplane.speed, 0.0f, type.maxSpeed);
+		a.pathPitch = 0.0f;
+
+		a.airplane.pos.y = groundHeightAt(a.airplane.pos) + 2.0f;
+		a.verticalSpeed = 0.0f;
+		a.isStalling = false;
+
+		// Steering only; the wheels keep the wings level and limit the nose
+		q = integrateAttitude(q, a.currentYawRate, glm::vec3(0.0f), dt);
+		q = attitudeRollBy(q, -0.3f * attitudeRoll(q));
+		float pitch = attitudePitch(q);
+		if (a.pitchRate == 0.0f) {
+			q = attitudePitchBy(q, -0.1f * pitch);
+		}
+		else {
+			q = attitudePitchBy(q, glm::clamp(pitch + a.pitchRate * dt, glm::radians(-15.0f), glm::radians(15.0f)) - pitch);
+		}
+		pitch = attitudePitch(q);
+
+		// Improved takeoff conditions
+		if (a.airplane.speed >= type.minTakeoffSpeed && pitch < glm::radians(-5.0f)) { // Nose up for takeoff
+			a.onGround = false;
+			a.takeoffTimer = 1.2f; // Give more time for takeoff transition
+			a.pathPitch = pitch; // leaves the runway along the nose
+			if (!a.ai) std::cout << "Taking off! Speed: " << a.airplane.speed << std::endl;
+		}
+	}
+
+	// ---------- In Air -----------
+	else {
+		// Takeoff transition period - be extra careful about collisions
+		if (a.takeoffTimer > 0.0f) {
+			a.takeoffTimer -= dt;
+			// Gradually increase altitude during takeoff
+			a.airplane.pos.y = glm::max(a.airplane.pos.y, groundHeightAt(a.airplane.pos) + 2.0f + (1.0f - a.takeoffTimer) * 5.0f);
+		}
+
+		// Free pitch and roll about the aircraft's own axes, yaw about the vertical
+		q = integrateAttitude(q, a.currentYawRate, glm::vec3(a.pitchRate, 0.0f, rollRate), dt);
+		float pitch = attitudePitch(q);
+		float limited = glm::clamp(pitch, glm::radians(-45.0f), glm::radians(45.0f));
+		if (limited != pitch) {
+			q = attitudePitchBy(q, limited - pitch);
+			pitch = limited;
+		}
+
+		// Thrust, lift, drag and gravity change the speed along the path and bend the path
+		float alpha = a.pathPitch - pitch;
+		float dSpeed, dPath;
+		a.type->airborneRates(a.airplane.speed, a.pathPitch, pitch, a.throttle, GRAVITY, dSpeed, dPath);
+		a.airplane.speed = glm::clamp(a.airplane.speed + dSpeed * dt, 0.0f, type.maxSpeed);
+		a.pathPitch = glm::clamp(a.pathPitch + dPath * dt, -MAX_PATH_PITCH, MAX_PATH_PITCH);
+
+		// Stall handling: past the stall angle or below the stall speed the nose drops
+		a.isStalling = (alpha > type.stallAlpha || a.airplane.speed < type.stallSpeed) && a.airplane.pos.y > MIN_Y + 0.5f;
+		if (a.isStalling) {
+			q = attitudePitchBy(q, (STALL_NOSEDOWN - pitch) * (1.0f - expf(-STALL_BLEND_SPEED * dt)));
+		}
+		a.verticalSpeed = -a.airplane.speed * sinf(a.pathPitch);
+	}
+
+	// Movement along the flight path
+	a.airplane.pos += flightDirection(q, a.pathPitch) * (a.airplane.speed * dt);
+}
+
+// Bounds and touchdown; false if the step ended in an explosion or needs no collision test
+bool finishStep(Aircraft& a) {
+	// Boundary checks (more lenient)
+	bool outOfBounds = false;
+	float boundary_buffer = 20.0f; // Give some extra space
+	if (a.airplane.pos.x <= (MIN_X - boundary_buffer) || a.airplane.pos.x >= (MAX_X + boundary_buffer) ||
+		a.airplane.pos.z <= (MIN_Z - boundary_buffer) || a.airplane.pos.z >= (MAX_Z + boundary_buffer)) {
+		outOfBounds = true;
+	}
+
+	// Clamp position but don't explode immediately if near airport
+	a.airplane.pos.x = glm::clamp(a.airplane.pos.x, MIN_X - boundary_buffer, MAX_X + boundary_buffer);
+	a.airplane.pos.z = glm::clamp(a.airplane.pos.z, MIN_Z - boundary_buffer, MAX_Z + boundary_buffer);
+	a.airplane.pos.y = glm::clamp(a.airplane.pos.y, MIN_Y, MAX_Y);
+
+	float groundHeight = groundHeightAt(a.airplane.pos);
+	if (!a.onGround && (a.airplane.pos.y <= groundHeight + 2.0f)) {
+		// Touching down on a building is a crash, not a landing
+		if (terrain.loaded() && terrain.surface(a.airplane.pos.x, a.airplane.pos.z) == SURFACE_ROOF) {
+			startExplosion(a, a.airplane.pos);
+			return false;
+		}
+
+		a.onGround = true;
+		a.airplane.pos.y = groundHeight + 2.0f;
+		a.verticalSpeed = 0.0f;
+		a.pathPitch = 0.0f;
+		a.throttle = 0.0f;
+		a.targetThrottle = 0.0f;
+		if (!a.ai) std::cout << "Landed!" << std::endl;
+	}
+
+	// Only explode if really out of bounds and not near airport
+	if (outOfBounds && !isOverAirport(a.airplane.pos)) {
+		startExplosion(a, a.airplane.pos);
+		return false;
+	}
+
+	// Only check collision if not in takeoff transition
+	return a.takeoffTimer <= 0.0f;
+}
+
+// Collision response once the batched query for the step is answered
+void resolveCollision(Aircraft& a, const CollisionResult& hit) {
+	if (hit.hit) {
+		a.airplane.pos = hit.point;
+		startExplosion(a, hit.point + hit.normal * 0.5f); // keep the sprite out of the wall
+		return;
+	}
+
+	// Airframe volume: player only, its cost is budgeted for one aircraft
+	glm::vec3 proxyHit;
+	if (!a.ai && !a.onGround && proxyCollision(a, proxyHit)) {
+		startExplosion(a, proxyHit);
+	}
+}
+
+// Work of one tick is split into tasks on the shared job system; a task only
+// writes the aircraft of its own index range, so the result does not depend on
+// the number of threads or on which thread ran what.
+const size_t AIRCRAFT_TASK_GRAIN = 64; // aircraft per task
+const size_t FLIGHT_TASK_GRAIN = 256;  // SIMD lanes per task, a multiple of FlightSoA::BATCH
+const size_t QUERY_TASK_GRAIN = 128;   // collision responses per task
+
+enum StepStage : uint8_t {
+	STEP_DONE,       // exploding, or finished without a collision test
+	STEP_INTEGRATED, // by integrateAircraft
+	STEP_BATCHED,    // waits for the SIMD integrator
+	STEP_QUERY,      // needs the collision test
+};
+
+std::vector<uint8_t> stepStage; // per aircraft
+std::vector<CollisionQuery> stepQueries;
+std::vector<CollisionResult> stepResults;
+std::vector<uint32_t> stepOwners; // aircraft index per query
+
+thread_local FlightSoA flightBatch; // per task of integrateFlightBatch
+std::vector<uint32_t> flightBatchOwners;
+
+// Path of this step (airborne), then the end point
+CollisionQuery stepQuery(const Aircraft& a, float dt) {
+	return { a.airplane.pos, (a.airplane.pos - a.prevPos) / dt,
+		(a.onGround ? QUERY_ON_GROUND : 0u) | QUERY_SWEEP };
+}
+
+// One run of flightBatchOwners, all of the same aircraft type
+void integrateFlightRun(size_t first, size_t n, const AircraftType* type, float dt) {
+	FlightSoA& f = flightBatch;
+	f.resize(n);
+	for (size_t k = 0; k < n; k++) {
+		const Aircraft& a = aircraft[flightBatchOwners[first + k]];
+		f.posX[k] = a.airplane.pos.x;
+		f.posY[k] = a.airplane.pos.y;
+		f.posZ[k] = a.airplane.pos.z;
+		f.qw[k] = a.airplane.attitude.w;
+		f.qx[k] = a.airplane.attitude.x;
+		f.qy[k] = a.airplane.attitude.y;
+		f.qz[k] = a.airplane.attitude.z;
+		f.speed[k] = a.airplane.speed;
+		f.pathPitch[k] = a.pathPitch;
+		f.throttle[k] = a.throttle;
+		f.targetThrottle[k] = a.targetThrottle;
+		f.currentYawRate[k] = a.currentYawRate;
+		f.targetYawRate[k] = a.targetYawRate;
+		f.pitchRate[k] = a.pitchRate;
+		f.verticalSpeed[k] = a.verticalSpeed;
+		f.stalling[k] = a.isStalling ? 1.0f : 0.0f;
+	}
+
+	const FlightParams params = { type, MIN_Y, GRAVITY,
+		STALL_NOSEDOWN, STALL_BLEND_SPEED, MAX_PATH_PITCH, yawAccel, rollAccel };
+	integrateFlight(f, dt, params);
+
+	for (size_t k = 0; k < n; k++) {
+		Aircraft& a = aircraft[flightBatchOwners[first + k]];
+		a.airplane.pos = glm::vec3(f.posX[k], f.posY[k], f.posZ[k]);
+		a.airplane.attitude = glm::quat(f.qw[k], f.qx[k], f.qy[k], f.qz[k]);
+		a.airplane.speed = f.speed[k];
+		a.pathPitch = f.pathPitch[k];
+		a.throttle = f.throttle[k];
+		a.currentYawRate = f.currentYawRate[k];
+		a.verticalSpeed = f.verticalSpeed[k];
+		a.isStalling = f.stalling[k] != 0.0f;
+	}
+}
+
+// Cruising AI aircraft go through the SIMD integrator, eight at a time, one type per run
+void integrateFlightBatch(float dt) {
+	auto byType = [](uint32_t x, uint32_t y) { return std::less<const AircraftType*>()(aircraft[x].type, aircraft[y].type); };
+	if (!std::is_sorted(flightBatchOwners.begin(), flightBatchOwners.end(), byType)) {
+		std::stable_sort(flightBatchOwners.begin(), flightBatchOwners.end(), byType);
+	}
+
+	for (size_t first = 0, last = 0; first < flightBatchOwners.size(); first = last) {
+		const AircraftType* type = aircraft[flightBatchOwners[first]].type;
+		while (last < flightBatchOwners.size() && aircraft[flightBatchOwners[last]].type == type) last++;
+		sharedJobs().parallelFor(last - first, FLIGHT_TASK_GRAIN, [&](size_t from, size_t to) {
+			integrateFlightRun(first + from, to - from, type, dt);
+		});
+	}
+}
+
+void stepIsolated(Aircraft& a, float dt) {
+	if (!beginStep(a, dt)) return;
+	integrateAircraft(a, dt);
+	if (!finishStep(a)) return;
+
+	CollisionResult hit = collide(collisionWorld, stepQuery(a, dt), dt);
+	glm::vec3 proxyHit;
+	if (hit.hit) resolveCollision(a, hit);
+	else if (!a.onGround && proxyCollisionTest(a, proxyHit)) startExplosion(a, proxyHit);
+}
+
+// Steps every aircraft, then tests all of them against the world in one batch
+void updatePhysics(float dt) {
+	auto start = std::chrono::steady_clock::now();
+	JobSystem& jobs = sharedJobs();
+	const size_t n = aircraft.size();
+	stepStage.resize(n);
+
+	// Pilots, assists and the per-aircraft integrator
+	jobs.parallelFor(n, AIRCRAFT_TASK_GRAIN, [dt](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			Aircraft& a = aircraft[i];
+			if (a.ai) updateAiPilot(a);
+			if (!beginStep(a, dt)) {
+				stepStage[i] = STEP_DONE;
+			}
+			else if (canBatchFlight(a)) {
+				stepStage[i] = STEP_BATCHED;
+			}
+			else {
+				integrateAircraft(a, dt);
+				stepStage[i] = STEP_INTEGRATED;
+			}
+		}
+	});
+
+	flightBatchOwners.clear();
+	for (size_t i = 0; i < n; i++) {
+		if (stepStage[i] == STEP_BATCHED) flightBatchOwners.push_back((uint32_t)i);
+	}
+	integrateFlightBatch(dt);
+
+	// Bounds and touchdown
+	jobs.parallelFor(n, AIRCRAFT_TASK_GRAIN, [](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			if (stepStage[i] != STEP_DONE) stepStage[i] = finishStep(aircraft[i]) ? STEP_QUERY : STEP_DONE;
+		}
+	});
+
+	stepQueries.clear();
+	stepOwners.clear();
+	for (size_t i = 0; i < n; i++) {
+		if (stepStage[i] != STEP_QUERY) continue;
+		stepQueries.push_back(stepQuery(aircraft[i], dt));
+		stepOwners.push_back((uint32_t)i);
+	}
+
+	stepResults.resize(stepQueries.size());
+	collideBatch(collisionWorld, stepQueries.data(), stepResults.data(), stepQueries.size(), dt, &jobs);
+	jobs.parallelFor(stepQueries.size(), QUERY_TASK_GRAIN, [](size_t first, size_t last) {
+		for (size_t k = first; k < last; k++) {
+			resolveCollision(aircraft[stepOwners[k]], stepResults[k]);
+		}
+	});
+
+	float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	simTickMs = simTickMs * 0.99f + ms * 0.01f;
+	simTickMaxMs = glm::max(simTickMaxMs, ms);
+	if (simTickReport && aircraft.size() > 1 && ++simReportSteps >= int(10.0f / SIM_DT)) {
+		std::cout << "Sim tick: " << aircraft.size() << " aircraft, " << simTickMs << " ms avg, "
+			<< simTickMaxMs << " ms max (budget " << SIM_DT * 1000.0f << " ms)" << std::endl;
+		simReportSteps = 0;
+		simTickMaxMs = 0.0f;
+	}
+}
+
+// ----- Input recording and replay -----
+// Keys are stamped with the tick they were applied before, so a replay feeds
+// them at exactly the same points of the fixed-step simulation.
+const uint64_t CHECKPOINT_TICKS = 120; // state hash once per simulated second
+
+InputRecorder inputRecorder;
+InputReplay inputReplay;
+bool replayActive = false;
+uint64_t simTick = 0;
+uint64_t replayDivergedAt = 0;
+TelemetryRecorder telemetryRecorder;
+
+void recordTelemetry() {
+	static std::vector<TelemetryAircraft> frame;
+	frame.resize(aircraft.size());
+	for (size_t i = 0; i < aircraft.size(); i++) {
+		const Aircraft& a = aircraft[i];
+		TelemetryAircraft& t = frame[i];
+		t.pos = a.airplane.pos;
+		t.attitude = a.airplane.attitude;
+		t.speed = a.airplane.speed;
+		t.pathPitch = a.pathPitch;
+		t.throttle = a.throttle;
+		t.verticalSpeed = a.verticalSpeed;
+		t.flags = uint8_t((a.onGround ? TELEMETRY_ON_GROUND : 0) | (a.isStalling ? TELEMETRY_STALLING : 0)
+			| (a.explosionActive ? TELEMETRY_EXPLODING : 0) | (a.ai ? TELEMETRY_AI : 0));
+		t.aiPhase = uint8_t(a.aiPhase);
+	}
+	telemetryRecorder.frame(simTick, frame.data(), frame.size());
+}
+
+// Hash of everything that evolves between ticks, field by field to skip padding
+uint64_t hashSimState() {
+	uint64_t h = INPUT_LOG_HASH_SEED;
+	auto f32 = [&h](float v) { h = inputLogHash(h, &v, sizeof(v)); };
+	auto u32 = [&h](uint32_t v) { h = inputLogHash(h, &v, sizeof(v)); };
+	auto vec = [&h](const glm::vec3& v) { h = inputLogHash(h, &v, sizeof(v)); };
+	for (const Aircraft& a : aircraft) {
+		// Everything the next tick reads, so a replay diverges at the first checkpoint after it does
+		vec(a.airplane.pos);
+		h = inputLogHash(h, &a.airplane.attitude, sizeof(a.airplane.attitude));
+		f32(a.airplane.speed);
+		f32(a.pitchRate);
+		f32(a.pathPitch);
+		f32(a.targetYawRate);
+		f32(a.currentYawRate);
+		f32(a.throttle);
+		f32(a.targetThrottle);
+		f32(a.verticalSpeed);
+		f32(a.takeoffTimer);
+		f32(a.landingAssistTimer);
+		f32(a.explosionTimer);
+		vec(a.explosionPos);
+		u32(uint32_t(a.onGround) | uint32_t(a.isStalling) << 1 | uint32_t(a.explosionActive) << 2 |
+			uint32_t(a.isLandingAssistActive) << 3 | uint32_t(a.throttleUpPressed) << 4 | uint32_t(a.throttleDownPressed) << 5);
+
+		if (!a.ai) continue;
+		u32(uint32_t(a.aiPhase));
+		u32(uint32_t(a.aiLegs));
+		u32(uint32_t(a.aiApproachLeg));
+		vec(a.waypoint);
+		u32(uint32_t(a.route.size()));
+		u32(uint32_t(a.routeNext));
+		u32(a.rng);
+	}
+	return h;
+}
+
+void checkReplayState(uint64_t expected) {
+	if (replayDivergedAt == 0 && hashSimState() != expected) {
+		replayDivergedAt = simTick;
+		std::cerr << "Replay diverged at tick " << simTick << "\n";
+	}
+}
+
+void simulateTick(const InputEvent* live, size_t liveCount) {
+	if (replayActive) {
+		// Live keys are ignored while a replay runs
+		while (const InputLogRecord* r = inputReplay.next(simTick, INPUT_LOG_KEY)) {
+			applyInputEvent({ r->key, r->action });
+		}
+	}
+	else {
+		for (size_t i = 0; i < liveCount; i++) {
+			inputRecorder.key(simTick, live[i].key, live[i].action);
+			applyInputEvent(live[i]);
+		}
+	}
+
+	updatePhysics(SIM_DT);
+	simTick++;
+	if (telemetryRecorder.isOpen()) recordTelemetry();
+
+	if (!replayActive) {
+		if (inputRecorder.isOpen() && simTick % CHECKPOINT_TICKS == 0) inputRecorder.checkpoint(simTick, hashSimState());
+		return;
+	}
+	if (const InputLogRecord* r = inputReplay.next(simTick, INPUT_LOG_CHECKPOINT)) checkReplayState(r->stateHash);
+	if (simTick >= inputReplay.endTick()) {
+		if (inputReplay.hasEndHash()) checkReplayState(inputReplay.endHash());
+		std::cout << "Replay finished after " << simTick << " ticks: "
+			<< (replayDivergedAt ? "DIVERGED" : "bit-exact") << std::endl;
+		replayActive = false;
+	}
+}
+
+InputLogHeader sessionLogHeader() {
+	InputLogHeader header;
+	header.tickSeconds = SIM_DT;
+	header.aiAircraft = aiAircraftCount;
+	header.cityObj = cityObjPath;
+
+	const Aircraft& player = aircraft[0];
+	for (int i = 0; i < 3; i++) header.startPos[i] = player.airplane.pos[i];
+	header.startAttitude[0] = player.airplane.attitude.w;
+	header.startAttitude[1] = player.airplane.attitude.x;
+	header.startAttitude[2] = player.airplane.attitude.y;
+	header.startAttitude[3] = player.airplane.attitude.z;
+	header.startSpeed = player.airplane.speed;
+	header.startThrottle = player.throttle;
+	header.startTargetThrottle = player.targetThrottle;
+	header.startOnGround = player.onGround;
+	return header;
+}
+
+void applyLogStart(const InputLogHeader& header) {
+	Aircraft& player = aircraft[0];
+	player.airplane.pos = glm::vec3(header.startPos[0], header.startPos[1], header.startPos[2]);
+	player.airplane.attitude = glm::quat(header.startAttitude[0], header.startAttitude[1],
+		header.startAttitude[2], header.startAttitude[3]);
+	player.airplane.speed = header.startSpeed;
+	player.throttle = header.startThrottle;
+	player.targetThrottle = header.startTargetThrottle;
+	player.onGround = header.startOnGround;
+}
+
+int runReplay() {
+	auto start = std::chrono::steady_clock::now();
+	while (replayActive && simTick < inputReplay.endTick()) simulateTick(nullptr, 0);
+	double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	double simSec = double(simTick) * SIM_DT;
+	std::cout << simSec << " s simulated in " << sec << " s (" << simSec / std::max(sec, 1e-9) << "x real time)\n";
+	return replayDivergedAt ? 1 : 0;
+}
@@ -0,0 +1,189 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <glm/glm.hpp>
+#include <tiny_obj_loader.h>
+
+#include "aabb.h"
+#include "aero.h"
+#include "attitude.h"
+#include "collisionworld.h"
+#include "heightfield.h"
+#include "navgrid.h"
+#include "gpws.h"
+#include "inputlog.h"
+#include "telemetry.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Flight model, world and input handling of the simulator, without any GL.
+// Shared by the windowed simulator and the headless runner.
+
+const float SIM_DT = 1.0f / 120.0f;
+const float explosionDuration = 1.5f;
+
+// Type of every aircraft for now, loaded from AIRCRAFT_TYPE_FILE by initWorld
+extern AircraftType jetType;
+
+struct AirplaneState {
+	glm::vec3 pos;
+	glm::quat attitude; // model to world, see attitude.h
+	float speed;
+};
+
+// What an AI aircraft does: cruise -> approach -> rollout -> backtrack -> takeoff -> cruise
+enum AiPhase {
+	AI_CRUISE,    // through random waypoints over the map
+	AI_APPROACH,  // downwind, the approach fix, then down the glide path
+	AI_ROLLOUT,   // braking on the runway
+	AI_BACKTRACK, // taxiing back to the start of the runway
+	AI_TAKEOFF,   // takeoff run and climb out
+};
+
+// Everything that is simulated per aircraft. aircraft[0] is the player, the
+// rest is AI traffic flown by updateAiPilot.
+struct Aircraft {
+	AirplaneState airplane = { glm::vec3(0, 40, 0), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), 10.0f };
+	float pitchRate = 0.0f;
+	float pathPitch = 0.0f; // flight path angle, signed like pitch (positive descends)
+	float targetYawRate = 0.0f;
+	float currentYawRate = 0.0f;
+
+	float throttle = 0.0f;
+	float targetThrottle = 0.0f;
+	bool throttleUpPressed = false;
+	bool throttleDownPressed = false;
+
+	bool onGround = true;
+	float verticalSpeed = 0.0f; // climb rate, m/s
+	bool isStalling = false;
+	float takeoffTimer = 0.0f;
+	bool isLandingAssistActive = false;
+	float landingAssistTimer = 0.0f;
+
+	bool explosionActive = false;
+	float explosionTimer = 0.0f;
+	glm::vec3 explosionPos = glm::vec3(0.0f);
+
+	glm::vec3 prevPos = glm::vec3(0.0f); // start of the current step, for the swept test
+
+	bool ai = false;
+	AiPhase aiPhase = AI_CRUISE;
+	int aiLegs = 0;         // cruise waypoints left before the approach
+	int aiApproachLeg = 0;  // 0 downwind, 1 to the fix, 2 final
+	glm::vec3 waypoint = glm::vec3(0.0f);
+	std::vector<glm::vec3> route; // planned through the nav grid to the waypoint, empty: straight
+	size_t routeNext = 0;
+	uint32_t rng = 1; // per-aircraft random stream for AI decisions
+
+	const AircraftType* type = &jetType;
+};
+
+// Controls, numbered like the GLFW_KEY_* codes so window events pass straight through
+enum SimKey {
+	SIM_KEY_S = 83,
+	SIM_KEY_W = 87,
+	SIM_KEY_RIGHT = 262,
+	SIM_KEY_LEFT = 263,
+	SIM_KEY_DOWN = 264,
+	SIM_KEY_UP = 265,
+};
+
+enum SimKeyAction {
+	SIM_RELEASE = 0,
+	SIM_PRESS = 1,
+};
+
+struct InputEvent {
+	int key;
+	int action;
+};
+
+// Meshes as loaded from the OBJ files, per material
+extern std::vector<std::vector<float>> vertsPerMatJet, normsPerMatJet, uvsPerMatJet;
+extern std::vector<int> countsPerMatJet;
+extern std::vector<tinyobj::material_t> materialsJet;
+extern std::vector<std::vector<float>> vertsPerMatCity, normsPerMatCity, uvsPerMatCity;
+extern std::vector<int> countsPerMatCity;
+extern std::vector<tinyobj::material_t> materialsCity;
+extern std::vector<std::vector<float>> vertsPerMatAirport, normsPerMatAirport, uvsPerMatAirport;
+extern std::vector<int> countsPerMatAirport;
+extern std::vector<tinyobj::material_t> materialsAirport;
+
+extern glm::vec3 airportDrawOffset;
+extern glm::vec3 airportCenter;
+extern std::vector<AABB> airportRunwayAABBs; // relative to airportCenter + airportDrawOffset
+extern std::vector<AABB> airportObstacles;   // shape boxes in model coordinates, appended by loadModel
+extern float MIN_X, MAX_X;
+extern float MIN_Z, MAX_Z;
+extern float MIN_Y, MAX_Y;
+
+// Free airspace for AI routing, baked from the building boxes
+extern NavGrid navGrid;
+
+extern std::string cityObjPath; // --city
+extern int aiAircraftCount;     // --ai
+extern bool simTickReport;      // prints the tick cost every 10 simulated seconds
+
+// aircraft[0] is the player
+extern std::vector<Aircraft> aircraft;
+extern uint64_t simTick; // ticks simulated since initWorld
+
+extern InputRecorder inputRecorder; // open: live input is logged
+extern InputReplay inputReplay;
+extern bool replayActive;           // input comes from inputReplay
+extern uint64_t replayDivergedAt;   // first checkpoint that did not match, 0 if none
+extern TelemetryRecorder telemetryRecorder; // open: every tick is recorded
+
+// One OBJ file split per material into flat vertex, normal and UV arrays. Also
+// appends a box per shape to airportRunwayAABBs or airportObstacles.
+bool loadModel(const std::string& objFile, std::vector<std::vector<float>>& vertsPerMat,
+	std::vector<std::vector<float>>& normsPerMat, std::vector<std::vector<float>>& uvsPerMat,
+	std::vector<int>& countsPerMat, std::vector<tinyobj::material_t>& materials, AABB* outAABB = nullptr);
+
+// Loads the models and builds collision structures, terrain and aircraft
+bool initWorld();
+
+// Replaces the AI traffic with count fresh aircraft, the same ones initWorld makes
+void spawnAiTraffic(int count);
+
+void applyInputEvent(const InputEvent& ev);
+void updatePhysics(float dt);
+
+// One aircraft without the AI pilot, the SIMD batch or shared statistics, with
+// its own collision and airframe test. Reads the world only, so threads may
+// step separate aircraft concurrently.
+void stepIsolated(Aircraft& a, float dt);
+
+float groundHeightAt(const glm::vec3& posWorld);
+bool isOnRunway(const glm::vec3& posWorld);
+bool isInLandingApproach(const glm::vec3& posWorld);
+// End-of-step point test against buildings and airport obstacles
+bool checkCollision(const glm::vec3& posWorld, bool onGround);
+
+// First runway in world space: centre line x, ends in z, surface height
+struct RunwayInfo {
+	float centreX;
+	float minZ, maxZ;
+	float groundY;
+};
+RunwayInfo mainRunway();
+
+// One fixed step: live events (recorded if inputRecorder is open) or the replayed ones
+void simulateTick(const InputEvent* live, size_t liveCount);
+uint64_t hashSimState();
+
+// Runs the loaded replay to its end as fast as possible; 1 if it diverged
+int runReplay();
+
+// Header for an input log started now: tick, world settings and the player's state
+InputLogHeader sessionLogHeader();
+// Puts the player back where the recording started; after initWorld()
+void applyLogStart(const InputLogHeader& header);
+
+// Ray query for the GPWS worker; only reads data that is immutable after initWorld
+bool gpwsRayCast(const glm::vec3& a, const glm::vec3& b, GpwsHit& hit);
+
+#endif
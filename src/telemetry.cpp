@@ -0,0 +1,312 @@
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const char MAGIC[4] = { 'T', 'L', 'M', 'Y' };
+const char CHUNK_MAGIC[4] = { 'T', 'C', 'H', 'K' };
+const char INDEX_MAGIC[4] = { 'T', 'I', 'D', 'X' };
+const uint32_t VERSION = 1;
+const size_t HEADER_BYTES = 16;       // magic, version, tick seconds, ticks per chunk
+const size_t CHUNK_HEADER_BYTES = 20; // magic, first tick, frames, bytes
+const size_t FOOTER_BYTES = 24;       // first tick, chunk count, index offset, magic
+const int FIELDS = 11;                // floats per aircraft
+
+// Little-endian fixed-size fields, as in the input log
+void putU32(std::vector<uint8_t>& out, uint32_t v) {
+	for (int i = 0; i < 4; i++) out.push_back(uint8_t(v >> (8 * i)));
+}
+
+void putU64(std::vector<uint8_t>& out, uint64_t v) {
+	putU32(out, (uint32_t)v);
+	putU32(out, (uint32_t)(v >> 32));
+}
+
+void putVarint(std::vector<uint8_t>& out, uint32_t v) {
+	while (v >= 0x80) {
+		out.push_back(uint8_t((v & 0x7f) | 0x80));
+		v >>= 7;
+	}
+	out.push_back(uint8_t(v));
+}
+
+uint32_t getU32(const uint8_t* p) {
+	return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+uint64_t getU64(const uint8_t* p) {
+	return uint64_t(getU32(p)) | uint64_t(getU32(p + 4)) << 32;
+}
+
+// Unsigned keys in the order of the floats, so nearby values have nearby keys
+uint32_t floatKey(float f) {
+	uint32_t u;
+	std::memcpy(&u, &f, sizeof(u));
+	return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+float keyFloat(uint32_t k) {
+	uint32_t u = (k & 0x80000000u) ? (k & 0x7fffffffu) : ~k;
+	float f;
+	std::memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+void toKeys(const TelemetryAircraft& a, uint32_t* k) {
+	const float v[FIELDS] = { a.pos.x, a.pos.y, a.pos.z, a.attitude.w, a.attitude.x, a.attitude.y, a.attitude.z,
+		a.speed, a.pathPitch, a.throttle, a.verticalSpeed };
+	for (int f = 0; f < FIELDS; f++) k[f] = floatKey(v[f]);
+}
+
+void fromKeys(const uint32_t* k, TelemetryAircraft& a) {
+	a.pos = glm::vec3(keyFloat(k[0]), keyFloat(k[1]), keyFloat(k[2]));
+	a.attitude = glm::quat(keyFloat(k[3]), keyFloat(k[4]), keyFloat(k[5]), keyFloat(k[6]));
+	a.speed = keyFloat(k[7]);
+	a.pathPitch = keyFloat(k[8]);
+	a.throttle = keyFloat(k[9]);
+	a.verticalSpeed = keyFloat(k[10]);
+}
+
+// Nothing on the first frame of a chunk, the last value on the second, a
+// straight line through the last two after that
+uint32_t predict(uint32_t frameInChunk, uint32_t k1, uint32_t k2) {
+	if (frameInChunk == 0) return 0;
+	if (frameInChunk == 1) return k1;
+	return 2u * k1 - k2;
+}
+
+uint32_t zigzag(int32_t v) { return (uint32_t(v) << 1) ^ uint32_t(v >> 31); }
+int32_t unzigzag(uint32_t v) { return int32_t((v >> 1) ^ (0u - (v & 1))); }
+
+}
+
+bool TelemetryRecorder::open(const std::string& path, float tickSeconds, float indexSeconds) {
+	out.open(path, std::ios::binary | std::ios::trunc);
+	if (!out) return false;
+
+	ticksPerChunk = (uint32_t)std::max(1.0f, std::round(indexSeconds / tickSeconds));
+	uint32_t dtBits;
+	std::memcpy(&dtBits, &tickSeconds, sizeof(dtBits));
+	std::vector<uint8_t> header(MAGIC, MAGIC + 4);
+	putU32(header, VERSION);
+	putU32(header, dtBits);
+	putU32(header, ticksPerChunk);
+	out.write((const char*)header.data(), header.size());
+
+	written = header.size();
+	chunk.clear();
+	chunkFrames = 0;
+	offsets.clear();
+	nextTick = firstTick = 0;
+	return bool(out);
+}
+
+void TelemetryRecorder::frame(uint64_t tick, const TelemetryAircraft* aircraft, size_t count) {
+	if (!out.is_open()) return;
+	if (written == HEADER_BYTES && chunkFrames == 0) {
+		firstTick = nextTick = tick;
+	}
+	else if (tick != nextTick) {
+		// The index assumes one frame per tick
+		std::cerr << "Telemetry: tick " << tick << " does not follow " << nextTick - 1 << ", skipped\n";
+		return;
+	}
+	if (chunkFrames == 0) {
+		chunkFirstTick = tick;
+		prev1.clear();
+		prev2.clear();
+	}
+
+	putVarint(chunk, (uint32_t)count);
+	prev1.resize(count * FIELDS, 0);
+	prev2.resize(count * FIELDS, 0);
+	uint32_t keys[FIELDS];
+	for (size_t i = 0; i < count; i++) {
+		toKeys(aircraft[i], keys);
+		uint32_t* k1 = &prev1[i * FIELDS];
+		uint32_t* k2 = &prev2[i * FIELDS];
+		for (int f = 0; f < FIELDS; f++) {
+			putVarint(chunk, zigzag(int32_t(keys[f] - predict(chunkFrames, k1[f], k2[f]))));
+			k2[f] = k1[f];
+			k1[f] = keys[f];
+		}
+		chunk.push_back(aircraft[i].flags);
+		chunk.push_back(aircraft[i].aiPhase);
+	}
+
+	chunkFrames++;
+	nextTick = tick + 1;
+	if (chunkFrames == ticksPerChunk) flushChunk();
+}
+
+void TelemetryRecorder::flushChunk() {
+	std::vector<uint8_t> header(CHUNK_MAGIC, CHUNK_MAGIC + 4);
+	putU64(header, chunkFirstTick);
+	putU32(header, chunkFrames);
+	putU32(header, (uint32_t)chunk.size());
+	out.write((const char*)header.data(), header.size());
+	out.write((const char*)chunk.data(), chunk.size());
+	out.flush(); // a crash loses one chunk at most
+
+	offsets.push_back(written);
+	written += header.size() + chunk.size();
+	chunk.clear();
+	chunkFrames = 0;
+}
+
+void TelemetryRecorder::close() {
+	if (!out.is_open()) return;
+	if (chunkFrames > 0) flushChunk();
+
+	std::vector<uint8_t> tail;
+	for (uint64_t off : offsets) putU64(tail, off);
+	putU64(tail, firstTick);
+	putU32(tail, (uint32_t)offsets.size());
+	putU64(tail, written);
+	tail.insert(tail.end(), INDEX_MAGIC, INDEX_MAGIC + 4);
+	out.write((const char*)tail.data(), tail.size());
+	written += tail.size();
+	out.close();
+}
+
+bool TelemetryReader::open(const std::string& path) {
+	close();
+	if (!file.open(path)) return false;
+	base = (const uint8_t*)file.data();
+	const size_t size = file.size();
+	if (size < HEADER_BYTES || std::memcmp(base, MAGIC, 4) != 0 || getU32(base + 4) != VERSION) {
+		close();
+		return false;
+	}
+	uint32_t dtBits = getU32(base + 8);
+	std::memcpy(&dt, &dtBits, sizeof(dt));
+	ticksPerChunk = getU32(base + 12);
+
+	if (size >= HEADER_BYTES + FOOTER_BYTES && std::memcmp(base + size - 4, INDEX_MAGIC, 4) == 0) {
+		const uint8_t* footer = base + size - FOOTER_BYTES;
+		uint64_t indexOffset = getU64(footer + 12);
+		chunks = getU32(footer + 8);
+		if (indexOffset + uint64_t(chunks) * 8 + FOOTER_BYTES == size) index = base + indexOffset;
+	}
+	if (!index) {
+		// No index: the session ended without close(); walk the complete chunks
+		chunks = 0;
+		for (size_t off = HEADER_BYTES; off + CHUNK_HEADER_BYTES <= size;) {
+			const uint8_t* h = base + off;
+			size_t bytes = getU32(h + 16);
+			if (std::memcmp(h, CHUNK_MAGIC, 4) != 0 || off + CHUNK_HEADER_BYTES + bytes > size) break;
+			rebuilt.push_back(off);
+			off += CHUNK_HEADER_BYTES + bytes;
+		}
+		chunks = rebuilt.size();
+		if (chunks > 0) std::cerr << path << ": telemetry without an index, " << chunks << " chunks recovered\n";
+	}
+	if (chunks == 0 || ticksPerChunk == 0) {
+		close();
+		return false;
+	}
+
+	const uint8_t* firstChunk = base + chunkOffset(0);
+	const uint8_t* lastChunk = base + chunkOffset(chunks - 1);
+	first = getU64(firstChunk + 4);
+	count = uint64_t(chunks - 1) * ticksPerChunk + getU32(lastChunk + 12);
+	return seek(first);
+}
+
+void TelemetryReader::close() {
+	file.close();
+	base = nullptr;
+	index = nullptr;
+	rebuilt.clear();
+	chunks = 0;
+	first = count = 0;
+	framesLeft = 0;
+}
+
+uint64_t TelemetryReader::chunkOffset(size_t i) const {
+	return index ? getU64(index + 8 * i) : rebuilt[i];
+}
+
+bool TelemetryReader::enterChunk(size_t i) {
+	const uint8_t* h = base + chunkOffset(i);
+	chunk = i;
+	tick = getU64(h + 4);
+	framesLeft = getU32(h + 12);
+	p = h + CHUNK_HEADER_BYTES;
+	chunkEnd = p + getU32(h + 16);
+	frameInChunk = 0;
+	prev1.clear();
+	prev2.clear();
+	return true;
+}
+
+bool TelemetryReader::seek(uint64_t target) {
+	if (!base || target < first || target >= first + count) return false;
+	enterChunk(size_t((target - first) / ticksPerChunk));
+	while (tick < target) {
+		if (!decodeFrame(nullptr)) return false;
+	}
+	return true;
+}
+
+bool TelemetryReader::next(TelemetryFrame& frame) {
+	if (!base) return false;
+	if (framesLeft == 0) {
+		if (chunk + 1 >= chunks) return false;
+		enterChunk(chunk + 1);
+	}
+	return decodeFrame(&frame);
+}
+
+bool TelemetryReader::decodeFrame(TelemetryFrame* frame) {
+	if (framesLeft == 0) return false;
+	bool ok = true;
+	auto varint = [&]() {
+		uint32_t v = 0;
+		for (int shift = 0; shift < 35; shift += 7) {
+			if (p >= chunkEnd) break;
+			uint8_t b = *p++;
+			v |= uint32_t(b & 0x7f) << shift;
+			if (!(b & 0x80)) return v;
+		}
+		ok = false;
+		return 0u;
+	};
+
+	size_t n = varint();
+	if (!ok || n > size_t(chunkEnd - p)) return false;
+	prev1.resize(n * FIELDS, 0);
+	prev2.resize(n * FIELDS, 0);
+	if (frame) {
+		frame->tick = tick;
+		frame->aircraft.resize(n);
+	}
+	for (size_t i = 0; i < n && ok; i++) {
+		uint32_t* k1 = &prev1[i * FIELDS];
+		uint32_t* k2 = &prev2[i * FIELDS];
+		for (int f = 0; f < FIELDS; f++) {
+			uint32_t key = predict(frameInChunk, k1[f], k2[f]) + uint32_t(unzigzag(varint()));
+			k2[f] = k1[f];
+			k1[f] = key;
+		}
+		if (chunkEnd - p < 2) ok = false;
+		if (!ok) break;
+		if (frame) {
+			TelemetryAircraft& a = frame->aircraft[i];
+			fromKeys(k1, a);
+			a.flags = p[0];
+			a.aiPhase = p[1];
+		}
+		p += 2;
+	}
+	if (!ok) return false;
+
+	tick++;
+	framesLeft--;
+	frameInChunk++;
+	return true;
+}
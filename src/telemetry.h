@@ -0,0 +1,121 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "mappedfile.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum TelemetryFlags : uint8_t {
+	TELEMETRY_ON_GROUND = 1,
+	TELEMETRY_STALLING = 2,
+	TELEMETRY_EXPLODING = 4,
+	TELEMETRY_AI = 8,
+};
+
+// State of one aircraft after a tick
+struct TelemetryAircraft {
+	glm::vec3 pos;
+	glm::quat attitude;
+	float speed;
+	float pathPitch;
+	float throttle;
+	float verticalSpeed;
+	uint8_t flags;   // TelemetryFlags
+	uint8_t aiPhase; // AiPhase of AI aircraft
+};
+
+struct TelemetryFrame {
+	uint64_t tick;
+	std::vector<TelemetryAircraft> aircraft;
+};
+
+// Lossless per-tick telemetry of every aircraft. Floats are stored as
+// order-preserving integer keys of their bit patterns, each predicted from the
+// two previous ticks of the same aircraft; the residual goes out as a zigzag
+// varint, so steady flight costs a byte or two per value.
+//
+// Ticks are grouped in chunks of a fixed length. The first frame of a chunk is
+// predicted from nothing, so any chunk decodes on its own, and an index of
+// chunk offsets at the end of the file turns a seek into one lookup plus at
+// most a chunk of frames. A session cut short loses only its last chunk; the
+// reader then walks the chunk headers instead of the index.
+//
+// File: "TLMY", version, tick seconds, ticks per chunk; chunks of "TCHK",
+// first tick, frame count, byte length, frames; then the index (u64 offset
+// per chunk) and the footer: first tick, chunk count, index offset, "TIDX".
+class TelemetryRecorder {
+public:
+	// indexSeconds: chunk length, the granularity of the seek index
+	bool open(const std::string& path, float tickSeconds, float indexSeconds = 1.0f);
+	bool isOpen() const { return out.is_open(); }
+
+	// Ticks must follow each other; the aircraft count may change between them
+	void frame(uint64_t tick, const TelemetryAircraft* aircraft, size_t count);
+	void close(); // writes the last chunk and the index
+
+	uint64_t bytesWritten() const { return written; }
+
+private:
+	void flushChunk();
+
+	std::ofstream out;
+	uint32_t ticksPerChunk = 0;
+	std::vector<uint8_t> chunk;      // frames of the chunk being filled
+	uint32_t chunkFrames = 0;
+	uint64_t chunkFirstTick = 0;
+	uint64_t firstTick = 0;
+	uint64_t nextTick = 0;
+	std::vector<uint32_t> prev1, prev2; // keys one and two ticks back, per aircraft field
+	std::vector<uint64_t> offsets;   // of every written chunk
+	uint64_t written = 0;
+};
+
+// Memory-maps a telemetry file and decodes it from any tick
+class TelemetryReader {
+public:
+	bool open(const std::string& path);
+	void close();
+
+	float tickSeconds() const { return dt; }
+	uint64_t firstTick() const { return first; }
+	uint64_t tickCount() const { return count; }
+	size_t chunkCount() const { return chunks; }
+	size_t fileBytes() const { return file.size(); }
+	bool indexed() const { return index != nullptr; } // false for a file cut short
+
+	// Positions next() on `tick`: a chunk lookup and at most one chunk of frames
+	bool seek(uint64_t tick);
+	bool seekSeconds(double seconds) { return seconds >= 0.0 && seek(first + uint64_t(seconds / dt + 0.5)); }
+	// The frame at the cursor, then the cursor moves to the next tick
+	bool next(TelemetryFrame& frame);
+
+private:
+	uint64_t chunkOffset(size_t i) const;
+	bool enterChunk(size_t i);
+	bool decodeFrame(TelemetryFrame* frame); // null: only advances the prediction
+
+	MappedFile file;
+	const uint8_t* base = nullptr;
+	float dt = 0.0f;
+	uint32_t ticksPerChunk = 0;
+	uint64_t first = 0, count = 0;
+	size_t chunks = 0;
+	const uint8_t* index = nullptr;   // mapped, u64 per chunk
+	std::vector<uint64_t> rebuilt;    // chunk offsets of a file without an index
+
+	// Decoder
+	size_t chunk = 0;
+	const uint8_t* p = nullptr;
+	const uint8_t* chunkEnd = nullptr;
+	uint32_t framesLeft = 0, frameInChunk = 0;
+	uint64_t tick = 0;
+	std::vector<uint32_t> prev1, prev2;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "uniformgrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const int MAX_CELLS = 1 << 20;
+}
+
+void UniformGrid::build(const std::vector<AABB>& boxes, glm::vec2 boundsMin, glm::vec2 boundsMax, float cellSize) {
+	cellStart.clear();
+	cellBoxes.clear();
+
+	glm::vec2 extent = glm::max(boundsMax - boundsMin, glm::vec2(1.0f));
+	if (cellSize <= 0.0f) {
+		// Roughly one box per cell, but never smaller than an average footprint
+		float footprint = 0.0f;
+		for (const auto& b : boxes) {
+			footprint += 0.5f * ((b.max.x - b.min.x) + (b.max.z - b.min.z));
+		}
+		footprint = boxes.empty() ? 1.0f : footprint / boxes.size();
+		float perBox = std::sqrt(extent.x * extent.y / std::max<size_t>(boxes.size(), 1));
+		cellSize = std::max(footprint, perBox);
+	}
+	cellSize = std::max(cellSize, std::sqrt(extent.x * extent.y / MAX_CELLS));
+
+	origin = boundsMin;
+	invCell = 1.0f / cellSize;
+	cellsX = std::max(1, int(std::ceil(extent.x * invCell)));
+	cellsZ = std::max(1, int(std::ceil(extent.y * invCell)));
+
+	// Two passes: count per cell, then fill at prefix-summed offsets
+	cellStart.assign(cellsX * cellsZ + 1, 0);
+	for (const auto& b : boxes) {
+		for (int z = clampZ(b.min.z); z <= clampZ(b.max.z); z++)
+			for (int x = clampX(b.min.x); x <= clampX(b.max.x); x++)
+				cellStart[z * cellsX + x + 1]++;
+	}
+	for (size_t c = 1; c < cellStart.size(); c++) cellStart[c] += cellStart[c - 1];
+
+	std::vector<int32_t> slots(cellStart.back());
+	std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+	for (size_t i = 0; i < boxes.size(); i++) {
+		const AABB& b = boxes[i];
+		for (int z = clampZ(b.min.z); z <= clampZ(b.max.z); z++)
+			for (int x = clampX(b.min.x); x <= clampX(b.max.x); x++)
+				slots[fill[z * cellsX + x]++] = (int32_t)i;
+	}
+
+	for (int32_t i : slots) cellBoxes.append(boxes[i], i);
+	cellBoxes.seal();
+}
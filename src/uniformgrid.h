@@ -0,0 +1,62 @@
+#ifndef UNIFORMGRID_H
+#define UNIFORMGRID_H
+
+#include "aabbsoa.h"
+
+#include <vector>
+#include <cstdint>
+
+// Uniform grid over the XZ plane. Every box is bucketed into each cell its
+// footprint touches, so a point query only looks at the boxes of one cell.
+// Cells are stored back to back (offsets + one AabbSoA), queries never allocate
+// and test the boxes of a cell eight at a time.
+// Points and boxes outside the bounds fall into the border cells.
+class UniformGrid {
+public:
+	// cellSize <= 0 picks a size from the box count and their average footprint
+	void build(const std::vector<AABB>& boxes, glm::vec2 boundsMin, glm::vec2 boundsMax, float cellSize = 0.0f);
+
+	// Calls pred(box, index) for the boxes of p's cell with min + lo < p < max + hi,
+	// stops at the first true
+	template <typename Pred>
+	bool anyInCell(const glm::vec3& p, const glm::vec3& lo, const glm::vec3& hi, Pred&& pred) const;
+
+	int cellOf(const glm::vec3& p) const;
+	int cellCountX() const { return cellsX; }
+	int cellCountZ() const { return cellsZ; }
+	size_t memoryBytes() const { return cellStart.capacity() * sizeof(uint32_t) + cellBoxes.memoryBytes(); }
+
+private:
+	glm::vec2 origin = glm::vec2(0.0f);
+	float invCell = 1.0f;
+	int cellsX = 0, cellsZ = 0;
+
+	std::vector<uint32_t> cellStart; // cellsX * cellsZ + 1 offsets
+	AabbSoA cellBoxes;               // boxes copied per cell, with their original index
+
+	int clampX(float x) const;
+	int clampZ(float z) const;
+};
+
+inline int UniformGrid::clampX(float x) const {
+	int c = int((x - origin.x) * invCell);
+	return c < 0 ? 0 : (c >= cellsX ? cellsX - 1 : c);
+}
+
+inline int UniformGrid::clampZ(float z) const {
+	int c = int((z - origin.y) * invCell);
+	return c < 0 ? 0 : (c >= cellsZ ? cellsZ - 1 : c);
+}
+
+inline int UniformGrid::cellOf(const glm::vec3& p) const {
+	return clampZ(p.z) * cellsX + clampX(p.x);
+}
+
+template <typename Pred>
+bool UniformGrid::anyInCell(const glm::vec3& p, const glm::vec3& lo, const glm::vec3& hi, Pred&& pred) const {
+	if (cellStart.empty()) return false;
+	int c = cellOf(p);
+	return cellBoxes.anyContaining(cellStart[c], cellStart[c + 1], p, lo, hi, pred);
+}
+
+#endif